@@ -0,0 +1,55 @@
+// aligned_buffer.hpp
+#ifndef ALIGNED_BUFFER_HPP
+#define ALIGNED_BUFFER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+// Cache-line alignment keeps SIMD loads aligned and stops neighbouring
+// planes from sharing a line
+constexpr std::size_t kBufferAlignment = 64;
+
+// Fixed-size, 64-byte aligned heap array of trivially copyable T,
+// zero-initialized. Movable, not copyable.
+template <typename T>
+class AlignedBuffer {
+private:
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(std::size_t size) : size_(size) {
+        if (size_ > 0) {
+            data_ = static_cast<T*>(::operator new(size_ * sizeof(T), std::align_val_t(kBufferAlignment)));
+            std::memset(static_cast<void*>(data_), 0, size_ * sizeof(T));
+        }
+    }
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept : data_(std::exchange(other.data_, nullptr)),
+                                                    size_(std::exchange(other.size_, 0)) {}
+
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    ~AlignedBuffer() {
+        if (data_ != nullptr) ::operator delete(data_, std::align_val_t(kBufferAlignment));
+    }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    T& operator[](std::size_t i) { return data_[i]; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+};
+
+#endif // ALIGNED_BUFFER_HPP
@@ -0,0 +1,257 @@
+// arena_allocator.hpp
+#ifndef ARENA_ALLOCATOR_HPP
+#define ARENA_ALLOCATOR_HPP
+
+#include "aligned_buffer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <utility>
+
+// Standard chunk size: large enough that growing is rare, small enough
+// that a recycled chunk is cheap to keep around
+constexpr std::size_t kArenaChunkSize = 64 * 1024;
+
+// Header at the start of every chunk; the payload starts kBufferAlignment
+// bytes in, so it is cache-line aligned
+struct ArenaChunk {
+    ArenaChunk* next;                   // next older chunk of an arena, or next free chunk
+    std::size_t size;                   // payload bytes
+
+    char* payload() { return reinterpret_cast<char*>(this) + kBufferAlignment; }
+};
+
+// Recycles standard-size chunks between arenas (and threads): release()
+// keeps up to max_free of them on a free list under a mutex, and
+// acquire() takes one from there before asking the heap. Oversized chunks
+// go straight back to the heap. Arenas take the lock only when they cross
+// a chunk boundary.
+class ChunkPool {
+private:
+    std::size_t chunk_size_;
+    std::size_t max_free_;
+    std::mutex mutex_;
+    ArenaChunk* free_ = nullptr;
+    std::size_t free_count_ = 0;
+    std::size_t heap_chunks_ = 0;       // chunks obtained from the heap so far
+
+    static ArenaChunk* allocate_chunk(std::size_t size) {
+        void* memory = ::operator new(kBufferAlignment + size, std::align_val_t(kBufferAlignment));
+        ArenaChunk* chunk = static_cast<ArenaChunk*>(memory);
+        chunk->next = nullptr;
+        chunk->size = size;
+        return chunk;
+    }
+
+    static void free_chunk(ArenaChunk* chunk) { ::operator delete(chunk, std::align_val_t(kBufferAlignment)); }
+
+public:
+    explicit ChunkPool(std::size_t chunk_size = kArenaChunkSize, std::size_t max_free = 256)
+        : chunk_size_(chunk_size), max_free_(max_free) {}
+
+    ~ChunkPool() {
+        while (free_ != nullptr) free_chunk(std::exchange(free_, free_->next));
+    }
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // The pool thread_arena() and default-constructed arenas draw from
+    static ChunkPool& global() {
+        static ChunkPool pool;
+        return pool;
+    }
+
+    std::size_t chunk_size() const { return chunk_size_; }
+
+    std::size_t free_chunks() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_count_;
+    }
+
+    std::size_t heap_chunks() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return heap_chunks_;
+    }
+
+    // A chunk with at least size payload bytes
+    ArenaChunk* acquire(std::size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (size <= chunk_size_ && free_ != nullptr) {
+                free_count_--;
+                return std::exchange(free_, free_->next);
+            }
+            heap_chunks_++;
+        }
+        return allocate_chunk(std::max(size, chunk_size_));
+    }
+
+    void release(ArenaChunk* chunk) {
+        if (chunk->size == chunk_size_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_count_ < max_free_) {
+                chunk->next = free_;
+                free_ = chunk;
+                free_count_++;
+                return;
+            }
+        }
+        free_chunk(chunk);
+    }
+};
+
+// Bump allocator: allocate() rounds the top of the current chunk up to
+// the alignment and moves it past the block, which is a compare and an
+// add; a block that does not fit starts a new chunk from the pool (or an
+// oversized one of its own). Blocks are not freed one by one. mark()
+// records the top, and rewind() drops everything allocated since,
+// handing the chunks it empties back to the pool except one spare kept
+// for the next growth. Destructors are not run: use it for trivially
+// destructible data, or for containers that are destroyed (or abandoned
+// wholesale) before the rewind. Not thread-safe; see thread_arena().
+class Arena {
+public:
+    struct Marker {
+        ArenaChunk* chunk;
+        char* top;
+    };
+
+private:
+    ChunkPool* pool_;
+    ArenaChunk* current_ = nullptr;     // newest chunk; ->next is the one before
+    ArenaChunk* spare_ = nullptr;
+    char* top_ = nullptr;
+    char* end_ = nullptr;
+    std::size_t chunks_ = 0;
+
+    void* grow(std::size_t size, std::size_t alignment) {
+        std::size_t need = size + (alignment > kBufferAlignment ? alignment : 0);
+        ArenaChunk* chunk;
+        if (spare_ != nullptr && need <= spare_->size) {
+            chunk = std::exchange(spare_, nullptr);
+        } else {
+            chunk = pool_->acquire(need);
+        }
+        chunk->next = current_;
+        current_ = chunk;
+        chunks_++;
+        end_ = chunk->payload() + chunk->size;
+        char* block = align_up(chunk->payload(), alignment);
+        top_ = block + size;
+        return block;
+    }
+
+    static char* align_up(char* p, std::size_t alignment) {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+    }
+
+    void drop_current() {
+        ArenaChunk* chunk = current_;
+        current_ = chunk->next;
+        chunks_--;
+        if (spare_ == nullptr && chunk->size == pool_->chunk_size()) {
+            spare_ = chunk;
+        } else {
+            pool_->release(chunk);
+        }
+    }
+
+public:
+    explicit Arena(ChunkPool& pool = ChunkPool::global()) : pool_(&pool) {}
+
+    ~Arena() {
+        while (current_ != nullptr) drop_current();
+        if (spare_ != nullptr) pool_->release(spare_);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // size bytes at a power-of-two alignment; never null
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        char* block = align_up(top_, alignment);
+        if (size == 0) size = 1;
+        // Compared as addresses: alignment can push block past end_, and
+        // an empty arena has top_ == end_ == nullptr
+        if (reinterpret_cast<std::uintptr_t>(block) + size > reinterpret_cast<std::uintptr_t>(end_)) {
+            return grow(size, alignment);
+        }
+        top_ = block + size;
+        return block;
+    }
+
+    // Uninitialized storage for count Ts
+    template <typename T>
+    T* allocate_array(std::size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Gives back block if it is the last one allocated; otherwise nothing
+    void free_last(void* block, std::size_t size) {
+        if (static_cast<char*>(block) + (size == 0 ? 1 : size) == top_) top_ = static_cast<char*>(block);
+    }
+
+    Marker mark() const { return { current_, top_ }; }
+
+    // Frees everything allocated after marker was taken
+    void rewind(const Marker& marker) {
+        while (current_ != marker.chunk) drop_current();
+        top_ = marker.top;
+        end_ = current_ != nullptr ? current_->payload() + current_->size : nullptr;
+    }
+
+    // Frees everything
+    void reset() { rewind({ nullptr, nullptr }); }
+
+    std::size_t chunks() const { return chunks_; }
+    // Bytes between the start of the current chunk and the top
+    std::size_t used_in_chunk() const { return current_ != nullptr ? top_ - current_->payload() : 0; }
+};
+
+// Rewinds an arena to where it was when the scope began
+class ArenaScope {
+private:
+    Arena& arena_;
+    Arena::Marker marker_;
+
+public:
+    explicit ArenaScope(Arena& arena) : arena_(arena), marker_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(marker_); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+// This thread's arena on the global pool. Allocation takes no lock;
+// when the thread exits its chunks go back to the pool for other threads.
+inline Arena& thread_arena() {
+    thread_local Arena arena;
+    return arena;
+}
+
+// std::pmr adapter, so standard containers can allocate from an arena:
+// std::pmr::vector<int> v(&resource). Deallocation gives back only the
+// most recent block (a vector's last growth, a node just erased);
+// everything else waits for the arena's rewind.
+class ArenaResource : public std::pmr::memory_resource {
+private:
+    Arena& arena_;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override { return arena_.allocate(bytes, alignment); }
+
+    void do_deallocate(void* block, std::size_t bytes, std::size_t) override { arena_.free_last(block, bytes); }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    explicit ArenaResource(Arena& arena) : arena_(arena) {}
+
+    Arena& arena() { return arena_; }
+};
+
+#endif // ARENA_ALLOCATOR_HPP
@@ -0,0 +1,177 @@
+// array_geometry.hpp
+#ifndef ARRAY_GEOMETRY_HPP
+#define ARRAY_GEOMETRY_HPP
+
+#include "aligned_buffer.hpp"
+#include "steering.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Unit vector towards (azimuth, elevation) in radians. Broadside is +z;
+// azimuth turns towards +x and elevation towards +y, so u = cos(el)
+// sin(az) is the direction cosine along a linear array on the x axis, as
+// SteeringTable and AntennaArray use it.
+struct Direction {
+    double u;
+    double v;
+    double w;
+};
+
+inline Direction direction(double azimuth, double elevation) {
+    return { std::cos(elevation) * std::sin(azimuth), std::sin(elevation),
+             std::cos(elevation) * std::cos(azimuth) };
+}
+
+// Element positions of any array (linear, planar, conformal, or read from
+// a file) in wavelengths, as one aligned plane each for x, y, z and the
+// taper. The element count is a runtime value. Steering weights are
+// taper * exp(-2 pi i (d . p)) for the unit vector d towards the beam, a
+// dot product per element that steering_kernel_3d runs across the x, y
+// and z planes together. Element patterns are not modelled: on a
+// conformal array every element counts, including those facing away.
+class ArrayGeometry {
+private:
+    std::size_t elements_ = 0;
+    AlignedBuffer<float> x_;
+    AlignedBuffer<float> y_;
+    AlignedBuffer<float> z_;
+    AlignedBuffer<float> taper_;
+
+public:
+    ArrayGeometry() = default;
+
+    // elements at the origin, untapered; fill in with set()
+    explicit ArrayGeometry(std::size_t elements)
+        : elements_(elements), x_(elements), y_(elements), z_(elements), taper_(elements) {
+        for (std::size_t i = 0; i < elements; i++) taper_[i] = 1.0f;
+    }
+
+    // count elements along x, centred on the origin
+    static ArrayGeometry linear(std::size_t count, double spacing = 0.5) {
+        ArrayGeometry geometry(count);
+        for (std::size_t i = 0; i < count; i++) geometry.set(i, (i - (count - 1) / 2.0) * spacing, 0, 0);
+        return geometry;
+    }
+
+    // columns x rows grid in the x-y plane, centred, row by row
+    static ArrayGeometry planar(std::size_t columns, std::size_t rows, double spacing_x = 0.5,
+                                double spacing_y = 0.5) {
+        ArrayGeometry geometry(columns * rows);
+        for (std::size_t r = 0; r < rows; r++) {
+            for (std::size_t c = 0; c < columns; c++) {
+                geometry.set(r * columns + c, (c - (columns - 1) / 2.0) * spacing_x,
+                             (r - (rows - 1) / 2.0) * spacing_y, 0);
+            }
+        }
+        return geometry;
+    }
+
+    // Conformal: columns x rows on a cylinder of radius wavelengths with
+    // its axis along y, columns spacing apart along the arc and centred on
+    // broadside, so the middle column sits at the origin and the others
+    // curve back towards -z
+    static ArrayGeometry cylinder(std::size_t columns, std::size_t rows, double radius, double spacing = 0.5) {
+        ArrayGeometry geometry(columns * rows);
+        for (std::size_t r = 0; r < rows; r++) {
+            for (std::size_t c = 0; c < columns; c++) {
+                double angle = (c - (columns - 1) / 2.0) * spacing / radius;
+                geometry.set(r * columns + c, radius * std::sin(angle), (r - (rows - 1) / 2.0) * spacing,
+                             radius * (std::cos(angle) - 1));
+            }
+        }
+        return geometry;
+    }
+
+    // Reads "x y z [taper]" per line, in wavelengths; '#' starts a
+    // comment, and blank lines are skipped. False if the file cannot be
+    // read, a line does not parse or there are no elements.
+    static bool load(const char* path, ArrayGeometry& geometry) {
+        std::FILE* file = std::fopen(path, "r");
+        if (file == nullptr) return false;
+        std::vector<float> values[4];
+        char line[256];
+        bool ok = true;
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            if (char* comment = std::strchr(line, '#')) *comment = '\0';
+            double x, y, z, taper = 1;
+            int fields = std::sscanf(line, "%lf %lf %lf %lf", &x, &y, &z, &taper);
+            // EOF: nothing but blanks (or a comment); a line that starts
+            // with anything but a number gives 0 and is an error
+            if (fields == EOF) continue;
+            ok = fields >= 3;
+            if (!ok) break;
+            values[0].push_back(static_cast<float>(x));
+            values[1].push_back(static_cast<float>(y));
+            values[2].push_back(static_cast<float>(z));
+            values[3].push_back(static_cast<float>(taper));
+        }
+        std::fclose(file);
+        if (!ok || values[0].empty()) return false;
+        geometry = ArrayGeometry(values[0].size());
+        for (std::size_t i = 0; i < values[0].size(); i++) {
+            geometry.set(i, values[0][i], values[1][i], values[2][i]);
+            geometry.taper_[i] = values[3][i];
+        }
+        return true;
+    }
+
+    // An array from a configuration string: "linear:N", "planar:CxR",
+    // "cylinder:CxR:radius" (half-wavelength spacing), or a file for load()
+    static bool parse(const char* spec, ArrayGeometry& geometry) {
+        unsigned long columns = 0, rows = 0;
+        double radius = 0;
+        int used = 0;
+        if (std::sscanf(spec, "linear:%lu%n", &columns, &used) == 1 && spec[used] == '\0' && columns > 0) {
+            geometry = linear(columns);
+            return true;
+        }
+        if (std::sscanf(spec, "planar:%lux%lu%n", &columns, &rows, &used) == 2 && spec[used] == '\0' &&
+            columns > 0 && rows > 0) {
+            geometry = planar(columns, rows);
+            return true;
+        }
+        if (std::sscanf(spec, "cylinder:%lux%lu:%lf%n", &columns, &rows, &radius, &used) == 3 &&
+            spec[used] == '\0' && columns > 0 && rows > 0 && radius > 0) {
+            geometry = cylinder(columns, rows, radius);
+            return true;
+        }
+        return load(spec, geometry);
+    }
+
+    std::size_t size() const { return elements_; }
+    const float* x() const { return x_.data(); }
+    const float* y() const { return y_.data(); }
+    const float* z() const { return z_.data(); }
+    const float* taper() const { return taper_.data(); }
+    float* taper() { return taper_.data(); }
+
+    void set(std::size_t element, double x, double y, double z) {
+        x_[element] = static_cast<float>(x);
+        y_[element] = static_cast<float>(y);
+        z_[element] = static_cast<float>(z);
+    }
+
+    // Weights towards one direction into re/im
+    void steer(const Direction& d, float* re, float* im) const {
+        steering_kernel_3d(x_.data(), y_.data(), z_.data(), taper_.data(), elements_,
+                           static_cast<float>(-2 * M_PI * d.u), static_cast<float>(-2 * M_PI * d.v),
+                           static_cast<float>(-2 * M_PI * d.w), re, im);
+    }
+
+    // Complex weights for beams (azimuth, elevation) pairs in one call,
+    // beam-major like AntennaArray::steering_weights: beam b's weights are
+    // re/im[b * size(), (b + 1) * size())
+    void steering_weights(const float* azimuth, const float* elevation, std::size_t beams, float* re,
+                          float* im) const {
+        for (std::size_t b = 0; b < beams; b++) {
+            steer(direction(azimuth[b], elevation[b]), re + b * elements_, im + b * elements_);
+        }
+    }
+};
+
+#endif // ARRAY_GEOMETRY_HPP
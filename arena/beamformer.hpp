@@ -0,0 +1,167 @@
+// beamformer.hpp
+#ifndef BEAMFORMER_HPP
+#define BEAMFORMER_HPP
+
+#include "aligned_buffer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// Complex baseband samples of every element for one block of time, split
+// into real and imaginary planes, element-major: element e's samples are
+// [e * samples, (e + 1) * samples) of each plane
+struct SampleBlock {
+    std::size_t elements;
+    std::size_t samples;
+    AlignedBuffer<float> re;
+    AlignedBuffer<float> im;
+
+    SampleBlock(std::size_t elements, std::size_t samples)
+        : elements(elements), samples(samples), re(elements * samples), im(elements * samples) {}
+
+    float* element_re(std::size_t e) { return re.data() + e * samples; }
+    float* element_im(std::size_t e) { return im.data() + e * samples; }
+    const float* element_re(std::size_t e) const { return re.data() + e * samples; }
+    const float* element_im(std::size_t e) const { return im.data() + e * samples; }
+};
+
+// Delay-and-sum receive beamformer for B simultaneous beams: beam b at
+// sample s is sum over e of conj(w[b][e]) * x[e][s], a complex GEMM of the
+// [B x E] weights with the [E x S] samples. The product is blocked three
+// ways. Elements go in blocks of kElementBlock and samples in blocks of
+// kSampleBlock. Each input block is first packed tile by tile into a
+// contiguous 256 KB scratch buffer. Element rows of a sample block sit a
+// whole block length apart, so reading them in place made every load of
+// a tile map to the same L1 sets. The packed block stays in L2 while
+// every beam tile passes over it. The weights of a tile of kBeamTile
+// beams over one element block (4 KB) stay in L1. The micro-kernel keeps a
+// kBeamTile x kSampleTile output tile in registers across the element
+// block: per element it loads one vector of samples (re and im) and
+// broadcasts kBeamTile weights. form_beams reuses the scratch buffer, so
+// use one Beamformer per thread.
+class Beamformer {
+public:
+    static constexpr std::size_t kBeamTile = 4;
+    static constexpr std::size_t kSampleTile = 8;
+    static constexpr std::size_t kElementBlock = 128;
+    static constexpr std::size_t kSampleBlock = 256;
+
+private:
+    std::size_t elements_;
+    std::size_t beams_;
+    std::size_t tiles_;
+    // Conjugated weights, per beam tile and element: kBeamTile consecutive
+    // values, zero for padding beams
+    AlignedBuffer<float> packed_re_;
+    AlignedBuffer<float> packed_im_;
+    // One input block: per sample tile, per element, kSampleTile re then
+    // kSampleTile im
+    AlignedBuffer<float> block_;
+
+    // One kSampleTile-wide row of the output tile. GCC vector extensions
+    // rather than plain arrays: left to itself the vectorizer split the
+    // tile into 4-wide pieces and spilled the accumulators.
+    typedef float SampleVector __attribute__((vector_size(kSampleTile * sizeof(float))));
+
+    // Output tile of beams [b0, b0 + kBeamTile) and samples [s, s + kSampleTile)
+    // over elements [e0, e1), reading the packed samples x; adds to the
+    // output unless first is set
+    void micro_kernel(std::size_t tile, std::size_t e0, std::size_t e1, const float* x, std::size_t samples,
+                      std::size_t s, float* out_re, float* out_im, bool first) const {
+        SampleVector acc_re[kBeamTile] = {};
+        SampleVector acc_im[kBeamTile] = {};
+        const float* wr = packed_re_.data() + (tile * elements_ + e0) * kBeamTile;
+        const float* wi = packed_im_.data() + (tile * elements_ + e0) * kBeamTile;
+        for (std::size_t e = e0; e < e1; e++, wr += kBeamTile, wi += kBeamTile, x += 2 * kSampleTile) {
+            SampleVector xr, xi;
+            std::memcpy(&xr, x, sizeof(xr));
+            std::memcpy(&xi, x + kSampleTile, sizeof(xi));
+            for (std::size_t j = 0; j < kBeamTile; j++) {
+                acc_re[j] += wr[j] * xr - wi[j] * xi;
+                acc_im[j] += wr[j] * xi + wi[j] * xr;
+            }
+        }
+        std::size_t b0 = tile * kBeamTile;
+        for (std::size_t j = 0; j < kBeamTile && b0 + j < beams_; j++) {
+            float* yr = out_re + (b0 + j) * samples + s;
+            float* yi = out_im + (b0 + j) * samples + s;
+            if (!first) {
+                SampleVector old_re, old_im;
+                std::memcpy(&old_re, yr, sizeof(old_re));
+                std::memcpy(&old_im, yi, sizeof(old_im));
+                acc_re[j] += old_re;
+                acc_im[j] += old_im;
+            }
+            std::memcpy(yr, &acc_re[j], sizeof(acc_re[j]));
+            std::memcpy(yi, &acc_im[j], sizeof(acc_im[j]));
+        }
+    }
+
+    // Samples past the last full kSampleTile, one at a time
+    void tail(std::size_t s, const SampleBlock& in, float* out_re, float* out_im) const {
+        for (std::size_t b = 0; b < beams_; b++) {
+            const float* wr = packed_re_.data() + (b / kBeamTile) * elements_ * kBeamTile + b % kBeamTile;
+            const float* wi = packed_im_.data() + (b / kBeamTile) * elements_ * kBeamTile + b % kBeamTile;
+            float yr = 0, yi = 0;
+            for (std::size_t e = 0; e < elements_; e++) {
+                float xr = in.element_re(e)[s], xi = in.element_im(e)[s];
+                yr += wr[e * kBeamTile] * xr - wi[e * kBeamTile] * xi;
+                yi += wr[e * kBeamTile] * xi + wi[e * kBeamTile] * xr;
+            }
+            out_re[b * in.samples + s] = yr;
+            out_im[b * in.samples + s] = yi;
+        }
+    }
+
+public:
+    Beamformer(std::size_t elements, std::size_t beams)
+        : elements_(elements), beams_(beams), tiles_((beams + kBeamTile - 1) / kBeamTile),
+          packed_re_(tiles_ * elements * kBeamTile), packed_im_(tiles_ * elements * kBeamTile),
+          block_(2 * kElementBlock * kSampleBlock) {}
+
+    std::size_t elements() const { return elements_; }
+    std::size_t beams() const { return beams_; }
+
+    // Weights beam-major, [beams x elements], as AntennaArray::steering_weights writes them
+    void set_weights(const float* re, const float* im) {
+        for (std::size_t b = 0; b < beams_; b++) {
+            float* pr = packed_re_.data() + (b / kBeamTile) * elements_ * kBeamTile + b % kBeamTile;
+            float* pi = packed_im_.data() + (b / kBeamTile) * elements_ * kBeamTile + b % kBeamTile;
+            for (std::size_t e = 0; e < elements_; e++) {
+                pr[e * kBeamTile] = re[b * elements_ + e];
+                pi[e * kBeamTile] = -im[b * elements_ + e];
+            }
+        }
+    }
+
+    // Form all beams over one block; out planes are beam-major [beams x in.samples]
+    void form_beams(const SampleBlock& in, float* out_re, float* out_im) {
+        std::size_t full = in.samples - in.samples % kSampleTile;
+        for (std::size_t e0 = 0; e0 < elements_; e0 += kElementBlock) {
+            std::size_t e1 = std::min(e0 + kElementBlock, elements_);
+            for (std::size_t s0 = 0; s0 < full; s0 += kSampleBlock) {
+                std::size_t s1 = std::min(s0 + kSampleBlock, full);
+                // Read each element row in order; the tile-major writes
+                // are the scattered side
+                std::size_t tile_stride = 2 * kSampleTile * (e1 - e0);
+                for (std::size_t e = e0; e < e1; e++) {
+                    float* x = block_.data() + 2 * kSampleTile * (e - e0);
+                    for (std::size_t s = s0; s < s1; s += kSampleTile, x += tile_stride) {
+                        std::memcpy(x, in.element_re(e) + s, kSampleTile * sizeof(float));
+                        std::memcpy(x + kSampleTile, in.element_im(e) + s, kSampleTile * sizeof(float));
+                    }
+                }
+                for (std::size_t tile = 0; tile < tiles_; tile++) {
+                    const float* x = block_.data();
+                    for (std::size_t s = s0; s < s1; s += kSampleTile, x += tile_stride) {
+                        micro_kernel(tile, e0, e1, x, in.samples, s, out_re, out_im, e0 == 0);
+                    }
+                }
+            }
+        }
+        for (std::size_t s = full; s < in.samples; s++) tail(s, in, out_re, out_im);
+    }
+};
+
+#endif // BEAMFORMER_HPP
@@ -0,0 +1,253 @@
+// fft.hpp
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include "aligned_buffer.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// In-place complex FFT of one power-of-two size on split real/imaginary
+// planes, like the rest of the array code. The forward transform is
+// decimation in frequency, radix-4 with one leading radix-2 stage when
+// log2(size) is odd, and leaves the spectrum in bit-reversed order; the
+// inverse is the matching decimation in time and takes bit-reversed input.
+// Fast convolution and per-bin weighting do not care about bin order, so
+// they use the _scrambled pair and skip the permutation altogether;
+// scrambled_bin(p) says which bin sits at position p. Every butterfly
+// loop runs over k with contiguous twiddles, which GCC vectorizes, except
+// the last radix-4 stage, whose twiddles are all 1. inverse is
+// unnormalized: it returns size times the input, so fold 1/size into
+// whatever weights are applied between the two transforms.
+class FftPlan {
+private:
+    std::size_t size_;
+    unsigned log2_;
+    // Per stage, largest first: radix-2 stages hold w^k as two planes of
+    // length / 2; radix-4 stages hold w^k, w^2k, w^3k as six planes of
+    // length / 4 (re, im, re, im, re, im), with w = exp(-2 pi i / length)
+    AlignedBuffer<float> twiddles_;
+    std::vector<std::size_t> stage_offsets_;
+    std::vector<std::uint32_t> bit_reverse_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> swaps_;
+
+    static void radix2_forward(float* __restrict ar, float* __restrict ai, float* __restrict cr,
+                               float* __restrict ci, const float* __restrict w, std::size_t h) {
+        const float* wr = w;
+        const float* wi = w + h;
+        for (std::size_t k = 0; k < h; k++) {
+            float dr = ar[k] - cr[k], di = ai[k] - ci[k];
+            ar[k] += cr[k];
+            ai[k] += ci[k];
+            cr[k] = dr * wr[k] - di * wi[k];
+            ci[k] = dr * wi[k] + di * wr[k];
+        }
+    }
+
+    static void radix2_inverse(float* __restrict ar, float* __restrict ai, float* __restrict cr,
+                               float* __restrict ci, const float* __restrict w, std::size_t h) {
+        const float* wr = w;
+        const float* wi = w + h;
+        for (std::size_t k = 0; k < h; k++) {
+            float qr = cr[k] * wr[k] + ci[k] * wi[k];
+            float qi = ci[k] * wr[k] - cr[k] * wi[k];
+            cr[k] = ar[k] - qr;
+            ci[k] = ai[k] - qi;
+            ar[k] += qr;
+            ai[k] += qi;
+        }
+    }
+
+    // Quarters a, b, c, d of one block; a radix-4 butterfly is two radix-2
+    // stages fused, so the outputs land in the same bit-reversed places
+    static void radix4_forward(float* __restrict ar, float* __restrict ai, float* __restrict br,
+                               float* __restrict bi, float* __restrict cr, float* __restrict ci,
+                               float* __restrict dr, float* __restrict di, const float* __restrict w,
+                               std::size_t q) {
+        const float *w1r = w, *w1i = w + q, *w2r = w + 2 * q, *w2i = w + 3 * q, *w3r = w + 4 * q,
+                    *w3i = w + 5 * q;
+        for (std::size_t k = 0; k < q; k++) {
+            float t0r = ar[k] + cr[k], t0i = ai[k] + ci[k];
+            float t1r = ar[k] - cr[k], t1i = ai[k] - ci[k];
+            float t2r = br[k] + dr[k], t2i = bi[k] + di[k];
+            float t3r = bi[k] - di[k], t3i = dr[k] - br[k]; // (b - d) * -i
+            float y1r = t0r - t2r, y1i = t0i - t2i;
+            float y2r = t1r + t3r, y2i = t1i + t3i;
+            float y3r = t1r - t3r, y3i = t1i - t3i;
+            ar[k] = t0r + t2r;
+            ai[k] = t0i + t2i;
+            br[k] = y1r * w2r[k] - y1i * w2i[k];
+            bi[k] = y1r * w2i[k] + y1i * w2r[k];
+            cr[k] = y2r * w1r[k] - y2i * w1i[k];
+            ci[k] = y2r * w1i[k] + y2i * w1r[k];
+            dr[k] = y3r * w3r[k] - y3i * w3i[k];
+            di[k] = y3r * w3i[k] + y3i * w3r[k];
+        }
+    }
+
+    static void radix4_inverse(float* __restrict ar, float* __restrict ai, float* __restrict br,
+                               float* __restrict bi, float* __restrict cr, float* __restrict ci,
+                               float* __restrict dr, float* __restrict di, const float* __restrict w,
+                               std::size_t q) {
+        const float *w1r = w, *w1i = w + q, *w2r = w + 2 * q, *w2i = w + 3 * q, *w3r = w + 4 * q,
+                    *w3i = w + 5 * q;
+        for (std::size_t k = 0; k < q; k++) {
+            // Undo the twiddles with their conjugates, then the butterfly
+            float qr = br[k] * w2r[k] + bi[k] * w2i[k], qi = bi[k] * w2r[k] - br[k] * w2i[k];
+            float rr = cr[k] * w1r[k] + ci[k] * w1i[k], ri = ci[k] * w1r[k] - cr[k] * w1i[k];
+            float sr = dr[k] * w3r[k] + di[k] * w3i[k], si = di[k] * w3r[k] - dr[k] * w3i[k];
+            float pqr = ar[k] + qr, pqi = ai[k] + qi;
+            float mqr = ar[k] - qr, mqi = ai[k] - qi;
+            float rsr = rr + sr, rsi = ri + si;
+            float mrsr = rr - sr, mrsi = ri - si;
+            ar[k] = pqr + rsr;
+            ai[k] = pqi + rsi;
+            cr[k] = pqr - rsr;
+            ci[k] = pqi - rsi;
+            br[k] = mqr - mrsi; // + i * (R - S)
+            bi[k] = mqi + mrsr;
+            dr[k] = mqr + mrsi;
+            di[k] = mqi - mrsr;
+        }
+    }
+
+    // Length-4 blocks, where every twiddle is 1
+    static void last_stage_forward(float* __restrict re, float* __restrict im, std::size_t size) {
+        for (std::size_t j = 0; j < size; j += 4) {
+            float t0r = re[j] + re[j + 2], t0i = im[j] + im[j + 2];
+            float t1r = re[j] - re[j + 2], t1i = im[j] - im[j + 2];
+            float t2r = re[j + 1] + re[j + 3], t2i = im[j + 1] + im[j + 3];
+            float t3r = im[j + 1] - im[j + 3], t3i = re[j + 3] - re[j + 1];
+            re[j] = t0r + t2r;
+            im[j] = t0i + t2i;
+            re[j + 1] = t0r - t2r;
+            im[j + 1] = t0i - t2i;
+            re[j + 2] = t1r + t3r;
+            im[j + 2] = t1i + t3i;
+            re[j + 3] = t1r - t3r;
+            im[j + 3] = t1i - t3i;
+        }
+    }
+
+    static void first_stage_inverse(float* __restrict re, float* __restrict im, std::size_t size) {
+        for (std::size_t j = 0; j < size; j += 4) {
+            float pqr = re[j] + re[j + 1], pqi = im[j] + im[j + 1];
+            float mqr = re[j] - re[j + 1], mqi = im[j] - im[j + 1];
+            float rsr = re[j + 2] + re[j + 3], rsi = im[j + 2] + im[j + 3];
+            float mrsr = re[j + 2] - re[j + 3], mrsi = im[j + 2] - im[j + 3];
+            re[j] = pqr + rsr;
+            im[j] = pqi + rsi;
+            re[j + 2] = pqr - rsr;
+            im[j + 2] = pqi - rsi;
+            re[j + 1] = mqr - mrsi;
+            im[j + 1] = mqi + mrsr;
+            re[j + 3] = mqr + mrsi;
+            im[j + 3] = mqi - mrsr;
+        }
+    }
+
+    bool leading_radix2() const { return log2_ % 2 == 1; }
+
+public:
+    // size must be a power of two
+    explicit FftPlan(std::size_t size) : size_(size), log2_(0), bit_reverse_(size) {
+        while ((std::size_t(1) << log2_) < size_) log2_++;
+        std::vector<float> twiddles;
+        auto add_twiddles = [&](std::size_t length, std::size_t count, unsigned powers) {
+            stage_offsets_.push_back(twiddles.size());
+            for (unsigned p = 1; p <= powers; p++) {
+                std::size_t re = twiddles.size();
+                twiddles.resize(re + 2 * count);
+                for (std::size_t k = 0; k < count; k++) {
+                    double angle = -2 * M_PI * static_cast<double>(p * k) / length;
+                    twiddles[re + k] = static_cast<float>(std::cos(angle));
+                    twiddles[re + count + k] = static_cast<float>(std::sin(angle));
+                }
+            }
+        };
+        std::size_t length = size_;
+        if (leading_radix2()) {
+            add_twiddles(length, length / 2, 1);
+            length /= 2;
+        }
+        for (; length > 4; length /= 4) add_twiddles(length, length / 4, 3);
+        twiddles_ = AlignedBuffer<float>(twiddles.size());
+        for (std::size_t i = 0; i < twiddles.size(); i++) twiddles_[i] = twiddles[i];
+
+        for (std::size_t i = 0; i < size_; i++) {
+            std::uint32_t r = 0;
+            for (unsigned b = 0; b < log2_; b++) r |= ((i >> b) & 1u) << (log2_ - 1 - b);
+            bit_reverse_[i] = r;
+            if (i < r) swaps_.emplace_back(static_cast<std::uint32_t>(i), r);
+        }
+    }
+
+    std::size_t size() const { return size_; }
+
+    // The bin that forward_scrambled leaves at position p
+    std::size_t scrambled_bin(std::size_t p) const { return bit_reverse_[p]; }
+
+    // Natural-order input, bit-reversed spectrum
+    void forward_scrambled(float* re, float* im) const {
+        if (size_ < 2) return;
+        std::size_t length = size_, stage = 0;
+        if (leading_radix2()) {
+            std::size_t h = length / 2;
+            const float* w = twiddles_.data() + stage_offsets_[stage++];
+            for (std::size_t j = 0; j < size_; j += length) radix2_forward(re + j, im + j, re + j + h, im + j + h, w, h);
+            length = h;
+        }
+        for (; length > 4; length /= 4) {
+            std::size_t q = length / 4;
+            const float* w = twiddles_.data() + stage_offsets_[stage++];
+            for (std::size_t j = 0; j < size_; j += length) {
+                radix4_forward(re + j, im + j, re + j + q, im + j + q, re + j + 2 * q, im + j + 2 * q,
+                               re + j + 3 * q, im + j + 3 * q, w, q);
+            }
+        }
+        if (length == 4) last_stage_forward(re, im, size_);
+    }
+
+    // Bit-reversed spectrum, natural-order output scaled by size()
+    void inverse_scrambled(float* re, float* im) const {
+        if (size_ < 2) return;
+        std::size_t top = leading_radix2() ? size_ / 2 : size_;
+        std::size_t stage = stage_offsets_.size();
+        if (top >= 4) first_stage_inverse(re, im, size_);
+        for (std::size_t length = 16; length <= top; length *= 4) {
+            std::size_t q = length / 4;
+            const float* w = twiddles_.data() + stage_offsets_[--stage];
+            for (std::size_t j = 0; j < size_; j += length) {
+                radix4_inverse(re + j, im + j, re + j + q, im + j + q, re + j + 2 * q, im + j + 2 * q,
+                               re + j + 3 * q, im + j + 3 * q, w, q);
+            }
+        }
+        if (leading_radix2()) {
+            std::size_t h = size_ / 2;
+            radix2_inverse(re, im, re + h, im + h, twiddles_.data() + stage_offsets_[0], h);
+        }
+    }
+
+    void bit_reverse(float* re, float* im) const {
+        for (const auto& swap : swaps_) {
+            std::swap(re[swap.first], re[swap.second]);
+            std::swap(im[swap.first], im[swap.second]);
+        }
+    }
+
+    // Natural order both ways
+    void forward(float* re, float* im) const {
+        forward_scrambled(re, im);
+        bit_reverse(re, im);
+    }
+
+    void inverse(float* re, float* im) const {
+        bit_reverse(re, im);
+        inverse_scrambled(re, im);
+    }
+};
+
+#endif // FFT_HPP
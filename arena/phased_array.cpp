@@ -1,55 +1,1140 @@
-#include <array>
+#include "aligned_buffer.hpp"
+#include "arena_allocator.hpp"
+#include "array_geometry.hpp"
+#include "beamformer.hpp"
+#include "phased_array.hpp"
+#include "pulse_compression.hpp"
+#include "pulse_scheduler.hpp"
+#include "range_doppler.hpp"
+#include "receive_pipeline.hpp"
+#include "scene_simulator.hpp"
+#include "steering_table.hpp"
+#include "wideband_beamformer.hpp"
+
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the program goes through these, counted, so
+// the pipeline bench can show its steady state allocates nothing
+static std::atomic<std::size_t> heap_allocations{ 0 };
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(std::size_t size, std::align_val_t align) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (posix_memalign(&p, std::max(static_cast<std::size_t>(align), sizeof(void*)), size ? size : 1) == 0) return p;
+    throw std::bad_alloc();
+}
+
+// All out of line, or GCC matches the malloc/free inside against new/delete
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Scalar reference: double-precision sin/cos per element, as the original
+// per-element loop did
+template <std::size_t N>
+static void scalar_weights(const AntennaArray<N>& array, const float* angles, std::size_t num_beams, float* re,
+                           float* im) {
+    for (std::size_t b = 0; b < num_beams; b++) {
+        double k = -2 * M_PI * std::sin(angles[b]);
+        for (std::size_t i = 0; i < N; i++) {
+            double phase = k * array.elements.position[i];
+            re[b * N + i] = static_cast<float>(array.elements.taper[i] * std::cos(phase));
+            im[b * N + i] = static_cast<float>(array.elements.taper[i] * std::sin(phase));
+        }
+    }
+}
+
+// Weights for beams directions spread over +/-60 degrees azimuth and
+// +/-30 elevation on any geometry: the SoA dot-product kernel, the same
+// kernel over an array of {x, y, z, taper} structs, and double sin/cos
+// per element. Reports weights per second and the largest error.
+static void bench_geometry(std::size_t beams, const ArrayGeometry& geometry, const char* spec) {
+    const std::size_t n = geometry.size();
+    AlignedBuffer<float> azimuth(beams), elevation(beams), re(beams * n), im(beams * n);
+    for (std::size_t b = 0; b < beams; b++) {
+        azimuth[b] = static_cast<float>((-60.0 + 120.0 * (b % 16) / 15) * M_PI / 180);
+        elevation[b] = static_cast<float>((-30.0 + 60.0 * (b / 16) / std::max<std::size_t>(1, (beams - 1) / 16)) *
+                                          M_PI / 180);
+    }
+    struct Element {
+        float x, y, z, taper;
+    };
+    std::vector<Element> packed(n);
+    for (std::size_t i = 0; i < n; i++) packed[i] = { geometry.x()[i], geometry.y()[i], geometry.z()[i], geometry.taper()[i] };
+
+    auto time = [&](auto&& compute) {
+        std::size_t calls = 0;
+        double elapsed;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            compute();
+            calls++;
+        } while ((elapsed = seconds_since(start)) < 0.5);
+        return elapsed / calls;
+    };
+    double soa = time([&] { geometry.steering_weights(azimuth.data(), elevation.data(), beams, re.data(), im.data()); });
+    AlignedBuffer<float> aos_re(beams * n), aos_im(beams * n);
+    double aos = time([&] {
+        for (std::size_t b = 0; b < beams; b++) {
+            Direction d = direction(azimuth[b], elevation[b]);
+            float kx = static_cast<float>(-2 * M_PI * d.u), ky = static_cast<float>(-2 * M_PI * d.v),
+                  kz = static_cast<float>(-2 * M_PI * d.w);
+            float* __restrict wr = aos_re.data() + b * n;
+            float* __restrict wi = aos_im.data() + b * n;
+            const Element* __restrict e = packed.data();
+            for (std::size_t i = 0; i < n; i++) {
+                SinCos w = fast_sincos(kx * e[i].x + ky * e[i].y + kz * e[i].z);
+                wr[i] = e[i].taper * w.cos;
+                wi[i] = e[i].taper * w.sin;
+            }
+        }
+    });
+    AlignedBuffer<float> ref_re(beams * n), ref_im(beams * n);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t b = 0; b < beams; b++) {
+        Direction d = direction(azimuth[b], elevation[b]);
+        for (std::size_t i = 0; i < n; i++) {
+            double phase = -2 * M_PI * (d.u * packed[i].x + d.v * packed[i].y + d.w * packed[i].z);
+            ref_re[b * n + i] = static_cast<float>(packed[i].taper * std::cos(phase));
+            ref_im[b * n + i] = static_cast<float>(packed[i].taper * std::sin(phase));
+        }
+    }
+    double scalar = seconds_since(start);
+    double max_error = 0;
+    for (std::size_t i = 0; i < beams * n; i++) {
+        max_error = std::fmax(max_error, std::hypot(re[i] - ref_re[i], im[i] - ref_im[i]));
+        max_error = std::fmax(max_error, std::hypot(aos_re[i] - ref_re[i], aos_im[i] - ref_im[i]));
+    }
+    double weights = double(beams) * n;
+    std::printf("%s, %zu elements, %zu beams: SoA kernel %.2f ms (%.0f Mweights/s, %.0f beams/s),"
+                " array of structs %.2f ms (%.1fx slower), double sin/cos %.2f ms (%.0fx slower); max error %.1e\n",
+                spec, n, beams, soa * 1e3, weights / soa / 1e6, beams / soa, aos * 1e3, aos / soa, scalar * 1e3,
+                scalar / soa, max_error);
+}
+
+// Beams per second for steering weight computation, num_beams angles per
+// call, against the scalar loop; also reports the largest weight error
+template <std::size_t N>
+static void bench_steering(std::size_t num_beams) {
+    auto array = std::make_unique<AntennaArray<N>>();
+    AlignedBuffer<float> angles(num_beams), re(num_beams * N), im(num_beams * N), ref_re(num_beams * N),
+        ref_im(num_beams * N);
+    for (std::size_t b = 0; b < num_beams; b++) {
+        angles[b] = static_cast<float>((-60.0 + 120.0 * b / num_beams) * M_PI / 180);
+    }
+
+    auto time_beams = [&](auto&& compute) {
+        std::size_t calls = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed;
+        do {
+            compute();
+            calls++;
+        } while ((elapsed = seconds_since(start)) < 0.3);
+        return calls * num_beams / elapsed;
+    };
+    double fast = time_beams([&] { array->steering_weights(angles.data(), num_beams, re.data(), im.data()); });
+    double scalar = time_beams([&] { scalar_weights(*array, angles.data(), num_beams, ref_re.data(), ref_im.data()); });
+    float max_error = 0;
+    for (std::size_t i = 0; i < num_beams * N; i++) {
+        max_error = std::fmax(max_error, std::fabs(re[i] - ref_re[i]));
+        max_error = std::fmax(max_error, std::fabs(im[i] - ref_im[i]));
+    }
+    std::printf("%6zu elements: %10.0f beams/s (%7.2f Gweights/s), scalar %9.0f beams/s, %5.1fx; max error %.1e\n", N,
+                fast, fast * N / 1e9, scalar, fast / scalar, max_error);
+}
+
+// Steering table for a 1024-element array over azimuth -60 ... 60 degrees
+// in 1 degree steps and elevation 0 ... 30 in 2: cost of building it
+// (eagerly and by first use), of a node lookup, of an interpolated
+// off-grid steer, and of computing one beam's weights on the fly. Apart
+// from the bare pointer, every variant leaves the weights in a caller
+// buffer, so the lookups pay for reading the table.
+static void bench_steering_table(std::size_t fine_steps) {
+    const std::size_t N = 1024, lookups = 1 << 16;
+    auto array = std::make_unique<AntennaArray<N>>();
+    const float* position = array->elements.position.data();
+    const float* taper = array->elements.taper.data();
+    const double degree = M_PI / 180;
+    AngleGrid azimuth{ -60 * degree, 1 * degree, 121 }, elevation{ 0, 2 * degree, 16 };
+
+    auto start = std::chrono::steady_clock::now();
+    SteeringTable table(position, taper, N, azimuth, elevation, fine_steps);
+    double ramps_seconds = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    table.fill_all();
+    double fill_seconds = seconds_since(start);
+    std::printf("%zu elements, %zu x %zu grid: %.1f MB, construction with ramps %.1f ms, full build %.1f ms"
+                " (%.2f us per node)\n",
+                N, azimuth.count, elevation.count, table.table_bytes() / 1e6, ramps_seconds * 1e3, fill_seconds * 1e3,
+                fill_seconds / table.nodes() * 1e6);
+
+    std::mt19937 rng(17);
+    std::vector<std::pair<std::size_t, std::size_t>> nodes(lookups);
+    std::vector<std::pair<double, double>> directions(lookups);
+    std::uniform_real_distribution<double> az(-60 * degree, 60 * degree), el(0, 30 * degree);
+    for (std::size_t i = 0; i < lookups; i++) {
+        nodes[i] = { rng() % azimuth.count, rng() % elevation.count };
+        directions[i] = { az(rng), el(rng) };
+    }
+    AlignedBuffer<float> re(N), im(N);
+    auto copy = [&](const float* w) {
+        std::memcpy(re.data(), w, N * sizeof(float));
+        std::memcpy(im.data(), w + N, N * sizeof(float));
+    };
+    auto per_call = [&](auto&& call) {
+        volatile float sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < lookups; i++) sink = sink + call(i);
+        return seconds_since(start) / lookups;
+    };
+
+    double pointer = per_call([&](std::size_t i) { return table.weights(nodes[i].first, nodes[i].second)[i % N]; });
+    double lookup = per_call([&](std::size_t i) {
+        copy(table.weights(nodes[i].first, nodes[i].second));
+        return re[i % N];
+    });
+    double interpolated = per_call([&](std::size_t i) {
+        table.steer(directions[i].first, directions[i].second, re.data(), im.data());
+        return re[i % N];
+    });
+    double computed = per_call([&](std::size_t i) {
+        float k = static_cast<float>(-2 * M_PI * std::cos(directions[i].second) * std::sin(directions[i].first));
+        steering_kernel(position, taper, N, k, re.data(), im.data());
+        return re[i % N];
+    });
+    double scalar = per_call([&](std::size_t i) {
+        double k = -2 * M_PI * std::cos(directions[i].second) * std::sin(directions[i].first);
+        for (std::size_t e = 0; e < N; e++) {
+            re[e] = static_cast<float>(taper[e] * std::cos(k * position[e]));
+            im[e] = static_cast<float>(taper[e] * std::sin(k * position[e]));
+        }
+        return re[i % N];
+    });
+
+    SteeringTable lazy(position, taper, N, azimuth, elevation, fine_steps);
+    double first_use = per_call([&](std::size_t i) {
+        copy(lazy.weights(nodes[i].first, nodes[i].second));
+        return re[i % N];
+    });
+
+    double max_error = 0;
+    for (std::size_t i = 0; i < 4096; i++) {
+        table.steer(directions[i].first, directions[i].second, re.data(), im.data());
+        double k = -2 * M_PI * std::cos(directions[i].second) * std::sin(directions[i].first);
+        for (std::size_t e = 0; e < N; e++) {
+            std::complex<double> exact = std::polar(double(taper[e]), k * position[e]);
+            max_error = std::fmax(max_error, std::abs(std::complex<double>(re[e], im[e]) - exact));
+        }
+    }
+    std::printf("  node pointer %.3f us, node lookup + copy %.3f us, first use (lazy fill, %zu of %zu nodes) %.3f us\n",
+                pointer * 1e6, lookup * 1e6, lazy.filled(), lazy.nodes(), first_use * 1e6);
+    std::printf("  off-grid steer (node x %zu-step ramps) %.3f us, max error %.1e\n", fine_steps, interpolated * 1e6,
+                max_error);
+    std::printf("  on the fly: fast_sincos %.3f us (%.1fx the lookup), double sin/cos %.3f us (%.0fx)\n",
+                computed * 1e6, computed / lookup, scalar * 1e6, scalar / lookup);
+}
+
+// Matched filtering of one coherent processing interval: pulses receive
+// windows of samples range bins each, holding echoes of the array's
+// pulse_duration LFM pulse (50 MHz swept, 100 MHz sampling) from three
+// targets in noise of power 0.1. Range bins per second and CPI latency
+// for a few FFT sizes, against direct correlation; checks the targets
+// come out at their delays.
+static void bench_compression(std::size_t samples, std::size_t pulses) {
+    AntennaArray<16> array;
+    array.pulse_duration = 10e-6;
+    const double sample_rate = 100e6, bandwidth = 50e6;
+    const std::size_t length = static_cast<std::size_t>(array.pulse_duration * sample_rate);
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, bandwidth, sample_rate, chirp_re.data(), chirp_im.data());
+
+    const std::size_t delays[3] = { samples / 8, samples / 2, samples / 2 + 40 };
+    const double amplitudes[3] = { 0.5, 0.1, 0.05 };
+    AlignedBuffer<float> in_re(pulses * samples), in_im(pulses * samples);
+    std::mt19937 rng(21);
+    std::normal_distribution<float> gauss(0.0f, std::sqrt(0.05f));
+    for (std::size_t i = 0; i < pulses * samples; i++) {
+        in_re[i] = gauss(rng);
+        in_im[i] = gauss(rng);
+    }
+    for (std::size_t p = 0; p < pulses; p++) {
+        for (std::size_t t = 0; t < 3; t++) {
+            // A slow target: a small phase step from pulse to pulse
+            std::complex<double> echo = std::polar(amplitudes[t], 0.3 * t * p);
+            for (std::size_t k = 0; k < length && delays[t] + k < samples; k++) {
+                std::complex<double> x = echo * std::complex<double>(chirp_re[k], chirp_im[k]);
+                in_re[p * samples + delays[t] + k] += static_cast<float>(x.real());
+                in_im[p * samples + delays[t] + k] += static_cast<float>(x.imag());
+            }
+        }
+    }
+    AlignedBuffer<float> out_re(pulses * samples), out_im(pulses * samples);
+    std::printf("%zu-sample pulse, %zu range bins x %zu pulses per CPI:\n", length, samples, pulses);
+
+    // Direct correlation on a couple of pulses, as the reference and the
+    // baseline rate; vectorized over range bins, one tap at a time
+    const std::size_t direct_pulses = std::min<std::size_t>(pulses, 2);
+    AlignedBuffer<float> direct_re(direct_pulses * samples), direct_im(direct_pulses * samples);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t p = 0; p < direct_pulses; p++) {
+        float* __restrict yr = direct_re.data() + p * samples;
+        float* __restrict yi = direct_im.data() + p * samples;
+        for (std::size_t k = 0; k < length; k++) {
+            const float* __restrict xr = in_re.data() + p * samples + k;
+            const float* __restrict xi = in_im.data() + p * samples + k;
+            float cr = chirp_re[k], ci = chirp_im[k];
+            for (std::size_t n = 0; n + k < samples; n++) {
+                yr[n] += xr[n] * cr + xi[n] * ci;
+                yi[n] += xi[n] * cr - xr[n] * ci;
+            }
+        }
+    }
+    double direct_rate = direct_pulses * samples / seconds_since(start);
+    std::printf("  direct correlation       %8.2f Mbins/s\n", direct_rate / 1e6);
+
+    std::size_t best = PulseCompressor::best_fft_size(length);
+    for (std::size_t fft_size : { 2048, 4096, 8192, 16384, 32768 }) {
+        PulseCompressor compressor(chirp_re.data(), chirp_im.data(), length, fft_size);
+        std::size_t calls = 0;
+        double elapsed, worst = 0;
+        start = std::chrono::steady_clock::now();
+        do {
+            auto cpi_start = std::chrono::steady_clock::now();
+            compressor.compress_cpi(in_re.data(), in_im.data(), pulses, samples, out_re.data(), out_im.data());
+            worst = std::fmax(worst, seconds_since(cpi_start));
+            calls++;
+        } while ((elapsed = seconds_since(start)) < 0.5);
+        double max_error = 0;
+        for (std::size_t i = 0; i < direct_pulses * samples; i++) {
+            max_error = std::fmax(max_error, std::hypot(out_re[i] - direct_re[i], out_im[i] - direct_im[i]));
+        }
+        std::printf("  FFT %5zu%s (hop %5zu) %8.2f Mbins/s (%.0fx), CPI latency %.2f ms mean, %.2f ms worst;"
+                    " max error %.1e\n",
+                    fft_size, fft_size == best ? "*" : " ", compressor.hop(), calls * pulses * samples / elapsed / 1e6,
+                    calls * pulses * samples / elapsed / direct_rate, elapsed / calls * 1e3, worst * 1e3, max_error);
+    }
+
+    // Peaks at the target delays with |amplitude| * length, above a noise
+    // floor of sqrt(0.1 * length)
+    for (std::size_t t = 0; t < 3; t++) {
+        std::size_t peak = delays[t] - 8;
+        for (std::size_t n = delays[t] - 8; n <= delays[t] + 8; n++) {
+            if (std::hypot(out_re[n], out_im[n]) > std::hypot(out_re[peak], out_im[peak])) peak = n;
+        }
+        std::printf("  target at bin %5zu: peak at bin %5zu, |peak| %6.1f (expected %.1f, noise %.1f)\n", delays[t],
+                    peak, std::hypot(out_re[peak], out_im[peak]), amplitudes[t] * length, std::sqrt(0.1 * length));
+    }
+    std::printf("  (* = best_fft_size for this pulse)\n");
+}
+
+// CA-CFAR the direct way, summing every training window cell by cell;
+// same rules as RangeDopplerProcessor::detect
+static void direct_cfar(const float* power, std::size_t bins, std::size_t pulses, const CfarConfig& cfar,
+                        std::vector<Detection>& detections) {
+    const long outer_r = long(cfar.guard_range + cfar.training_range);
+    const long outer_d = long(cfar.guard_doppler + cfar.training_doppler);
+    for (long r = 0; r < long(bins); r++) {
+        for (long d = 0; d < long(pulses); d++) {
+            double training = 0;
+            std::size_t cells = 0;
+            for (long i = std::max(0L, r - outer_r); i <= std::min(long(bins) - 1, r + outer_r); i++) {
+                for (long j = std::max(0L, d - outer_d); j <= std::min(long(pulses) - 1, d + outer_d); j++) {
+                    if (std::labs(i - r) <= long(cfar.guard_range) && std::labs(j - d) <= long(cfar.guard_doppler)) {
+                        continue;
+                    }
+                    training += power[i * pulses + j];
+                    cells++;
+                }
+            }
+            float cut = power[r * pulses + d];
+            if (cut <= cfar.scale() * (training / cells)) continue;
+            bool peak = true;
+            for (long i = std::max(0L, r - 1); i <= std::min(long(bins) - 1, r + 1); i++) {
+                for (long j = std::max(0L, d - 1); j <= std::min(long(pulses) - 1, d + 1); j++) {
+                    if (power[i * pulses + j] > cut) peak = false;
+                }
+            }
+            if (peak) detections.push_back({ std::size_t(r), std::size_t(d), cut, float(training / cells) });
+        }
+    }
+}
+
+// Range-Doppler processing of one CPI of pulses x bins: echoes of a
+// 1000-sample LFM pulse from five targets at various ranges and Doppler
+// bins in unit noise, pulse compressed (Hamming-weighted reference), then
+// corner turn, Doppler FFT and CA-CFAR at Pfa 1e-6. Times each stage
+// against its straightforward form and checks every target is detected.
+static void bench_range_doppler(std::size_t bins, std::size_t pulses) {
+    const std::size_t length = 1000;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, 50e6, 100e6, chirp_re.data(), chirp_im.data());
+    struct Target {
+        std::size_t range;
+        long doppler;       // bins from zero Doppler
+        double amplitude;
+    };
+    const Target targets[5] = { { bins / 10, 5, 0.05 },
+                                { bins / 3, -12, 0.04 },
+                                { bins / 3 + 6, 3, 0.04 },
+                                { bins / 2, 0, 0.1 },
+                                { bins * 3 / 4, long(pulses / 4), 0.035 } };
+    AlignedBuffer<float> raw_re(pulses * bins), raw_im(pulses * bins);
+    std::mt19937 rng(31);
+    std::normal_distribution<float> gauss(0.0f, std::sqrt(0.5f));
+    for (std::size_t i = 0; i < pulses * bins; i++) {
+        raw_re[i] = gauss(rng);
+        raw_im[i] = gauss(rng);
+    }
+    for (const Target& target : targets) {
+        for (std::size_t p = 0; p < pulses; p++) {
+            std::complex<double> echo = std::polar(target.amplitude, 2 * M_PI * target.doppler * double(p) / pulses);
+            for (std::size_t k = 0; k < length && target.range + k < bins; k++) {
+                std::complex<double> x = echo * std::complex<double>(chirp_re[k], chirp_im[k]);
+                raw_re[p * bins + target.range + k] += static_cast<float>(x.real());
+                raw_im[p * bins + target.range + k] += static_cast<float>(x.imag());
+            }
+        }
+    }
+    AlignedBuffer<float> cpi_re(pulses * bins), cpi_im(pulses * bins);
+    PulseCompressor compressor(chirp_re.data(), chirp_im.data(), length, 0, true);
+    compressor.compress_cpi(raw_re.data(), raw_im.data(), pulses, bins, cpi_re.data(), cpi_im.data());
+
+    RangeDopplerProcessor processor(pulses, bins);
+    std::vector<Detection> detections;
+    detections.reserve(1024);
+    auto time = [](auto&& stage) {
+        std::size_t calls = 0;
+        double elapsed;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            stage();
+            calls++;
+        } while ((elapsed = seconds_since(start)) < 0.3);
+        return elapsed / calls;
+    };
+    AlignedBuffer<float> turned(pulses * bins);
+    double blocked = time([&] { corner_turn(cpi_re.data(), pulses, bins, turned.data()); });
+    double naive = time([&] {
+        for (std::size_t p = 0; p < pulses; p++) {
+            for (std::size_t r = 0; r < bins; r++) turned[r * pulses + p] = cpi_re[p * bins + r];
+        }
+    });
+    double map = time([&] { processor.form_map(cpi_re.data(), cpi_im.data()); });
+    double cfar = time([&] {
+        detections.clear();
+        processor.detect(detections);
+    });
+    std::vector<Detection> direct;
+    auto start = std::chrono::steady_clock::now();
+    direct_cfar(processor.power(), bins, pulses, processor.cfar(), direct);
+    double direct_seconds = seconds_since(start);
+    double total = time([&] {
+        detections.clear();
+        processor.process(cpi_re.data(), cpi_im.data(), detections);
+    });
+
+    double cells = double(pulses) * bins;
+    std::printf("%zu range bins x %zu pulses (%zu reference cells per CFAR window):\n", bins, pulses,
+                processor.cfar().reference_cells());
+    std::printf("  corner turn (one plane): blocked %.2f ms, row by row %.2f ms (%.1fx)\n", blocked * 1e3, naive * 1e3,
+                naive / blocked);
+    std::printf("  corner turn + Doppler FFT + power %.2f ms, CA-CFAR with summed-area table %.2f ms,"
+                " direct window sums %.1f ms (%.0fx)\n",
+                map * 1e3, cfar * 1e3, direct_seconds * 1e3, direct_seconds / cfar);
+    std::printf("  range-Doppler-CFAR %.2f ms per CPI, %.1f Mcells/s\n", total * 1e3, cells / total / 1e6);
+
+    std::size_t found = 0;
+    for (const Target& target : targets) {
+        std::size_t doppler = std::size_t(long(pulses / 2) + target.doppler);
+        bool hit = false;
+        for (const Detection& detection : detections) {
+            if (detection.range + 1 >= target.range && detection.range <= target.range + 1 &&
+                detection.doppler + 1 >= doppler && detection.doppler <= doppler + 1) {
+                hit = true;
+                std::printf("  target at range %5zu, Doppler %3zu: detected at %5zu, %3zu, %.1f dB over noise\n",
+                            target.range, doppler, detection.range, detection.doppler,
+                            10 * std::log10(detection.power / detection.noise));
+            }
+        }
+        if (!hit) std::printf("  target at range %5zu, Doppler %3zu: missed\n", target.range, doppler);
+        found += hit;
+    }
+    std::printf("  %zu of 5 targets, %zu detections in all (%.1f false alarms expected); direct CFAR agrees: %s\n",
+                found, detections.size(), cells * processor.cfar().false_alarm_rate,
+                direct.size() == detections.size() ? "yes" : "no");
+}
+
+// Small-object churn, one frame at a time: objects blocks of 16 ... 256
+// bytes are allocated, touched and all freed again, by malloc/free, by a
+// local Arena with reset(), and by thread_arena() under an ArenaScope.
+// Then per-CPI containers, a std::pmr::vector of detections grown by
+// push_back and a std::pmr::map keyed by range, on new/delete (counted,
+// see above), std's pool and monotonic resources, and an ArenaResource.
+// Reports nanoseconds per object and heap allocations per frame.
+static void bench_arena(std::size_t objects) {
+    std::vector<std::size_t> sizes(objects);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<std::size_t> size_of(16, 256);
+    for (std::size_t& size : sizes) size = size_of(rng);
+    std::vector<void*> blocks(objects);
+    std::size_t checksum = 0;
+    auto time = [&](const char* label, auto&& frame) {
+        for (int warm = 0; warm < 3; warm++) frame();
+        std::size_t frames = 0, before = heap_allocations.load();
+        double elapsed;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            frame();
+            frames++;
+        } while ((elapsed = seconds_since(start)) < 0.3);
+        std::printf("  %-34s %7.2f ns/object, %8.1f heap allocations/frame\n", label, elapsed / frames / objects * 1e9,
+                    double(heap_allocations.load() - before) / frames);
+        return elapsed / frames;
+    };
+    auto touch = [&](std::size_t i, void* block) {
+        static_cast<unsigned char*>(block)[0] = static_cast<unsigned char>(i);
+        blocks[i] = block;
+    };
+
+    std::printf("%zu objects of 16 ... 256 bytes per frame, allocated then all freed:\n", objects);
+    double heap = time("malloc / free", [&] {
+        for (std::size_t i = 0; i < objects; i++) touch(i, std::malloc(sizes[i]));
+        for (std::size_t i = 0; i < objects; i++) {
+            checksum += static_cast<unsigned char*>(blocks[i])[0];
+            std::free(blocks[i]);
+        }
+    });
+    Arena arena;
+    double bump = time("Arena, reset per frame", [&] {
+        for (std::size_t i = 0; i < objects; i++) touch(i, arena.allocate(sizes[i], 16));
+        for (std::size_t i = 0; i < objects; i++) checksum += static_cast<unsigned char*>(blocks[i])[0];
+        arena.reset();
+    });
+    time("thread_arena, scope per frame", [&] {
+        ArenaScope scope(thread_arena());
+        for (std::size_t i = 0; i < objects; i++) touch(i, thread_arena().allocate(sizes[i], 16));
+        for (std::size_t i = 0; i < objects; i++) checksum += static_cast<unsigned char*>(blocks[i])[0];
+    });
+    std::printf("  arena %.1fx faster than malloc\n", heap / bump);
 
-struct Antenna {
-    double amplitude;
-    double phase;
-};
+    std::printf("std::pmr containers per frame: vector<Detection> by push_back, map<range, power>:\n");
+    auto containers = [&](std::pmr::memory_resource* resource) {
+        std::pmr::vector<Detection> detections(resource);
+        std::pmr::map<std::size_t, float> by_range(resource);
+        for (std::size_t i = 0; i < objects; i++) {
+            detections.push_back({ sizes[i] * 64 + i, i % 64, float(sizes[i]), 1.0f });
+            by_range.emplace(detections.back().range, detections.back().power);
+        }
+        checksum += detections.size() + by_range.size();
+    };
+    double standard = time("new / delete", [&] { containers(std::pmr::new_delete_resource()); });
+    std::pmr::unsynchronized_pool_resource pool;
+    time("unsynchronized_pool_resource", [&] { containers(&pool); });
+    time("monotonic_buffer_resource", [&] {
+        std::pmr::monotonic_buffer_resource monotonic;
+        containers(&monotonic);
+    });
+    ArenaResource resource(thread_arena());
+    double arena_containers = time("ArenaResource on thread_arena", [&] {
+        ArenaScope scope(thread_arena());
+        containers(&resource);
+    });
+    std::printf("  arena %.1fx faster than new / delete; %zu chunks in the global pool (checksum %zu)\n",
+                standard / arena_containers, ChunkPool::global().free_chunks(), checksum);
+}
+
+// The scene simulator alone: pulses per second on a 16 x 16 planar
+// array with moving targets and clutter, for 1 ... threads threads,
+// checking every thread count gives the same samples; and its noise
+// against std::normal_distribution on mt19937.
+static void bench_scene(std::size_t threads, std::size_t targets) {
+    ArrayGeometry geometry = ArrayGeometry::planar(16, 16);
+    const std::size_t samples = 4096, length = 200;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, 50e6, 100e6, chirp_re.data(), chirp_im.data());
+    std::vector<SceneTarget> scene;
+    for (std::size_t t = 0; t < targets; t++) {
+        scene.push_back({ 300.0 + 5000.0 * t / targets, -150.0 + 300.0 * t / targets,
+                          (-50.0 + 100.0 * t / targets) * M_PI / 180, 0.1 * (t % 3), 0.05, 0.1 });
+    }
+    SceneConfig config;
+    config.clutter_patches = 200;
+    config.clutter_power = 0.5;
+    std::printf("16 x 16 planar array, %zu samples per pulse, %zu targets, %zu clutter patches:\n", samples, targets,
+                config.clutter_patches);
+
+    SampleBlock reference(geometry.size(), samples), block(geometry.size(), samples);
+    for (std::size_t count = 1; count <= threads; count *= 2) {
+        config.threads = count;
+        SceneSimulator simulator(geometry, chirp_re.data(), chirp_im.data(), length, config, scene);
+        std::size_t pulses = 0;
+        double elapsed;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            simulator.fill(pulses / 64, pulses % 64, block);
+            pulses++;
+        } while ((elapsed = seconds_since(start)) < 0.5);
+        simulator.fill(3, 5, block);
+        if (count == 1) simulator.fill(3, 5, reference);
+        bool same = std::memcmp(block.re.data(), reference.re.data(), block.re.size() * sizeof(float)) == 0 &&
+                    std::memcmp(block.im.data(), reference.im.data(), block.im.size() * sizeof(float)) == 0;
+        std::printf("  %zu thread%s: %8.1f pulses/s, %7.1f Msamples/s; same samples as 1 thread: %s\n", count,
+                    count == 1 ? " " : "s", pulses / elapsed, pulses * double(samples) * geometry.size() / elapsed / 1e6,
+                    same ? "yes" : "no");
+    }
+
+    const std::size_t count = samples * geometry.size();
+    AlignedBuffer<float> re(count), im(count);
+    std::size_t rows = 0;
+    double elapsed;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        gaussian_noise(noise_hash(rows), 0.70710678f, count, re.data(), im.data());
+        rows++;
+    } while ((elapsed = seconds_since(start)) < 0.3);
+    double power = 0;
+    for (std::size_t i = 0; i < count; i++) power += re[i] * re[i] + im[i] * im[i];
+    double counter_rate = rows * double(count) / elapsed;
+    std::mt19937 rng(1);
+    std::normal_distribution<float> gauss(0.0f, 0.70710678f);
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+        re[i] = gauss(rng);
+        im[i] = gauss(rng);
+    }
+    double mt_rate = count / seconds_since(start);
+    std::printf("  noise: counter hash + Box-Muller %.1f Msamples/s (power %.4f), mt19937 + normal_distribution"
+                " %.1f Msamples/s (%.0fx slower)\n",
+                counter_rate / 1e6, power / count, mt_rate / 1e6, counter_rate / mt_rate);
+}
 
-struct AntennaArray {
-    std::array<Antenna, 12> elements;
-    double center_freq;
-    double beam_width;
-    double pulse_duration;
-    double pulse_repetition_rate;
+// The receive chain as a threaded pipeline against the same work run one
+// pulse at a time on one thread, both fed by the scene simulator: CPIs
+// per second, per-stage queue and service times, CPI latency, heap
+// allocations after the first CPIs, and whether the target shows up in
+// its beam every CPI.
+static void bench_pipeline(std::size_t cpis, std::size_t elements) {
+    PipelineConfig config{ elements, 8, 4096, 32 };
+    const std::size_t length = 200;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, 50e6, 100e6, chirp_re.data(), chirp_im.data());
+    ArrayGeometry geometry = ArrayGeometry::linear(elements);
+    AlignedBuffer<float> azimuth(config.beams), elevation(config.beams);
+    AlignedBuffer<float> weights_re(config.beams * elements), weights_im(config.beams * elements);
+    for (std::size_t b = 0; b < config.beams; b++) azimuth[b] = static_cast<float>((-35.0 + 10.0 * b) * M_PI / 180);
+    geometry.steering_weights(azimuth.data(), elevation.data(), config.beams, weights_re.data(), weights_im.data());
+
+    // One target in beam 5's direction, 1500 range bins out and closing at
+    // 5 Doppler bins, over noise and clutter from the scene simulator
+    SceneConfig scene;
+    scene.pulses_per_cpi = config.pulses;
+    scene.cpis = cpis;
+    scene.clutter_patches = 32;
+    scene.clutter_power = 0.01;
+    const std::size_t target_beam = 5;
+    const double metres_per_bin = kSpeedOfLight / (2 * scene.sample_rate);
+    const double closing = 5.0 / config.pulses * kSpeedOfLight / (2 * scene.carrier_freq) / scene.pulse_repetition_interval;
+    SceneTarget target = { 1500 * metres_per_bin, -closing, azimuth[target_beam], 0, 0, 0.05 };
+    SceneSimulator simulator(geometry, chirp_re.data(), chirp_im.data(), length, scene, { target });
+    const std::size_t target_doppler = static_cast<std::size_t>(std::lround(simulator.doppler_bin(target)));
+    std::printf("%zu elements, %zu beams, %zu range bins x %zu pulses per CPI, %zu CPIs, %u cores:\n", elements,
+                config.beams, config.samples, config.pulses, cpis, std::thread::hardware_concurrency());
+
+    for (bool threaded : { false, true }) {
+        ReceivePipeline pipeline(config, weights_re.data(), weights_im.data(), chirp_re.data(), chirp_im.data(),
+                                 length);
+        std::size_t hits = 0, detections = 0, steady = 0;
+        const std::size_t warm_up = 2;
+        auto sink = [&](std::size_t cpi, std::size_t beam, const std::vector<Detection>& found) {
+            if (cpi == warm_up && beam == 0) steady = heap_allocations.load();
+            detections += found.size();
+            if (beam != target_beam) return;
+            // Where the target is halfway through this CPI
+            double t = (cpi + 0.5) * config.pulses * scene.pulse_repetition_interval;
+            double range = simulator.range_bin(target) + 2 * target.velocity * t / kSpeedOfLight * scene.sample_rate;
+            for (const Detection& detection : found) {
+                if (std::fabs(detection.range - range) <= 1.5 && detection.doppler == target_doppler) {
+                    hits++;
+                    break;
+                }
+            }
+        };
+        auto start = std::chrono::steady_clock::now();
+        if (threaded) {
+            pipeline.run(std::ref(simulator), sink);
+        } else {
+            pipeline.run_serial(std::ref(simulator), sink);
+        }
+        double elapsed = seconds_since(start);
+        std::size_t allocations = heap_allocations.load() - steady;
+        std::printf("  %s: %.1f CPIs/s, %.1f Msamples/s in; CPI latency mean %.1f ms, p99 < %.1f ms;"
+                    " %zu allocations after CPI %zu\n",
+                    threaded ? "pipeline, 4 threads" : "one thread", cpis / elapsed,
+                    cpis * config.pulses * config.samples * elements / elapsed / 1e6,
+                    pipeline.end_to_end().mean() / 1e6, pipeline.end_to_end().quantile(0.99) / 1e6, allocations,
+                    warm_up);
+        for (std::size_t stage = 0; stage < ReceivePipeline::kStages; stage++) {
+            const StageStats& stats = pipeline.stats(stage);
+            std::printf("    %-8s service mean %8.1f us, p99 < %8.1f us", ReceivePipeline::stage_name(stage),
+                        stats.service.mean() / 1e3, stats.service.quantile(0.99) / 1e3);
+            if (threaded) {
+                std::printf("; queued mean %8.1f us; busy %3.0f%%; %s", stats.queue.mean() / 1e3,
+                            100 * stats.busy_ns / (elapsed * 1e9), pipeline.pinned(stage) ? "pinned" : "not pinned");
+            }
+            std::printf("\n");
+        }
+        std::printf("    target found in %zu of %zu CPIs, %.1f detections per CPI\n", hits, pipeline.cpis(),
+                    double(detections) / pipeline.cpis());
+    }
+}
+
+// Plane waves from a few directions plus complex white noise on every
+// element of a uniform linear array (positions in wavelengths)
+static void plane_wave_block(SampleBlock& block, const float* position, const double* angles,
+                             const double* frequencies, std::size_t sources, double noise, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gauss(0.0f, static_cast<float>(noise));
+    for (std::size_t e = 0; e < block.elements; e++) {
+        float* re = block.element_re(e);
+        float* im = block.element_im(e);
+        for (std::size_t s = 0; s < block.samples; s++) {
+            std::complex<double> x = 0;
+            for (std::size_t k = 0; k < sources; k++) {
+                x += std::polar(1.0, 2 * M_PI * (frequencies[k] * s - std::sin(angles[k]) * position[e]));
+            }
+            re[s] = static_cast<float>(x.real()) + gauss(rng);
+            im[s] = static_cast<float>(x.imag()) + gauss(rng);
+        }
+    }
+}
+
+// Throughput of the blocked complex GEMM beamformer on plane-wave input,
+// against a straightforward std::complex triple loop
+template <std::size_t N>
+static void bench_beamformer(std::size_t beams, std::size_t samples) {
+    auto array = std::make_unique<AntennaArray<N>>();
+    AlignedBuffer<float> angles(beams), weights_re(beams * N), weights_im(beams * N);
+    for (std::size_t b = 0; b < beams; b++) {
+        angles[b] = static_cast<float>((-60.0 + 120.0 * b / (beams > 1 ? beams - 1 : 1)) * M_PI / 180);
+    }
+    array->steering_weights(angles.data(), beams, weights_re.data(), weights_im.data());
+    Beamformer beamformer(N, beams);
+    beamformer.set_weights(weights_re.data(), weights_im.data());
+
+    // Two sources sitting on beams 0 and beams / 2
+    double source_angles[2] = { angles[0], angles[beams / 2] };
+    double frequencies[2] = { 0.01, 0.03 };
+    SampleBlock block(N, samples);
+    plane_wave_block(block, array->elements.position.data(), source_angles, frequencies, 2, 1.0, 7);
+    AlignedBuffer<float> out_re(beams * samples), out_im(beams * samples);
+
+    std::size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        beamformer.form_beams(block, out_re.data(), out_im.data());
+        calls++;
+    } while ((elapsed = seconds_since(start)) < 0.5);
+
+    // The naive loop gives both the reference output and the baseline rate
+    std::vector<std::complex<float>> naive(beams * samples);
+    start = std::chrono::steady_clock::now();
+    for (std::size_t b = 0; b < beams; b++) {
+        for (std::size_t s = 0; s < samples; s++) {
+            std::complex<float> y = 0;
+            for (std::size_t e = 0; e < N; e++) {
+                std::complex<float> w(weights_re[b * N + e], weights_im[b * N + e]);
+                y += std::conj(w) * std::complex<float>(block.element_re(e)[s], block.element_im(e)[s]);
+            }
+            naive[b * samples + s] = y;
+        }
+    }
+    double naive_seconds = seconds_since(start);
+    double max_error = 0, power[3] = {};
+    for (std::size_t b = 0; b < beams; b++) {
+        for (std::size_t s = 0; s < samples; s++) {
+            std::complex<float> y(out_re[b * samples + s], out_im[b * samples + s]);
+            max_error = std::fmax(max_error, std::abs(y - naive[b * samples + s]) / N);
+            power[b == 0 ? 0 : b == beams / 2 ? 1 : 2] += std::norm(y) / samples;
+        }
+    }
+    power[2] /= beams - 2;
+    double rate = calls * samples / elapsed;
+    std::printf("%5zu elements, %3zu beams, %zu samples/block: %8.2f Msamples/s per beam, %6.2f GFLOP/s;"
+                " naive %6.2f Msamples/s per beam (%.1fx)\n",
+                N, beams, samples, rate / 1e6, rate * beams * N * 8 / 1e9, samples / naive_seconds / 1e6,
+                rate * naive_seconds / samples);
+    std::printf("  beam power, source beams %.0f and %.0f (N^2 = %zu), mean of the others %.0f; max error %.1e\n",
+                power[0], power[1], N * N, power[2], max_error);
+}
+
+// A linear FM chirp sweeping [-bandwidth / 2, bandwidth / 2] over the
+// block, arriving from source_angle: element e sees it delayed by
+// tau_e = sin(angle) x_e / fc and rotated by the carrier over that delay
+static void wideband_block(SampleBlock& block, const float* position, double source_angle, double center_freq,
+                           double sample_rate, double bandwidth, double noise, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gauss(0.0f, static_cast<float>(noise));
+    double duration = block.samples / sample_rate, rate = bandwidth / duration;
+    for (std::size_t e = 0; e < block.elements; e++) {
+        double tau = std::sin(source_angle) * position[e] / center_freq;
+        for (std::size_t s = 0; s < block.samples; s++) {
+            double t = s / sample_rate - tau - duration / 2;
+            std::complex<double> x = std::polar(1.0, M_PI * rate * t * t - 2 * M_PI * center_freq * tau);
+            block.element_re(e)[s] = static_cast<float>(x.real()) + gauss(rng);
+            block.element_im(e)[s] = static_cast<float>(x.imag()) + gauss(rng);
+        }
+    }
+}
+
+// Time-domain true-time delay for comparison: each element is advanced by
+// its delay with a Blackman-windowed sinc fractional-delay FIR of taps
+// taps, rotated back by the carrier phase and summed. Writes beam samples
+// [margin, in.samples - margin), beam-major [beams x in.samples].
+static void fractional_delay_beams(const SampleBlock& in, const float* position, const float* taper,
+                                   const float* angles, std::size_t beams, double center_freq, double sample_rate,
+                                   std::size_t taps, std::size_t margin, float* out_re, float* out_im) {
+    const std::size_t samples = in.samples, count = samples - 2 * margin;
+    std::vector<float> coef_re(taps), coef_im(taps);
+    for (std::size_t b = 0; b < beams; b++) {
+        float* yr = out_re + b * samples + margin;
+        float* yi = out_im + b * samples + margin;
+        std::fill(yr, yr + count, 0.0f);
+        std::fill(yi, yi + count, 0.0f);
+        for (std::size_t e = 0; e < in.elements; e++) {
+            double advance = std::sin(angles[b]) * position[e] * sample_rate / center_freq;
+            double whole = std::floor(advance), mu = advance - whole;
+            std::complex<double> rotation = std::polar(double(taper[e]), 2 * M_PI * std::sin(angles[b]) * position[e]);
+            long first = static_cast<long>(whole) - static_cast<long>(taps / 2) + 1;
+            for (std::size_t i = 0; i < taps; i++) {
+                double x = double(first - static_cast<long>(whole)) + i - mu;
+                double sinc = x == 0 ? 1 : std::sin(M_PI * x) / (M_PI * x);
+                double window = 0.42 + 0.5 * std::cos(2 * M_PI * x / taps) + 0.08 * std::cos(4 * M_PI * x / taps);
+                coef_re[i] = static_cast<float>(rotation.real() * sinc * window);
+                coef_im[i] = static_cast<float>(rotation.imag() * sinc * window);
+            }
+            for (std::size_t i = 0; i < taps; i++) {
+                const float* xr = in.element_re(e) + margin + first + static_cast<long>(i);
+                const float* xi = in.element_im(e) + margin + first + static_cast<long>(i);
+                float cr = coef_re[i], ci = coef_im[i];
+                for (std::size_t t = 0; t < count; t++) {
+                    yr[t] += cr * xr[t] - ci * xi[t];
+                    yi[t] += cr * xi[t] + ci * xr[t];
+                }
+            }
+        }
+    }
+}
 
-    void set_phase(int element, double angle) {
-        elements[element].phase = -angle * (2 * M_PI) / (beam_width / 2);
+// Frequency-domain true-time-delay beams against the time-domain FIR and
+// the narrowband Beamformer on an LFM chirp at 8% fractional bandwidth
+// (10 GHz carrier, 800 MHz swept, 1 GHz sampling). Error is the RMS
+// difference from N times the transmitted chirp on the source beam,
+// relative to its RMS.
+template <std::size_t N>
+static void bench_wideband(std::size_t beams, std::size_t fft_size) {
+    const double center_freq = 10e9, sample_rate = 1e9, bandwidth = 0.8e9;
+    const std::size_t taps = 32;
+    auto array = std::make_unique<AntennaArray<N>>();
+    AlignedBuffer<float> angles(beams);
+    for (std::size_t b = 0; b < beams; b++) {
+        angles[b] = static_cast<float>((-60.0 + 120.0 * b / (beams - 1)) * M_PI / 180);
+    }
+    const float* position = array->elements.position.data();
+    const float* taper = array->elements.taper.data();
+    WidebandBeamformer wideband(position, taper, N, angles.data(), beams, center_freq, sample_rate, bandwidth,
+                                fft_size);
+    if (wideband.hop() == 0) {
+        std::printf("%5zu elements: FFT size %zu is too small for a guard of %zu samples\n", N, fft_size,
+                    wideband.guard());
+        return;
     }
+    const std::size_t source = beams * 3 / 4, hops = 16, samples = hops * wideband.hop();
+    SampleBlock block(N, samples);
+    wideband_block(block, position, angles[source], center_freq, sample_rate, bandwidth, 0.0, 11);
+
+    AlignedBuffer<float> fd_re(beams * samples), fd_im(beams * samples);
+    std::size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        wideband.form_beams(block, fd_re.data(), fd_im.data());
+        calls++;
+    } while ((elapsed = seconds_since(start)) < 0.5);
+    double fd_rate = calls * samples / elapsed;
+
+    const std::size_t margin = wideband.guard();
+    AlignedBuffer<float> td_re(beams * samples), td_im(beams * samples);
+    start = std::chrono::steady_clock::now();
+    fractional_delay_beams(block, position, taper, angles.data(), beams, center_freq, sample_rate, taps, margin,
+                           td_re.data(), td_im.data());
+    double td_rate = (samples - 2 * margin) / seconds_since(start);
 
-    void update_amplitudes() {
-        for (int i = 0; i < elements.size(); i++) {
-            elements[i].amplitude = std::sin(elements[i].phase] / 2 + 1;
+    AlignedBuffer<float> weights_re(beams * N), weights_im(beams * N), nb_re(beams * samples), nb_im(beams * samples);
+    array->steering_weights(angles.data(), beams, weights_re.data(), weights_im.data());
+    Beamformer narrowband(N, beams);
+    narrowband.set_weights(weights_re.data(), weights_im.data());
+    narrowband.form_beams(block, nb_re.data(), nb_im.data());
+
+    // Chirp as transmitted, at output sample s; frequency-domain output is
+    // delayed by guard(), and the last call started mid-stream, so only
+    // compare the middle of the block
+    double duration = samples / sample_rate, rate = bandwidth / duration;
+    auto error = [&](const float* re, const float* im, std::size_t delay) {
+        double diff = 0, norm = 0;
+        for (std::size_t s = 2 * margin; s + 2 * margin < samples; s++) {
+            double t = (s - delay) / sample_rate - duration / 2;
+            std::complex<double> ideal = double(N) * std::polar(1.0, M_PI * rate * t * t);
+            std::complex<double> y(re[source * samples + s], im[source * samples + s]);
+            diff += std::norm(y - ideal);
+            norm += std::norm(ideal);
         }
+        return std::sqrt(diff / norm);
+    };
+    // The timing loop fed the block in repeatedly; measure the error on a
+    // fresh stream
+    WidebandBeamformer fresh(position, taper, N, angles.data(), beams, center_freq, sample_rate, bandwidth, fft_size);
+    fresh.form_beams(block, fd_re.data(), fd_im.data());
+    std::printf("%5zu elements, %2zu beams, FFT %zu (guard %zu, hop %zu, %.1f MB weights):\n", N, beams, fft_size,
+                wideband.guard(), wideband.hop(), wideband.table_bytes() / 1e6);
+    std::printf("  frequency domain %8.3f Msamples/s per beam, %zu-tap FIR %8.3f (%.1fx)\n", fd_rate / 1e6, taps,
+                td_rate / 1e6, fd_rate / td_rate);
+    std::printf("  source beam error: frequency domain %.1e, FIR %.1e, narrowband phase shifts %.2f\n",
+                error(fd_re.data(), fd_im.data(), fresh.guard()), error(td_re.data(), td_im.data(), 0),
+                error(nb_re.data(), nb_im.data(), 0));
+}
+
+// Busy threads at normal priority competing for the cores, each running a
+// steering loop
+static void steering_load(std::atomic<bool>& stop) {
+    auto array = std::make_unique<AntennaArray<1024>>();
+    float angle = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        array->steer(angle += 0.01f);
+        array->update_amplitudes();
     }
+}
 
-    void send_pulse() {
-        update_amplitudes();
+// Pulse timing on two interleaved arrays for seconds per mode: a 1024-
+// element search array stepping through 8 beams of 32 pulses at 200 us,
+// and a 256-element track array alternating 2 beams of 16 pulses at 500
+// us, offset by 100 us. Each pulse steers on the first pulse of a dwell
+// and recomputes amplitudes. The old relative sleep_for loop runs the
+// search schedule alone, with lateness measured against the same
+// absolute timeline, so its drift shows.
+static void bench_pulses(double seconds, std::size_t load_threads, bool realtime) {
+    auto search = std::make_unique<AntennaArray<1024>>();
+    auto track = std::make_unique<AntennaArray<256>>();
+    std::vector<Dwell> search_dwells, track_dwells;
+    for (int b = 0; b < 8; b++) search_dwells.push_back({ (-45.0 + b * 90.0 / 7) * M_PI / 180, 32, 200e-6 });
+    track_dwells.push_back({ 10 * M_PI / 180, 16, 500e-6 });
+    track_dwells.push_back({ -20 * M_PI / 180, 16, 500e-6 });
 
-        // Send the pulse to all antenna elements
-        for (int i = 0; i < elements.size(); i++) {
-            // Simulate sending the pulse
-            std::cout << "Sending pulse from element " << i << " with amplitude " << elements[i].amplitude << std::endl;
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> load;
+    for (std::size_t i = 0; i < load_threads; i++) load.emplace_back(steering_load, std::ref(stop));
+    if (realtime && !PulseScheduler::set_realtime_priority()) std::printf("SCHED_FIFO not permitted, running without\n");
+    std::printf("%zu load threads%s:\n", load_threads, realtime ? ", SCHED_FIFO" : "");
+
+    {
+        LatenessHistogram lateness;
+        std::int64_t start = PulseScheduler::now_ns(), pulse = 0;
+        for (std::size_t dwell = 0; PulseScheduler::now_ns() - start < seconds * 1e9; dwell = (dwell + 1) % 8) {
+            for (std::size_t n = 0; n < 32; n++, pulse++) {
+                lateness.record(PulseScheduler::now_ns() - (start + pulse * 200000));
+                if (n == 0) search->steer(search_dwells[dwell].angle);
+                search->update_amplitudes();
+                std::this_thread::sleep_for(std::chrono::duration<double>(200e-6));
+            }
         }
+        lateness.print("  sleep_for loop, search array    ");
+    }
+    for (std::int64_t spin_ns : { std::int64_t(0), std::int64_t(50000) }) {
+        PulseScheduler scheduler(spin_ns);
+        scheduler.add_channel(search_dwells, [&](const PulseEvent& pulse) {
+            if (pulse.pulse == 0) search->steer(pulse.angle);
+            search->update_amplitudes();
+        }, 0);
+        scheduler.add_channel(track_dwells, [&](const PulseEvent& pulse) {
+            if (pulse.pulse == 0) track->steer(pulse.angle);
+            track->update_amplitudes();
+        }, 0, 100000);
+        scheduler.run(seconds);
+        const char* mode = spin_ns ? "sleep + 50 us spin" : "clock_nanosleep   ";
+        char label[64];
+        std::snprintf(label, sizeof(label), "  %s, search array", mode);
+        scheduler.lateness(0).print(label);
+        std::snprintf(label, sizeof(label), "  %s, track array ", mode);
+        scheduler.lateness(1).print(label);
+    }
+    stop = true;
+    for (std::thread& thread : load) thread.join();
+}
 
-        // Wait for the next pulse
-        std::this_thread::sleep_for(std::chrono::microseconds(pulse_repetition_rate * 1000));
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-arena") == 0) {
+        std::size_t objects = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+        if (objects < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-arena [objects per frame]\n");
+            return 1;
+        }
+        bench_arena(objects);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-scene") == 0) {
+        std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+        std::size_t targets = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20;
+        if (threads < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-scene [threads] [targets]\n");
+            return 1;
+        }
+        bench_scene(threads, targets);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-geometry") == 0) {
+        std::size_t beams = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+        ArrayGeometry geometry;
+        if (beams < 1 || (argc > 3 && !ArrayGeometry::parse(argv[3], geometry))) {
+            std::fprintf(stderr, "usage: phased_array --bench-geometry [beams] [linear:N | planar:CxR |"
+                                 " cylinder:CxR:radius | positions file]\n");
+            return 1;
+        }
+        if (argc > 3) {
+            bench_geometry(beams, geometry, argv[3]);
+        } else {
+            bench_geometry(beams, ArrayGeometry::planar(64, 64), "planar:64x64");
+            bench_geometry(beams, ArrayGeometry::cylinder(64, 64, 20.0), "cylinder:64x64:20");
+        }
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-pipeline") == 0) {
+        std::size_t cpis = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+        std::size_t elements = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+        if (cpis < 4 || elements < 2) {
+            std::fprintf(stderr, "usage: phased_array --bench-pipeline [CPIs >= 4] [elements]\n");
+            return 1;
+        }
+        bench_pipeline(cpis, elements);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-range-doppler") == 0) {
+        std::size_t bins = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16384;
+        std::size_t pulses = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+        if (bins < 2000 || pulses < 8 || (pulses & (pulses - 1)) != 0) {
+            std::fprintf(stderr, "usage: phased_array --bench-range-doppler [range bins >= 2000] [pulses, a power of two]\n");
+            return 1;
+        }
+        bench_range_doppler(bins, pulses);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-compression") == 0) {
+        std::size_t samples = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16384;
+        std::size_t pulses = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+        if (samples < 1000 || pulses < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-compression [range bins >= 1000] [pulses per CPI]\n");
+            return 1;
+        }
+        bench_compression(samples, pulses);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-steering-table") == 0) {
+        std::size_t fine_steps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+        if (fine_steps < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-steering-table [fine steps]\n");
+            return 1;
+        }
+        bench_steering_table(fine_steps);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-pulses") == 0) {
+        double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+        std::size_t load_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2;
+        if (seconds <= 0) {
+            std::fprintf(stderr, "usage: phased_array --bench-pulses [seconds per mode] [load threads]\n");
+            return 1;
+        }
+        bench_pulses(seconds, 0, false);
+        bench_pulses(seconds, load_threads, false);
+        bench_pulses(seconds, load_threads, true);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-wideband") == 0) {
+        std::size_t beams = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+        std::size_t fft_size = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1024;
+        if (beams < 2 || fft_size < 2 || (fft_size & (fft_size - 1)) != 0) {
+            std::fprintf(stderr, "usage: phased_array --bench-wideband [beams >= 2] [FFT size, a power of two]\n");
+            return 1;
+        }
+        bench_wideband<64>(beams, fft_size);
+        bench_wideband<256>(beams, fft_size);
+        bench_wideband<1024>(beams, fft_size);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-beamformer") == 0) {
+        std::size_t beams = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+        std::size_t samples = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 4096;
+        if (beams < 3 || samples < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-beamformer [beams >= 3] [samples per block]\n");
+            return 1;
+        }
+        bench_beamformer<64>(beams, samples);
+        bench_beamformer<256>(beams, samples);
+        bench_beamformer<1024>(beams, samples);
+        return 0;
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--bench-steering") == 0) {
+        std::size_t num_beams = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+        if (num_beams < 1) {
+            std::fprintf(stderr, "usage: phased_array --bench-steering [beams per call]\n");
+            return 1;
+        }
+        bench_steering<64>(num_beams);
+        bench_steering<256>(num_beams);
+        bench_steering<1024>(num_beams);
+        bench_steering<4096>(num_beams);
+        bench_steering<16384>(num_beams);
+        return 0;
     }
-};
 
-int main() {
-    AntennaArray array;
+    AntennaArray<12> array;
     array.center_freq = 2e9;
     array.beam_width = 10;
     array.pulse_duration = 1e-6;
     array.pulse_repetition_rate = 1e6;
 
-    // Set the phase for the first element to intercept the target at +/- 5 degrees from the center of the beam
-    array.set_phase(0, 5);
+    // Set the phase for the first element to intercept a target 5 degrees off broadside
+    array.set_phase(0, 5 * M_PI / 180);
 
-    // Send the pulse
-    array.send_pulse();
+    // Send one pulse on the next repetition deadline
+    PulseScheduler scheduler;
+    scheduler.add_channel({ { 0.0, 1, 1.0 / array.pulse_repetition_rate } },
+                          [&](const PulseEvent&) { array.send_pulse(); });
+    scheduler.run();
 
     return 0;
 }
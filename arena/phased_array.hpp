@@ -0,0 +1,82 @@
+// phased_array.hpp
+#ifndef PHASED_ARRAY_HPP
+#define PHASED_ARRAY_HPP
+
+#include "steering.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// Per-element state as a structure of arrays, one aligned plane per field,
+// so the steering and amplitude loops run over contiguous floats
+template <std::size_t N>
+struct ElementStore {
+    alignas(64) std::array<float, N> position;   // along the array axis, in wavelengths
+    alignas(64) std::array<float, N> taper;      // receive/transmit gain
+    alignas(64) std::array<float, N> phase;      // radians
+    alignas(64) std::array<float, N> amplitude;
+};
+
+template <std::size_t N>
+struct AntennaArray {
+    ElementStore<N> elements;
+    double center_freq = 0;
+    double beam_width = 0;
+    double pulse_duration = 0;
+    double pulse_repetition_rate = 0;
+
+    // Uniform linear array centred on the origin, untapered
+    explicit AntennaArray(double element_spacing = 0.5) {
+        for (std::size_t i = 0; i < N; i++) {
+            elements.position[i] = static_cast<float>((i - (N - 1) / 2.0) * element_spacing);
+            elements.taper[i] = 1.0f;
+            elements.phase[i] = 0.0f;
+            elements.amplitude[i] = 1.0f;
+        }
+    }
+
+    static constexpr std::size_t size() { return N; }
+
+    // Phase of one element for a beam steered to angle (radians off
+    // broadside), from its position: what steer(angle) sets for every one
+    void set_phase(int element, double angle) {
+        elements.phase[element] = static_cast<float>(-2 * M_PI * std::sin(angle) * elements.position[element]);
+    }
+
+    // Progressive phase across the array that steers the beam to angle
+    // (radians off broadside)
+    void steer(double angle) {
+        float k = static_cast<float>(-2 * M_PI * std::sin(angle));
+        for (std::size_t i = 0; i < N; i++) elements.phase[i] = k * elements.position[i];
+    }
+
+    void update_amplitudes() {
+        half_sine_plus_one(elements.phase.data(), N, elements.amplitude.data());
+    }
+
+    // Complex weights for num_beams steering angles (radians) in one call,
+    // beam-major: beam b's weights are re/im[b * N, b * N + N)
+    void steering_weights(const float* angles, std::size_t num_beams, float* re, float* im) const {
+        for (std::size_t b = 0; b < num_beams; b++) {
+            float k = -kTwoPi * std::sin(angles[b]);
+            steering_kernel(elements.position.data(), elements.taper.data(), N, k, re + b * N, im + b * N);
+        }
+    }
+
+    // Emits one pulse now. Timing is up to the caller: PulseScheduler
+    // calls this on absolute deadlines.
+    void send_pulse() {
+        update_amplitudes();
+
+        // Send the pulse to all antenna elements
+        for (std::size_t i = 0; i < N; i++) {
+            // Simulate sending the pulse
+            std::cout << "Sending pulse from element " << i << " with amplitude " << elements.amplitude[i]
+                      << std::endl;
+        }
+    }
+};
+
+#endif // PHASED_ARRAY_HPP
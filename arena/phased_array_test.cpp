@@ -0,0 +1,718 @@
+// phased_array_test.cpp
+#include "aligned_buffer.hpp"
+#include "arena_allocator.hpp"
+#include "array_geometry.hpp"
+#include "beamformer.hpp"
+#include "fft.hpp"
+#include "phased_array.hpp"
+#include "pulse_compression.hpp"
+#include "pulse_scheduler.hpp"
+#include "range_doppler.hpp"
+#include "receive_pipeline.hpp"
+#include "scene_simulator.hpp"
+#include "steering_table.hpp"
+#include "wideband_beamformer.hpp"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+
+void test_fast_sincos() {
+    float max_error = 0;
+    for (int i = -2000000; i <= 2000000; i++) {
+        float x = i * 0.005f; // [-1e4, 1e4]
+        SinCos w = fast_sincos(x);
+        max_error = std::fmax(max_error, std::fabs(w.sin - static_cast<float>(std::sin(static_cast<double>(x)))));
+        max_error = std::fmax(max_error, std::fabs(w.cos - static_cast<float>(std::cos(static_cast<double>(x)))));
+    }
+    assert(max_error < 1e-6f);
+    std::cout << "fast_sincos max error on [-1e4, 1e4]: " << max_error << std::endl;
+}
+
+void test_steering_weights() {
+    AntennaArray<256> array;
+    for (std::size_t i = 0; i < array.size(); i++) array.elements.taper[i] = 0.5f + 0.5f * i / array.size();
+    const std::size_t beams = 7;
+    float angles[beams] = { -1.2f, -0.5f, -0.1f, 0.0f, 0.2f, 0.7f, 1.3f };
+    AlignedBuffer<float> re(beams * array.size()), im(beams * array.size());
+    array.steering_weights(angles, beams, re.data(), im.data());
+    for (std::size_t b = 0; b < beams; b++) {
+        double k = -2 * M_PI * std::sin(static_cast<double>(angles[b]));
+        for (std::size_t i = 0; i < array.size(); i++) {
+            double phase = k * array.elements.position[i];
+            double taper = array.elements.taper[i];
+            assert(std::fabs(re[b * array.size() + i] - taper * std::cos(phase)) < 1e-4);
+            assert(std::fabs(im[b * array.size() + i] - taper * std::sin(phase)) < 1e-4);
+        }
+    }
+
+    // The beam steered to an angle adds a plane wave from that angle coherently
+    array.steer(angles[4]);
+    for (std::size_t i = 0; i < array.size(); i++) {
+        double phase = array.elements.phase[i];
+        assert(std::fabs(std::cos(phase) - re[4 * array.size() + i] / array.elements.taper[i]) < 1e-4);
+    }
+    std::cout << "Steering weights match the double-precision formula." << std::endl;
+}
+
+void test_update_amplitudes() {
+    AntennaArray<12> array;
+    array.beam_width = 10;
+    for (int i = 0; i < 12; i++) array.set_phase(i, i - 6);
+    array.update_amplitudes();
+    for (int i = 0; i < 12; i++) {
+        assert(std::fabs(array.elements.amplitude[i] - (std::sin(array.elements.phase[i]) / 2 + 1)) < 1e-6);
+    }
+    std::cout << "update_amplitudes matches sin(phase) / 2 + 1." << std::endl;
+}
+
+void test_beamformer() {
+    // Sizes that leave partial beam tiles, element blocks and sample tiles
+    const std::size_t elements = 300, beams = 7, samples = 1000 + 5;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    AlignedBuffer<float> weights_re(beams * elements), weights_im(beams * elements);
+    for (std::size_t i = 0; i < beams * elements; i++) {
+        weights_re[i] = uniform(rng);
+        weights_im[i] = uniform(rng);
+    }
+    SampleBlock block(elements, samples);
+    for (std::size_t i = 0; i < elements * samples; i++) {
+        block.re[i] = uniform(rng);
+        block.im[i] = uniform(rng);
+    }
+    Beamformer beamformer(elements, beams);
+    beamformer.set_weights(weights_re.data(), weights_im.data());
+    AlignedBuffer<float> out_re(beams * samples), out_im(beams * samples);
+    beamformer.form_beams(block, out_re.data(), out_im.data());
+    for (std::size_t b = 0; b < beams; b++) {
+        for (std::size_t s = 0; s < samples; s++) {
+            std::complex<double> y = 0;
+            for (std::size_t e = 0; e < elements; e++) {
+                std::complex<double> w(weights_re[b * elements + e], weights_im[b * elements + e]);
+                y += std::conj(w) * std::complex<double>(block.element_re(e)[s], block.element_im(e)[s]);
+            }
+            assert(std::abs(std::complex<double>(out_re[b * samples + s], out_im[b * samples + s]) - y) < 1e-3);
+        }
+    }
+    std::cout << "Blocked beamformer matches the direct sum." << std::endl;
+}
+
+void test_fft() {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (std::size_t n = 1; n <= 2048; n *= 2) {
+        FftPlan plan(n);
+        std::vector<float> re(n), im(n), x_re(n), x_im(n);
+        for (std::size_t i = 0; i < n; i++) {
+            re[i] = x_re[i] = uniform(rng);
+            im[i] = x_im[i] = uniform(rng);
+        }
+        plan.forward(re.data(), im.data());
+        for (std::size_t k = 0; k < n; k++) {
+            std::complex<double> X = 0;
+            for (std::size_t t = 0; t < n; t++) {
+                X += std::complex<double>(x_re[t], x_im[t]) * std::polar(1.0, -2 * M_PI * double(k * t % n) / n);
+            }
+            assert(std::abs(X - std::complex<double>(re[k], im[k])) < 1e-5 * std::sqrt(double(n)));
+        }
+        // The scrambled transform is the same spectrum, bin-reversed
+        std::vector<float> s_re(x_re), s_im(x_im);
+        plan.forward_scrambled(s_re.data(), s_im.data());
+        for (std::size_t p = 0; p < n; p++) {
+            assert(s_re[p] == re[plan.scrambled_bin(p)] && s_im[p] == im[plan.scrambled_bin(p)]);
+        }
+        plan.inverse(re.data(), im.data());
+        plan.inverse_scrambled(s_re.data(), s_im.data());
+        for (std::size_t i = 0; i < n; i++) {
+            assert(std::fabs(re[i] / n - x_re[i]) < 1e-6f && std::fabs(im[i] / n - x_im[i]) < 1e-6f);
+            assert(std::fabs(s_re[i] / n - x_re[i]) < 1e-6f && std::fabs(s_im[i] / n - x_im[i]) < 1e-6f);
+        }
+    }
+    std::cout << "FFT matches the direct DFT for sizes 1 ... 2048." << std::endl;
+}
+
+void test_wideband_beamformer() {
+    // 64 elements, a chirp over 8% fractional bandwidth from 40 degrees
+    const std::size_t elements = 64, beams = 3, fft_size = 256;
+    const double center_freq = 10e9, sample_rate = 1e9, bandwidth = 0.8e9;
+    AntennaArray<elements> array;
+    float angles[beams] = { -0.3f, 0.0f, static_cast<float>(40 * M_PI / 180) };
+    WidebandBeamformer beamformer(array.elements.position.data(), array.elements.taper.data(), elements, angles,
+                                  beams, center_freq, sample_rate, bandwidth, fft_size);
+    const std::size_t hop = beamformer.hop(), samples = 6 * hop, guard = beamformer.guard();
+    assert(hop > 0);
+    double duration = samples / sample_rate, rate = bandwidth / duration;
+    auto chirp = [&](double t) { return std::polar(1.0, M_PI * rate * (t - duration / 2) * (t - duration / 2)); };
+    SampleBlock block(elements, samples);
+    for (std::size_t e = 0; e < elements; e++) {
+        double tau = std::sin(double(angles[2])) * array.elements.position[e] / center_freq;
+        for (std::size_t s = 0; s < samples; s++) {
+            std::complex<double> x = chirp(s / sample_rate - tau) * std::polar(1.0, -2 * M_PI * center_freq * tau);
+            block.element_re(e)[s] = static_cast<float>(x.real());
+            block.element_im(e)[s] = static_cast<float>(x.imag());
+        }
+    }
+    AlignedBuffer<float> out_re(beams * samples), out_im(beams * samples);
+    beamformer.form_beams(block, out_re.data(), out_im.data());
+    // Output s is input s - guard; skip the start, which saw zero history
+    for (std::size_t s = 3 * guard; s < samples; s++) {
+        std::complex<double> y(out_re[2 * samples + s], out_im[2 * samples + s]);
+        assert(std::abs(y - double(elements) * chirp((double(s) - guard) / sample_rate)) < 0.02 * elements);
+    }
+
+    // Two calls of half the block give the same stream as one call
+    WidebandBeamformer halves(array.elements.position.data(), array.elements.taper.data(), elements, angles, beams,
+                              center_freq, sample_rate, bandwidth, fft_size);
+    SampleBlock half(elements, samples / 2);
+    AlignedBuffer<float> half_re(beams * samples / 2), half_im(beams * samples / 2);
+    for (std::size_t part = 0; part < 2; part++) {
+        for (std::size_t e = 0; e < elements; e++) {
+            std::memcpy(half.element_re(e), block.element_re(e) + part * samples / 2, samples / 2 * sizeof(float));
+            std::memcpy(half.element_im(e), block.element_im(e) + part * samples / 2, samples / 2 * sizeof(float));
+        }
+        halves.form_beams(half, half_re.data(), half_im.data());
+        for (std::size_t b = 0; b < beams; b++) {
+            for (std::size_t s = 0; s < samples / 2; s++) {
+                assert(std::fabs(half_re[b * samples / 2 + s] - out_re[b * samples + part * samples / 2 + s]) < 1e-4f);
+                assert(std::fabs(half_im[b * samples / 2 + s] - out_im[b * samples + part * samples / 2 + s]) < 1e-4f);
+            }
+        }
+    }
+    std::cout << "Wideband beamformer recovers the delayed chirp, across calls too." << std::endl;
+}
+
+void test_pulse_scheduler() {
+    // Two dwells of 2 pulses at 1 ms and 3 at 0.5 ms, twice over, interleaved
+    // with 4 pulses at 0.7 ms starting 0.2 ms in
+    PulseScheduler scheduler(20000);
+    std::vector<PulseEvent> fired;
+    fired.reserve(16);
+    auto record = [&](const PulseEvent& pulse) { fired.push_back(pulse); };
+    scheduler.add_channel({ { 0.1, 2, 1e-3 }, { -0.1, 3, 0.5e-3 } }, record, 2);
+    scheduler.add_channel({ { 0.3, 4, 0.7e-3 } }, record, 1, 200000);
+    // A short first run, then the rest on the same timeline
+    scheduler.run(1.2e-3);
+    assert(fired.size() == 4);
+    scheduler.run();
+    assert(fired.size() == 14);
+    assert(scheduler.lateness(0).count() == 10 && scheduler.lateness(1).count() == 4);
+
+    std::int64_t start = fired[0].deadline_ns;
+    const std::int64_t expected[2][10] = { { 0, 1000000, 2000000, 2500000, 3000000, 3500000, 4500000, 5500000,
+                                             6000000, 6500000 },
+                                           { 200000, 900000, 1600000, 2300000 } };
+    std::size_t seen[2] = {};
+    for (std::size_t i = 0; i < fired.size(); i++) {
+        const PulseEvent& pulse = fired[i];
+        assert(i == 0 || pulse.deadline_ns >= fired[i - 1].deadline_ns);
+        assert(pulse.deadline_ns - start == expected[pulse.channel][seen[pulse.channel]]);
+        seen[pulse.channel]++;
+        assert(pulse.lateness_ns >= 0);
+        assert(pulse.channel == 1 ? pulse.angle == 0.3 : pulse.angle == (pulse.dwell == 0 ? 0.1 : -0.1));
+    }
+    std::cout << "Pulse scheduler fires both schedules on their absolute deadlines, p99 lateness < "
+              << scheduler.lateness(0).quantile(0.99) / 1e3 << " us." << std::endl;
+}
+
+void test_steering_table() {
+    AntennaArray<128> array;
+    for (std::size_t i = 0; i < array.size(); i++) array.elements.taper[i] = 0.5f + 0.5f * i / array.size();
+    const double degree = M_PI / 180;
+    AngleGrid azimuth{ -50 * degree, 5 * degree, 21 }, elevation{ -10 * degree, 10 * degree, 4 };
+    SteeringTable table(array.elements.position.data(), array.elements.taper.data(), array.size(), azimuth,
+                        elevation, 32);
+    auto exact = [&](double az, double el, std::size_t i) {
+        double k = -2 * M_PI * std::cos(el) * std::sin(az);
+        return std::polar(double(array.elements.taper[i]), k * array.elements.position[i]);
+    };
+
+    // Nodes fill on first use only, and the pointer stays put
+    assert(table.filled() == 0);
+    const float* node = table.weights(3, 2);
+    assert(table.filled() == 1 && table.weights(3, 2) == node && table.filled() == 1);
+    assert(table.nearest(azimuth.angle(3) + 2 * degree, elevation.angle(2) - 4 * degree) == node);
+    for (std::size_t i = 0; i < array.size(); i++) {
+        std::complex<double> w(node[i], node[array.size() + i]);
+        assert(std::abs(w - exact(azimuth.angle(3), elevation.angle(2), i)) < 1e-5);
+    }
+
+    // Off-grid directions within the bound pi * x_max * widest cell / 32^2
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<double> az(-50 * degree, 50 * degree), el(-10 * degree, 20 * degree);
+    AlignedBuffer<float> re(array.size()), im(array.size());
+    double bound = M_PI * 32 * std::sin(5 * degree) / (32 * 32), max_error = 0;
+    for (int n = 0; n < 500; n++) {
+        double a = az(rng), e = el(rng);
+        table.steer(a, e, re.data(), im.data());
+        for (std::size_t i = 0; i < array.size(); i++) {
+            max_error = std::fmax(max_error, std::abs(std::complex<double>(re[i], im[i]) - exact(a, e, i)));
+        }
+    }
+    assert(max_error < bound + 1e-4);
+    table.fill_all();
+    assert(table.filled() == table.nodes());
+    std::cout << "Steering table nodes and off-grid steering match the formula, max error " << max_error << "."
+              << std::endl;
+}
+
+void test_pulse_compression() {
+    const std::size_t length = 37, samples = 500;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length), in_re(samples), in_im(samples);
+    lfm_chirp(length, 40e6, 100e6, chirp_re.data(), chirp_im.data());
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> uniform(-0.1f, 0.1f);
+    for (std::size_t n = 0; n < samples; n++) {
+        in_re[n] = uniform(rng);
+        in_im[n] = uniform(rng);
+    }
+    // Echoes at 100 and 480; the second runs off the end of the window
+    for (std::size_t k = 0; k < length; k++) {
+        in_re[100 + k] += chirp_re[k];
+        in_im[100 + k] += chirp_im[k];
+        if (480 + k < samples) {
+            in_re[480 + k] += 0.5f * chirp_re[k];
+            in_im[480 + k] += 0.5f * chirp_im[k];
+        }
+    }
+    AlignedBuffer<float> out_re(samples), out_im(samples);
+    for (std::size_t fft_size : { 0, 64, 1024 }) {
+        PulseCompressor compressor(chirp_re.data(), chirp_im.data(), length, fft_size);
+        compressor.compress(in_re.data(), in_im.data(), samples, out_re.data(), out_im.data());
+        for (std::size_t n = 0; n < samples; n++) {
+            std::complex<double> y = 0;
+            for (std::size_t k = 0; k < length && n + k < samples; k++) {
+                y += std::complex<double>(in_re[n + k], in_im[n + k]) *
+                     std::conj(std::complex<double>(chirp_re[k], chirp_im[k]));
+            }
+            assert(std::abs(y - std::complex<double>(out_re[n], out_im[n])) < 1e-4);
+        }
+        assert(std::fabs(std::hypot(out_re[100], out_im[100]) - length) < 2);
+    }
+    std::cout << "Pulse compression matches direct correlation for three FFT sizes." << std::endl;
+}
+
+void test_range_doppler() {
+    const std::size_t rows = 37, cols = 45;
+    AlignedBuffer<float> plane(rows * cols), turned(rows * cols);
+    for (std::size_t i = 0; i < rows * cols; i++) plane[i] = static_cast<float>(i);
+    corner_turn(plane.data(), rows, cols, turned.data());
+    for (std::size_t r = 0; r < rows; r++) {
+        for (std::size_t c = 0; c < cols; c++) assert(turned[c * rows + r] == plane[r * cols + c]);
+    }
+
+    // Noise plus one target at range 40, 3 Doppler bins above zero
+    const std::size_t pulses = 16, bins = 100;
+    AlignedBuffer<float> re(pulses * bins), im(pulses * bins);
+    std::mt19937 rng(17);
+    std::normal_distribution<float> noise(0.0f, 0.7f);
+    for (std::size_t i = 0; i < pulses * bins; i++) {
+        re[i] = noise(rng);
+        im[i] = noise(rng);
+    }
+    for (std::size_t p = 0; p < pulses; p++) {
+        re[p * bins + 40] += static_cast<float>(3 * std::cos(2 * M_PI * 3 * p / pulses));
+        im[p * bins + 40] += static_cast<float>(3 * std::sin(2 * M_PI * 3 * p / pulses));
+    }
+    CfarConfig cfar;
+    cfar.false_alarm_rate = 1e-4;
+    RangeDopplerProcessor processor(pulses, bins, cfar);
+    std::vector<Detection> detections;
+    processor.process(re.data(), im.data(), detections);
+
+    // Map against a direct windowed DFT, CFAR against direct window sums
+    const float* power = processor.power();
+    for (std::size_t r = 0; r < bins; r++) {
+        for (std::size_t d = 0; d < pulses; d++) {
+            std::complex<double> y = 0;
+            for (std::size_t p = 0; p < pulses; p++) {
+                double w = 0.5 - 0.5 * std::cos(2 * M_PI * (p + 0.5) / pulses);
+                double k = static_cast<double>(d) - static_cast<double>(pulses / 2);
+                y += w * std::complex<double>(re[p * bins + r], im[p * bins + r]) *
+                     std::polar(1.0, -2 * M_PI * k * p / pulses);
+            }
+            assert(std::fabs(std::norm(y) - power[r * pulses + d]) < 1e-3 * (1 + std::norm(y)));
+        }
+    }
+    bool found = false;
+    for (const Detection& detection : detections) {
+        std::size_t r = detection.range, d = detection.doppler;
+        double sum = 0, cells = 0;
+        for (std::size_t i = 0; i < bins; i++) {
+            for (std::size_t j = 0; j < pulses; j++) {
+                std::size_t dr = i > r ? i - r : r - i, dd = j > d ? j - d : d - j;
+                if (dr > cfar.guard_range + cfar.training_range || dd > cfar.guard_doppler + cfar.training_doppler)
+                    continue;
+                if (dr <= cfar.guard_range && dd <= cfar.guard_doppler) continue;
+                sum += power[i * pulses + j];
+                cells++;
+            }
+        }
+        assert(std::fabs(detection.noise - sum / cells) < 1e-4 * detection.noise);
+        assert(detection.power > cfar.scale() * detection.noise);
+        found = found || (r == 40 && d == pulses / 2 + 3);
+    }
+    assert(found);
+    std::cout << "Range-Doppler map matches a direct DFT, CFAR finds the target (" << detections.size()
+              << " detections)." << std::endl;
+}
+
+void test_receive_pipeline() {
+    SpscRing<int> ring(4);
+    int value = 0;
+    assert(!ring.pop(value));
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) assert(ring.push(10 * round + i));
+        assert(!ring.push(99));
+        for (int i = 0; i < 4; i++) {
+            assert(ring.pop(value));
+            assert(value == 10 * round + i);
+        }
+        assert(!ring.pop(value));
+    }
+
+    // Four CPIs of noise and one echo; written to a file, then run through
+    // the threaded pipeline from the file and serially from the generator
+    PipelineConfig config{ 8, 4, 256, 8 };
+    config.pulse_frames = 3;
+    config.beam_frames = 2;
+    const std::size_t length = 32, cpis = 4;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, 40e6, 100e6, chirp_re.data(), chirp_im.data());
+    AlignedBuffer<float> weights_re(config.beams * config.elements), weights_im(config.beams * config.elements);
+    AlignedBuffer<float> position(config.elements), taper(config.elements);
+    for (std::size_t e = 0; e < config.elements; e++) {
+        position[e] = 0.5f * e;
+        taper[e] = 1.0f;
+    }
+    for (std::size_t b = 0; b < config.beams; b++) {
+        float k = static_cast<float>(-2 * M_PI * std::sin((-30.0 + 20.0 * b) * M_PI / 180));
+        steering_kernel(position.data(), taper.data(), config.elements, k, weights_re.data() + b * config.elements,
+                        weights_im.data() + b * config.elements);
+    }
+    auto generate = [&](std::size_t cpi, std::size_t pulse, SampleBlock& block) {
+        if (cpi == cpis) return false;
+        std::mt19937 rng(static_cast<unsigned>(cpi * config.pulses + pulse));
+        std::normal_distribution<float> gauss(0.0f, 0.7f);
+        for (std::size_t e = 0; e < block.elements; e++) {
+            for (std::size_t s = 0; s < block.samples; s++) {
+                std::complex<double> x(gauss(rng), gauss(rng));
+                if (s >= 100 && s < 100 + length) {
+                    // From beam 2's direction (10 degrees), Doppler bin +2
+                    double phase = 2 * M_PI * (2.0 * pulse / config.pulses - std::sin(10 * M_PI / 180) * position[e]);
+                    x += std::polar(0.5, phase) * std::complex<double>(chirp_re[s - 100], chirp_im[s - 100]);
+                }
+                block.element_re(e)[s] = static_cast<float>(x.real());
+                block.element_im(e)[s] = static_cast<float>(x.imag());
+            }
+        }
+        return true;
+    };
+    const char* path = "/tmp/phased_array_test_iq.bin";
+    {
+        std::FILE* file = std::fopen(path, "wb");
+        assert(file != nullptr);
+        SampleBlock block(config.elements, config.samples);
+        for (std::size_t cpi = 0; cpi < cpis; cpi++) {
+            for (std::size_t pulse = 0; pulse < config.pulses; pulse++) {
+                generate(cpi, pulse, block);
+                for (std::size_t e = 0; e < config.elements; e++) {
+                    for (std::size_t s = 0; s < config.samples; s++) {
+                        float iq[2] = { block.element_re(e)[s], block.element_im(e)[s] };
+                        std::fwrite(iq, sizeof(iq), 1, file);
+                    }
+                }
+            }
+        }
+        std::fclose(file);
+    }
+
+    using Found = std::vector<std::array<std::size_t, 4>>;
+    auto collect = [](Found& found) {
+        return [&found](std::size_t cpi, std::size_t beam, const std::vector<Detection>& detections) {
+            for (const Detection& detection : detections) found.push_back({ cpi, beam, detection.range, detection.doppler });
+        };
+    };
+    Found serial, threaded;
+    ReceivePipeline reference(config, weights_re.data(), weights_im.data(), chirp_re.data(), chirp_im.data(), length);
+    reference.run_serial(generate, collect(serial));
+    IqFileSource file(path, config.samples);
+    assert(file.is_open());
+    ReceivePipeline pipeline(config, weights_re.data(), weights_im.data(), chirp_re.data(), chirp_im.data(), length);
+    pipeline.run(std::ref(file), collect(threaded));
+    std::remove(path);
+
+    assert(reference.cpis() == cpis && pipeline.cpis() == cpis);
+    assert(serial == threaded);
+    for (std::size_t cpi = 0; cpi < cpis; cpi++) {
+        bool found = false;
+        for (const auto& hit : threaded) found = found || (hit[0] == cpi && hit[1] == 2 && hit[2] == 100 && hit[3] == 6);
+        assert(found);
+    }
+    for (std::size_t stage = 0; stage < ReceivePipeline::kStages; stage++) {
+        assert(pipeline.stats(stage).service.count() == (stage == 3 ? cpis : cpis * config.pulses));
+    }
+    std::cout << "SPSC ring wraps; threaded pipeline from a file matches the serial chain (" << threaded.size()
+              << " detections)." << std::endl;
+}
+
+void test_array_geometry() {
+    // A linear geometry steers like AntennaArray
+    AntennaArray<12> array;
+    ArrayGeometry line = ArrayGeometry::linear(12);
+    const float angles[3] = { -0.7f, 0.0f, 0.3f }, zeros[3] = {};
+    AlignedBuffer<float> re(36), im(36), ref_re(36), ref_im(36);
+    line.steering_weights(angles, zeros, 3, re.data(), im.data());
+    array.steering_weights(angles, 3, ref_re.data(), ref_im.data());
+    for (std::size_t i = 0; i < 36; i++) {
+        assert(line.x()[i % 12] == array.elements.position[i % 12]);
+        assert(std::fabs(re[i] - ref_re[i]) < 1e-5 && std::fabs(im[i] - ref_im[i]) < 1e-5);
+    }
+    array.steer(0.3);
+    for (int i = 0; i < 12; i++) {
+        float phase = array.elements.phase[i];
+        array.set_phase(i, 0.3);
+        assert(std::fabs(array.elements.phase[i] - phase) < 1e-5);
+    }
+
+    // Conformal weights against the formula, and a plane wave from the
+    // steered direction adding up to the sum of the tapers
+    ArrayGeometry curved = ArrayGeometry::cylinder(9, 5, 3.0);
+    assert(curved.size() == 45 && std::fabs(curved.x()[4]) < 1e-6 && std::fabs(curved.z()[4]) < 1e-6);
+    for (std::size_t i = 0; i < curved.size(); i++) curved.taper()[i] = 0.5f + 0.01f * i;
+    const float azimuth[2] = { 0.4f, -1.0f }, elevation[2] = { -0.2f, 0.5f };
+    AlignedBuffer<float> wr(2 * 45), wi(2 * 45);
+    curved.steering_weights(azimuth, elevation, 2, wr.data(), wi.data());
+    for (std::size_t b = 0; b < 2; b++) {
+        Direction d = direction(azimuth[b], elevation[b]);
+        assert(std::fabs(d.u * d.u + d.v * d.v + d.w * d.w - 1) < 1e-12);
+        std::complex<double> sum = 0;
+        double tapers = 0;
+        for (std::size_t i = 0; i < 45; i++) {
+            double phase = -2 * M_PI * (d.u * curved.x()[i] + d.v * curved.y()[i] + d.w * curved.z()[i]);
+            std::complex<double> w(wr[b * 45 + i], wi[b * 45 + i]);
+            assert(std::abs(w - std::polar(double(curved.taper()[i]), phase)) < 1e-5);
+            sum += std::conj(w) * std::polar(1.0, phase);
+            tapers += curved.taper()[i];
+        }
+        assert(std::fabs(sum.real() - tapers) < 1e-3 && std::fabs(sum.imag()) < 1e-3);
+    }
+
+    // Configuration strings and position files
+    ArrayGeometry parsed;
+    assert(ArrayGeometry::parse("planar:4x3", parsed) && parsed.size() == 12);
+    assert(parsed.x()[0] == -0.75f && parsed.y()[0] == -0.5f && parsed.x()[11] == 0.75f && parsed.y()[11] == 0.5f);
+    assert(ArrayGeometry::parse("linear:7", parsed) && parsed.size() == 7);
+    assert(!ArrayGeometry::parse("planar:4", parsed) && !ArrayGeometry::parse("/nonexistent/array.txt", parsed));
+    const char* path = "/tmp/phased_array_test_positions.txt";
+    std::FILE* file = std::fopen(path, "w");
+    assert(file != nullptr);
+    std::fputs("# x y z taper\n0 0 0\n0.5 0 -0.1 0.8  # tilted\n\n1 0.25 0\n", file);
+    std::fclose(file);
+    assert(ArrayGeometry::parse(path, parsed) && parsed.size() == 3);
+    assert(parsed.z()[1] == -0.1f && parsed.taper()[1] == 0.8f && parsed.taper()[2] == 1.0f && parsed.y()[2] == 0.25f);
+    file = std::fopen(path, "w");
+    std::fputs("0 0\n", file);
+    std::fclose(file);
+    assert(!ArrayGeometry::load(path, parsed));
+    file = std::fopen(path, "w");
+    std::fputs("x y z\n0 0 0\n", file);
+    std::fclose(file);
+    assert(!ArrayGeometry::load(path, parsed));
+    std::remove(path);
+    std::cout << "Array geometry: linear, conformal and file-loaded arrays steer by the dot-product formula."
+              << std::endl;
+}
+
+void test_scene_simulator() {
+    const std::size_t length = 16, samples = 300;
+    AlignedBuffer<float> chirp_re(length), chirp_im(length);
+    lfm_chirp(length, 40e6, 100e6, chirp_re.data(), chirp_im.data());
+    ArrayGeometry geometry = ArrayGeometry::cylinder(6, 4, 2.0);
+
+    // One target, no noise: every element matches the echo formula
+    SceneConfig config;
+    config.noise_power = 0;
+    config.pulses_per_cpi = 16;
+    SceneTarget target = { 150 * kSpeedOfLight / (2 * config.sample_rate), -30, 0.3, 0.1, 0, 0.5 };
+    SceneSimulator quiet(geometry, chirp_re.data(), chirp_im.data(), length, config, { target });
+    SampleBlock block(geometry.size(), samples);
+    std::vector<std::complex<double>> slow(config.pulses_per_cpi);
+    for (std::size_t pulse = 0; pulse < config.pulses_per_cpi; pulse++) {
+        assert(quiet.fill(0, pulse, block));
+        double t = pulse * config.pulse_repetition_interval, range = target.range + target.velocity * t;
+        std::size_t delay = static_cast<std::size_t>(std::llround(2 * range / kSpeedOfLight * config.sample_rate));
+        Direction d = direction(target.azimuth, target.elevation);
+        for (std::size_t e = 0; e < geometry.size(); e++) {
+            double phase = -4 * M_PI * range * config.carrier_freq / kSpeedOfLight -
+                           2 * M_PI * (d.u * geometry.x()[e] + d.v * geometry.y()[e] + d.w * geometry.z()[e]);
+            for (std::size_t s = 0; s < samples; s++) {
+                std::complex<double> expected = 0;
+                if (s >= delay && s < delay + length) {
+                    expected = std::polar(target.amplitude, phase) *
+                               std::complex<double>(chirp_re[s - delay], chirp_im[s - delay]);
+                }
+                assert(std::abs(std::complex<double>(block.element_re(e)[s], block.element_im(e)[s]) - expected) < 1e-3);
+            }
+        }
+        slow[pulse] = std::complex<double>(block.element_re(0)[150], block.element_im(0)[150]);
+    }
+    // Its Doppler lands where doppler_bin says
+    std::size_t peak = 0;
+    double best = 0;
+    for (std::size_t k = 0; k < config.pulses_per_cpi; k++) {
+        std::complex<double> sum = 0;
+        for (std::size_t p = 0; p < config.pulses_per_cpi; p++) {
+            double bin = double(k) - double(config.pulses_per_cpi / 2);
+            sum += slow[p] * std::polar(1.0, -2 * M_PI * bin * p / config.pulses_per_cpi);
+        }
+        if (std::abs(sum) > best) {
+            best = std::abs(sum);
+            peak = k;
+        }
+    }
+    assert(peak == static_cast<std::size_t>(std::lround(quiet.doppler_bin(target))) % config.pulses_per_cpi);
+
+    // Noise and clutter: the same samples for any thread count and call
+    // order, the configured noise power, and an end after config.cpis
+    config.noise_power = 2;
+    config.clutter_patches = 10;
+    config.clutter_power = 0.1;
+    config.clutter_extent = 200;
+    config.cpis = 2;
+    config.threads = 1;
+    SceneSimulator one(geometry, chirp_re.data(), chirp_im.data(), length, config, { target });
+    config.threads = 3;
+    SceneSimulator three(geometry, chirp_re.data(), chirp_im.data(), length, config, { target });
+    assert(three.threads() == 3 && one.clutter().size() == 10);
+    SampleBlock other(geometry.size(), samples);
+    assert(one.fill(1, 7, block));
+    assert(three.fill(0, 2, other) && three.fill(1, 7, other));
+    assert(std::memcmp(block.re.data(), other.re.data(), block.re.size() * sizeof(float)) == 0);
+    assert(std::memcmp(block.im.data(), other.im.data(), block.im.size() * sizeof(float)) == 0);
+    assert(!one.fill(2, 0, block));
+    config.clutter_patches = 0;
+    SceneSimulator noise(geometry, chirp_re.data(), chirp_im.data(), length, config);
+    double power = 0, mean = 0;
+    for (std::size_t pulse = 0; pulse < 8; pulse++) {
+        noise.fill(0, pulse, block);
+        for (std::size_t i = 0; i < block.re.size(); i++) {
+            power += block.re[i] * block.re[i] + block.im[i] * block.im[i];
+            mean += block.re[i];
+        }
+    }
+    power /= 8.0 * block.re.size();
+    mean /= 8.0 * block.re.size();
+    assert(std::fabs(power - 2) < 0.05 && std::fabs(mean) < 0.02);
+    std::cout << "Scene simulator: echoes match the formula, noise power " << power
+              << ", identical samples on 1 and 3 threads." << std::endl;
+}
+
+void test_arena_allocator() {
+    ChunkPool pool(1024, 4);
+    {
+        Arena arena(pool);
+        // Aligned, non-overlapping blocks across chunk boundaries
+        std::vector<std::pair<unsigned char*, std::size_t>> blocks;
+        for (std::size_t i = 0; i < 200; i++) {
+            std::size_t alignment = std::size_t(1) << (i % 8), size = 1 + (i * 37) % 300;
+            unsigned char* block = static_cast<unsigned char*>(arena.allocate(size, alignment));
+            assert(block != nullptr && reinterpret_cast<std::uintptr_t>(block) % alignment == 0);
+            std::memset(block, int(i), size);
+            blocks.push_back({ block, size });
+        }
+        for (std::size_t i = 0; i < blocks.size(); i++) {
+            for (std::size_t k = 0; k < blocks[i].second; k++) assert(blocks[i].first[k] == (i & 0xff));
+        }
+        std::size_t chunks = arena.chunks();
+        assert(chunks > 1);
+
+        // Rewind gives back everything after the marker, oversized blocks
+        // included, and the next allocation reuses the same memory
+        Arena::Marker marker = arena.mark();
+        void* first = arena.allocate(64, 64);
+        double* big = arena.allocate_array<double>(1000);
+        big[999] = 1;
+        assert(arena.chunks() > chunks);
+        arena.rewind(marker);
+        assert(arena.chunks() == chunks && arena.allocate(64, 64) == first);
+        {
+            ArenaScope scope(arena);
+            for (int i = 0; i < 50; i++) arena.allocate(100);
+        }
+        assert(arena.chunks() == chunks && arena.allocate(64, 64) != first);
+        void* last = arena.allocate(40);
+        std::size_t used = arena.used_in_chunk();
+        arena.free_last(last, 40);
+        assert(arena.used_in_chunk() < used && arena.allocate(40) == last);
+        arena.reset();
+        assert(arena.chunks() == 0 && arena.used_in_chunk() == 0);
+    }
+    // The chunks went back to the pool (up to its limit) and get reused
+    std::size_t from_heap = pool.heap_chunks();
+    assert(pool.free_chunks() == 4);
+    {
+        Arena arena(pool);
+        for (int i = 0; i < 4; i++) arena.allocate(1000);
+        assert(pool.heap_chunks() == from_heap && pool.free_chunks() == 0);
+    }
+
+    // Standard containers on the arena
+    {
+        Arena arena(pool);
+        ArenaResource resource(arena);
+        std::pmr::vector<int> values(&resource);
+        std::pmr::map<int, std::pmr::vector<int>> groups(&resource);
+        for (int i = 0; i < 1000; i++) {
+            values.push_back(i);
+            groups[i % 7].push_back(i);
+        }
+        for (int i = 0; i < 1000; i++) assert(values[i] == i);
+        assert(groups.size() == 7 && groups[3].size() == 143 && groups[3][1] == 10);
+        assert(groups.get_allocator().resource() == &resource);
+    }
+
+    // Each thread has its own arena; a thread's chunks outlive it in the
+    // global pool, so the next thread does not go to the heap
+    Arena* main_arena = &thread_arena();
+    auto work = [&] {
+        assert(&thread_arena() != main_arena);
+        for (std::size_t i = 0; i < 3 * kArenaChunkSize / 256; i++) thread_arena().allocate(256);
+        assert(thread_arena().chunks() >= 3);
+    };
+    std::thread(work).join();
+    std::size_t before = ChunkPool::global().heap_chunks();
+    std::thread(work).join();
+    assert(ChunkPool::global().heap_chunks() == before && ChunkPool::global().free_chunks() >= 3);
+    std::cout << "Arena allocator: aligned bumps, rewind, chunks recycled across arenas and threads, pmr containers."
+              << std::endl;
+}
+
+int main() {
+    test_fast_sincos();
+    test_steering_weights();
+    test_update_amplitudes();
+    test_beamformer();
+    test_fft();
+    test_wideband_beamformer();
+    test_pulse_scheduler();
+    test_steering_table();
+    test_pulse_compression();
+    test_range_doppler();
+    test_receive_pipeline();
+    test_array_geometry();
+    test_scene_simulator();
+    test_arena_allocator();
+    std::cout << "All phased array tests passed." << std::endl;
+    return 0;
+}
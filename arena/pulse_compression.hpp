@@ -0,0 +1,138 @@
+// pulse_compression.hpp
+#ifndef PULSE_COMPRESSION_HPP
+#define PULSE_COMPRESSION_HPP
+
+#include "aligned_buffer.hpp"
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// Baseband linear FM chirp of length samples, sweeping [-bandwidth / 2,
+// bandwidth / 2], split into real and imaginary planes
+inline void lfm_chirp(std::size_t length, double bandwidth, double sample_rate, float* re, float* im) {
+    double duration = length / sample_rate, rate = bandwidth / duration;
+    for (std::size_t s = 0; s < length; s++) {
+        double t = s / sample_rate - duration / 2;
+        re[s] = static_cast<float>(std::cos(M_PI * rate * t * t));
+        im[s] = static_cast<float>(std::sin(M_PI * rate * t * t));
+    }
+}
+
+// Matched filter for one transmitted pulse by fast convolution. Range bin
+// n of a receive window x is sum over k of x[n + k] * conj(p[k]) (samples
+// past the window count as zero), the correlation with the pulse p of
+// length L, peaking at an echo's delay with the pulse energy. Overlap-save:
+// each FFT block of fft_size input samples yields fft_size - L + 1 bins,
+// by one forward FFT, one multiply with the stored reference spectrum
+// conj(P) / fft_size and one inverse FFT. Both FFTs run in scrambled bin
+// order (the reference is stored that way), so no bit reversal. The
+// plan, the reference and the block buffers are built once; compress()
+// allocates nothing, so one compressor serves every pulse of every CPI.
+// Not thread-safe: one per thread.
+class PulseCompressor {
+private:
+    std::size_t length_;
+    FftPlan plan_;
+    std::size_t hop_;
+    AlignedBuffer<float> pulse_re_;
+    AlignedBuffer<float> pulse_im_;
+    AlignedBuffer<float> reference_re_;
+    AlignedBuffer<float> reference_im_;
+    AlignedBuffer<float> block_re_;
+    AlignedBuffer<float> block_im_;
+
+    static void multiply(const float* __restrict wr, const float* __restrict wi, float* __restrict xr,
+                         float* __restrict xi, std::size_t count) {
+        for (std::size_t k = 0; k < count; k++) {
+            float r = wr[k] * xr[k] - wi[k] * xi[k];
+            xi[k] = wr[k] * xi[k] + wi[k] * xr[k];
+            xr[k] = r;
+        }
+    }
+
+public:
+    // FFT size with the fewest flops per output bin for a pulse of length
+    // samples (2 transforms of 5 F log2 F plus 6 F for the multiply, over
+    // F - length + 1 bins), but no larger than the first power of two
+    // >= 4 * length: past that the flop count drops by a few percent while
+    // the block falls out of L1, and it runs slower
+    static std::size_t best_fft_size(std::size_t length) {
+        std::size_t best = 0;
+        double best_cost = 0;
+        for (std::size_t size = 2; size <= (std::size_t(1) << 20); size *= 2) {
+            if (size < length) continue;
+            if (best != 0 && size / 2 >= 4 * length) break;
+            double cost = (10 * size * std::log2(double(size)) + 6 * size) / double(size - length + 1);
+            if (best == 0 || cost < best_cost) {
+                best = size;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    // Pulse samples as transmitted; fft_size a power of two >= length, or 0
+    // for best_fft_size(length). window applies a Hamming taper to the
+    // reference, trading 1.4x wider peaks for -43 dB range sidelobes.
+    PulseCompressor(const float* pulse_re, const float* pulse_im, std::size_t length, std::size_t fft_size = 0,
+                    bool window = false)
+        : length_(length), plan_(fft_size ? fft_size : best_fft_size(length)),
+          hop_(plan_.size() - length + 1), pulse_re_(length), pulse_im_(length), reference_re_(plan_.size()),
+          reference_im_(plan_.size()), block_re_(plan_.size()), block_im_(plan_.size()) {
+        std::memcpy(pulse_re_.data(), pulse_re, length * sizeof(float));
+        std::memcpy(pulse_im_.data(), pulse_im, length * sizeof(float));
+        std::size_t size = plan_.size();
+        for (std::size_t k = 0; k < length; k++) {
+            float taper = 1.0f;
+            if (window && length > 1) taper = static_cast<float>(0.54 - 0.46 * std::cos(2 * M_PI * k / (length - 1)));
+            reference_re_[k] = taper * pulse_re[k];
+            reference_im_[k] = taper * pulse_im[k];
+        }
+        plan_.forward_scrambled(reference_re_.data(), reference_im_.data());
+        for (std::size_t k = 0; k < size; k++) {
+            reference_re_[k] /= size;
+            reference_im_[k] = -reference_im_[k] / size;
+        }
+    }
+
+    std::size_t length() const { return length_; }
+    std::size_t fft_size() const { return plan_.size(); }
+    std::size_t hop() const { return hop_; }
+    const float* pulse_re() const { return pulse_re_.data(); }
+    const float* pulse_im() const { return pulse_im_.data(); }
+
+    // Compresses one receive window of samples into as many range bins;
+    // in and out may not overlap
+    void compress(const float* in_re, const float* in_im, std::size_t samples, float* out_re, float* out_im) {
+        const std::size_t size = plan_.size();
+        float* xr = block_re_.data();
+        float* xi = block_im_.data();
+        for (std::size_t start = 0; start < samples; start += hop_) {
+            std::size_t count = std::min(size, samples - start);
+            std::memcpy(xr, in_re + start, count * sizeof(float));
+            std::memcpy(xi, in_im + start, count * sizeof(float));
+            std::fill(xr + count, xr + size, 0.0f);
+            std::fill(xi + count, xi + size, 0.0f);
+            plan_.forward_scrambled(xr, xi);
+            multiply(reference_re_.data(), reference_im_.data(), xr, xi, size);
+            plan_.inverse_scrambled(xr, xi);
+            std::size_t bins = std::min(hop_, samples - start);
+            std::memcpy(out_re + start, xr, bins * sizeof(float));
+            std::memcpy(out_im + start, xi, bins * sizeof(float));
+        }
+    }
+
+    // A coherent processing interval: pulses receive windows of samples
+    // each, pulse-major, into pulse-major range bins
+    void compress_cpi(const float* in_re, const float* in_im, std::size_t pulses, std::size_t samples, float* out_re,
+                      float* out_im) {
+        for (std::size_t p = 0; p < pulses; p++) {
+            compress(in_re + p * samples, in_im + p * samples, samples, out_re + p * samples, out_im + p * samples);
+        }
+    }
+};
+
+#endif // PULSE_COMPRESSION_HPP
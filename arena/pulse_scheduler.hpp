@@ -0,0 +1,226 @@
+// pulse_scheduler.hpp
+#ifndef PULSE_SCHEDULER_HPP
+#define PULSE_SCHEDULER_HPP
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// One beam position: pulses pulses at a fixed repetition interval
+struct Dwell {
+    double angle;                       // radians off broadside
+    std::size_t pulses;
+    double pulse_repetition_interval;   // seconds
+};
+
+struct PulseEvent {
+    std::size_t channel;
+    std::size_t dwell;                  // index into the channel's schedule
+    std::size_t pulse;                  // within the dwell
+    double angle;
+    std::int64_t deadline_ns;           // CLOCK_MONOTONIC
+    std::int64_t lateness_ns;           // fire time minus deadline
+};
+
+// Lateness counts in power-of-two nanosecond buckets: bucket 0 is < 1 ns,
+// bucket i is [2^(i-1), 2^i) ns. Fixed size, so recording never allocates.
+class LatenessHistogram {
+public:
+    static constexpr std::size_t kBuckets = 40;
+
+private:
+    std::uint64_t buckets_[kBuckets] = {};
+    std::uint64_t count_ = 0;
+    std::int64_t max_ = 0;
+    double sum_ = 0;
+
+public:
+    void record(std::int64_t lateness_ns) {
+        std::size_t bucket = 0;
+        if (lateness_ns > 0) {
+            bucket = 64 - __builtin_clzll(static_cast<unsigned long long>(lateness_ns));
+            if (bucket >= kBuckets) bucket = kBuckets - 1;
+        }
+        buckets_[bucket]++;
+        count_++;
+        if (lateness_ns > max_) max_ = lateness_ns;
+        sum_ += lateness_ns;
+    }
+
+    std::uint64_t count() const { return count_; }
+    std::int64_t max() const { return max_; }
+    double mean() const { return count_ ? sum_ / count_ : 0; }
+    std::uint64_t bucket(std::size_t i) const { return buckets_[i]; }
+
+    // Upper bound of the bucket holding quantile q, in nanoseconds
+    std::int64_t quantile(double q) const {
+        std::uint64_t target = static_cast<std::uint64_t>(std::ceil(q * count_)), seen = 0;
+        for (std::size_t i = 0; i < kBuckets; i++) {
+            seen += buckets_[i];
+            if (seen >= target && seen > 0) return i == 0 ? 1 : std::int64_t(1) << i;
+        }
+        return max_;
+    }
+
+    void print(const char* label) const {
+        std::printf("%s: %llu pulses, lateness mean %.1f us, p50 < %.1f us, p99 < %.1f us, max %.1f us\n", label,
+                    static_cast<unsigned long long>(count_), mean() / 1e3, quantile(0.5) / 1e3, quantile(0.99) / 1e3,
+                    max_ / 1e3);
+    }
+};
+
+// Fires pulses for several arrays (channels) from one thread on absolute
+// CLOCK_MONOTONIC deadlines. Each channel walks its own dwell schedule;
+// pulse n of a dwell is due at dwell start + n * interval, computed from
+// the start rather than by adding intervals, so nothing accumulates, and
+// a late pulse does not push back the ones after it. The thread sleeps
+// with clock_nanosleep(TIMER_ABSTIME) until spin_ns before the earliest
+// deadline across channels, then spins on the clock for the rest: the
+// wake-up latency of the sleep (tens of microseconds on a loaded kernel)
+// lands in the spin window instead of in the pulse. spin_ns = 0 sleeps
+// all the way. Lateness of every pulse goes to the channel's histogram.
+class PulseScheduler {
+public:
+    using Fire = std::function<void(const PulseEvent&)>;
+
+private:
+    struct Channel {
+        std::vector<Dwell> schedule;
+        Fire fire;
+        std::size_t cycles;             // passes over the schedule, 0 = forever
+        std::size_t cycle = 0;
+        std::size_t dwell = 0;
+        std::size_t pulse = 0;
+        std::int64_t dwell_start_ns = 0;
+        std::int64_t next_ns = 0;
+        bool done = false;
+        LatenessHistogram lateness;
+    };
+
+    std::vector<Channel> channels_;
+    std::int64_t spin_ns_;
+    bool started_ = false;
+
+    static std::int64_t interval_ns(double seconds, std::size_t n) {
+        return static_cast<std::int64_t>(std::llround(seconds * 1e9 * static_cast<double>(n)));
+    }
+
+    void set_next(Channel& channel) {
+        const Dwell& dwell = channel.schedule[channel.dwell];
+        channel.next_ns = channel.dwell_start_ns + interval_ns(dwell.pulse_repetition_interval, channel.pulse);
+    }
+
+    void advance(Channel& channel) {
+        const Dwell& dwell = channel.schedule[channel.dwell];
+        if (++channel.pulse < dwell.pulses) {
+            set_next(channel);
+            return;
+        }
+        channel.dwell_start_ns += interval_ns(dwell.pulse_repetition_interval, dwell.pulses);
+        channel.pulse = 0;
+        if (++channel.dwell == channel.schedule.size()) {
+            channel.dwell = 0;
+            if (++channel.cycle == channel.cycles) {
+                channel.done = true;
+                return;
+            }
+        }
+        set_next(channel);
+    }
+
+    void wait_until(std::int64_t deadline_ns) const {
+        std::int64_t wake_ns = deadline_ns - spin_ns_;
+        if (wake_ns > now_ns()) {
+            timespec wake = { static_cast<time_t>(wake_ns / 1000000000), static_cast<long>(wake_ns % 1000000000) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) == EINTR) {
+            }
+        }
+        while (now_ns() < deadline_ns) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+
+public:
+    explicit PulseScheduler(std::int64_t spin_ns = 0) : spin_ns_(spin_ns) {}
+
+    static std::int64_t now_ns() {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    // Asks for SCHED_FIFO on the calling thread, so load at normal
+    // priority cannot delay the wake-up; false without the privilege
+    static bool set_realtime_priority(int priority = 50) {
+        sched_param param{};
+        param.sched_priority = priority;
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+
+    // Channel whose first pulse is due start_offset_ns after the first run
+    // begins; returns the channel index. Add channels before running.
+    // Empty schedules and dwells are not allowed.
+    std::size_t add_channel(std::vector<Dwell> schedule, Fire fire, std::size_t cycles = 1,
+                            std::int64_t start_offset_ns = 0) {
+        Channel channel;
+        channel.schedule = std::move(schedule);
+        channel.fire = std::move(fire);
+        channel.cycles = cycles;
+        channel.dwell_start_ns = start_offset_ns;
+        channels_.push_back(std::move(channel));
+        return channels_.size() - 1;
+    }
+
+    std::size_t channels() const { return channels_.size(); }
+    const LatenessHistogram& lateness(std::size_t channel) const { return channels_[channel].lateness; }
+
+    // Fires pulses in deadline order until every channel has finished its
+    // cycles or duration_seconds have passed (< 0: no limit). Ties go to
+    // the lower channel index. The first call starts the schedules; later
+    // calls carry on from the same timeline, so pulses that fell due in
+    // between fire at once and count as late.
+    void run(double duration_seconds = -1) {
+        std::int64_t start_ns = now_ns();
+        std::int64_t end_ns = duration_seconds < 0 ? std::numeric_limits<std::int64_t>::max()
+                                                   : start_ns + static_cast<std::int64_t>(duration_seconds * 1e9);
+        if (!started_) {
+            for (Channel& channel : channels_) {
+                channel.dwell_start_ns += start_ns;
+                set_next(channel);
+            }
+            started_ = true;
+        }
+        for (;;) {
+            Channel* next = nullptr;
+            for (Channel& channel : channels_) {
+                if (!channel.done && (next == nullptr || channel.next_ns < next->next_ns)) next = &channel;
+            }
+            if (next == nullptr || next->next_ns >= end_ns) break;
+            wait_until(next->next_ns);
+            PulseEvent event;
+            event.channel = static_cast<std::size_t>(next - channels_.data());
+            event.dwell = next->dwell;
+            event.pulse = next->pulse;
+            event.angle = next->schedule[next->dwell].angle;
+            event.deadline_ns = next->next_ns;
+            event.lateness_ns = now_ns() - next->next_ns;
+            next->lateness.record(event.lateness_ns);
+            next->fire(event);
+            advance(*next);
+        }
+    }
+};
+
+#endif // PULSE_SCHEDULER_HPP
@@ -0,0 +1,177 @@
+// range_doppler.hpp
+#ifndef RANGE_DOPPLER_HPP
+#define RANGE_DOPPLER_HPP
+
+#include "aligned_buffer.hpp"
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Transposes a rows x cols plane into cols x rows in kCornerTurnTile
+// square tiles: one tile of the source and one of the destination
+// (4 KB each) stay in L1 while it is turned, instead of every read or
+// every write of a whole row landing on a different line
+constexpr std::size_t kCornerTurnTile = 32;
+
+inline void corner_turn(const float* __restrict in, std::size_t rows, std::size_t cols, float* __restrict out) {
+    for (std::size_t r0 = 0; r0 < rows; r0 += kCornerTurnTile) {
+        std::size_t r1 = std::min(r0 + kCornerTurnTile, rows);
+        for (std::size_t c0 = 0; c0 < cols; c0 += kCornerTurnTile) {
+            std::size_t c1 = std::min(c0 + kCornerTurnTile, cols);
+            for (std::size_t c = c0; c < c1; c++) {
+                for (std::size_t r = r0; r < r1; r++) out[c * rows + r] = in[r * cols + c];
+            }
+        }
+    }
+}
+
+// Cell-averaging CFAR around each cell under test: training cells fill a
+// (2 * (guard + training) + 1)-wide window along range and Doppler, minus
+// the guard window in its middle
+struct CfarConfig {
+    std::size_t guard_range = 2;
+    std::size_t guard_doppler = 1;
+    std::size_t training_range = 8;
+    std::size_t training_doppler = 4;
+    double false_alarm_rate = 1e-6;
+
+    std::size_t reference_cells() const {
+        return (2 * (guard_range + training_range) + 1) * (2 * (guard_doppler + training_doppler) + 1) -
+               (2 * guard_range + 1) * (2 * guard_doppler + 1);
+    }
+
+    // Threshold over the mean of the reference cells for exponentially
+    // distributed (square-law detected Gaussian) noise
+    double scale() const {
+        double n = static_cast<double>(reference_cells());
+        return n * (std::pow(false_alarm_rate, -1.0 / n) - 1);
+    }
+};
+
+struct Detection {
+    std::size_t range;
+    std::size_t doppler;    // zero Doppler at pulses / 2
+    float power;
+    float noise;            // mean of the reference cells
+};
+
+// Range-Doppler map and CA-CFAR detection for one coherent processing
+// interval of pulse-compressed returns. process() corner-turns the CPI
+// from pulse-major to range-major, runs a Hann-windowed FFT across the
+// pulses of each range bin, and keeps |X|^2 with zero Doppler in the
+// middle. CFAR then needs the sum over a window around every cell; a
+// summed-area table (double, so a million cells do not lose precision)
+// turns each window sum into four lookups, so the cost per cell does not
+// depend on the window size. Detections are the cells above
+// scale * noise that are also the largest in their 3 x 3 neighbourhood.
+// Near the edges the windows are clipped to the map. pulses must be a
+// power of two. All buffers are allocated up front.
+class RangeDopplerProcessor {
+private:
+    std::size_t pulses_;
+    std::size_t bins_;
+    CfarConfig cfar_;
+    FftPlan plan_;
+    AlignedBuffer<float> window_;
+    AlignedBuffer<float> turned_re_;    // [range][pulse]
+    AlignedBuffer<float> turned_im_;
+    AlignedBuffer<float> power_;        // [range][doppler]
+    AlignedBuffer<double> table_;       // [range + 1][doppler + 1]
+    std::vector<std::size_t> doppler_of_;
+
+public:
+    RangeDopplerProcessor(std::size_t pulses, std::size_t bins, CfarConfig cfar = CfarConfig())
+        : pulses_(pulses), bins_(bins), cfar_(cfar), plan_(pulses), window_(pulses), turned_re_(pulses * bins),
+          turned_im_(pulses * bins), power_(pulses * bins), table_((pulses + 1) * (bins + 1)), doppler_of_(pulses) {
+        for (std::size_t p = 0; p < pulses; p++) {
+            window_[p] = static_cast<float>(0.5 - 0.5 * std::cos(2 * M_PI * (p + 0.5) / pulses));
+            doppler_of_[p] = (plan_.scrambled_bin(p) + pulses / 2) % pulses;
+        }
+    }
+
+    std::size_t pulses() const { return pulses_; }
+    std::size_t bins() const { return bins_; }
+    const CfarConfig& cfar() const { return cfar_; }
+    // |X|^2, [range][doppler]
+    const float* power() const { return power_.data(); }
+
+    // Corner turn, Doppler FFT and power; input is pulse-major [pulses x bins]
+    void form_map(const float* re, const float* im) {
+        corner_turn(re, pulses_, bins_, turned_re_.data());
+        corner_turn(im, pulses_, bins_, turned_im_.data());
+        for (std::size_t r = 0; r < bins_; r++) {
+            float* __restrict xr = turned_re_.data() + r * pulses_;
+            float* __restrict xi = turned_im_.data() + r * pulses_;
+            const float* __restrict w = window_.data();
+            for (std::size_t p = 0; p < pulses_; p++) {
+                xr[p] *= w[p];
+                xi[p] *= w[p];
+            }
+            plan_.forward_scrambled(xr, xi);
+            float* row = power_.data() + r * pulses_;
+            for (std::size_t p = 0; p < pulses_; p++) row[doppler_of_[p]] = xr[p] * xr[p] + xi[p] * xi[p];
+        }
+    }
+
+    // CA-CFAR over the map from form_map; appends to detections
+    void detect(std::vector<Detection>& detections) {
+        const std::size_t stride = pulses_ + 1;
+        std::fill(table_.data(), table_.data() + stride, 0.0);
+        for (std::size_t r = 0; r < bins_; r++) {
+            const float* row = power_.data() + r * pulses_;
+            const double* above = table_.data() + r * stride;
+            double* sums = table_.data() + (r + 1) * stride;
+            double running = 0;
+            sums[0] = 0;
+            for (std::size_t d = 0; d < pulses_; d++) {
+                running += row[d];
+                sums[d + 1] = above[d + 1] + running;
+            }
+        }
+
+        const std::size_t outer_r = cfar_.guard_range + cfar_.training_range;
+        const std::size_t outer_d = cfar_.guard_doppler + cfar_.training_doppler;
+        const double scale = cfar_.scale();
+        for (std::size_t r = 0; r < bins_; r++) {
+            std::size_t r0 = r > outer_r ? r - outer_r : 0, r1 = std::min(r + outer_r + 1, bins_);
+            std::size_t g0 = r > cfar_.guard_range ? r - cfar_.guard_range : 0;
+            std::size_t g1 = std::min(r + cfar_.guard_range + 1, bins_);
+            const double* outer_top = table_.data() + r0 * stride;
+            const double* outer_bottom = table_.data() + r1 * stride;
+            const double* guard_top = table_.data() + g0 * stride;
+            const double* guard_bottom = table_.data() + g1 * stride;
+            const float* row = power_.data() + r * pulses_;
+            for (std::size_t d = 0; d < pulses_; d++) {
+                std::size_t d0 = d > outer_d ? d - outer_d : 0, d1 = std::min(d + outer_d + 1, pulses_);
+                std::size_t e0 = d > cfar_.guard_doppler ? d - cfar_.guard_doppler : 0;
+                std::size_t e1 = std::min(d + cfar_.guard_doppler + 1, pulses_);
+                double training = (outer_bottom[d1] - outer_top[d1] - outer_bottom[d0] + outer_top[d0]) -
+                                  (guard_bottom[e1] - guard_top[e1] - guard_bottom[e0] + guard_top[e0]);
+                double cells = double((r1 - r0) * (d1 - d0) - (g1 - g0) * (e1 - e0));
+                // power > scale * training / cells, without the division
+                if (row[d] * cells <= scale * training) continue;
+                // Keep only the peak of each cluster of crossings
+                bool peak = true;
+                for (std::size_t i = (r > 0 ? r - 1 : 0); i <= std::min(r + 1, bins_ - 1) && peak; i++) {
+                    for (std::size_t j = (d > 0 ? d - 1 : 0); j <= std::min(d + 1, pulses_ - 1); j++) {
+                        if (power_[i * pulses_ + j] > row[d]) {
+                            peak = false;
+                            break;
+                        }
+                    }
+                }
+                if (peak) detections.push_back({ r, d, row[d], static_cast<float>(training / cells) });
+            }
+        }
+    }
+
+    void process(const float* re, const float* im, std::vector<Detection>& detections) {
+        form_map(re, im);
+        detect(detections);
+    }
+};
+
+#endif // RANGE_DOPPLER_HPP
@@ -0,0 +1,477 @@
+// receive_pipeline.hpp
+#ifndef RECEIVE_PIPELINE_HPP
+#define RECEIVE_PIPELINE_HPP
+
+#include "aligned_buffer.hpp"
+#include "beamformer.hpp"
+#include "pulse_compression.hpp"
+#include "pulse_scheduler.hpp"
+#include "range_doppler.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Single-producer single-consumer ring of trivially copyable T (block
+// pointers, here). The AtomicBuffer scheme with three changes for rates
+// of a block every few microseconds: the capacity is a power of two and
+// the indices run freely, so wrapping is a mask and every slot is usable;
+// head and tail live on separate cache lines; and each side keeps a copy
+// of the other's index and only rereads the shared one when the ring
+// looks full (or empty) by its copy.
+template <typename T>
+class SpscRing {
+private:
+    AlignedBuffer<T> slots_;
+    std::size_t mask_;
+    alignas(kBufferAlignment) std::atomic<std::size_t> head_{ 0 };   // consumer's
+    std::size_t cached_tail_ = 0;
+    alignas(kBufferAlignment) std::atomic<std::size_t> tail_{ 0 };   // producer's
+    std::size_t cached_head_ = 0;
+
+public:
+    // capacity a power of two
+    explicit SpscRing(std::size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    bool push(const T& item) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity()) return false;
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return false;
+        }
+        item = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Smallest power of two >= count
+inline std::size_t ring_capacity(std::size_t count) {
+    std::size_t capacity = 1;
+    while (capacity < count) capacity *= 2;
+    return capacity;
+}
+
+// Spins a little, then yields, then sleeps in short naps: with fewer
+// cores than stages, a stage spinning or yielding on an empty ring takes
+// time from the one it waits for
+inline void pipeline_backoff(unsigned& spins) {
+    spins++;
+    if (spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else if (spins < 80) {
+        std::this_thread::yield();
+    } else {
+        timespec nap = { 0, 20000 };
+        nanosleep(&nap, nullptr);
+    }
+}
+
+// A fixed set of blocks made up front and recycled through a ring of free
+// pointers. One thread acquires and one releases: the two ends of the
+// stretch of pipeline the blocks travel along.
+template <typename Block>
+class BlockPool {
+private:
+    std::vector<std::unique_ptr<Block>> blocks_;
+    SpscRing<Block*> free_;
+    Block* held_ = nullptr;             // put back by the acquiring side
+
+public:
+    template <typename Make>
+    BlockPool(std::size_t count, Make make) : free_(ring_capacity(count)) {
+        for (std::size_t i = 0; i < count; i++) {
+            blocks_.push_back(make());
+            free_.push(blocks_.back().get());
+        }
+    }
+
+    std::size_t size() const { return blocks_.size(); }
+
+    // Waits for a free block
+    Block* acquire() {
+        if (held_ != nullptr) return std::exchange(held_, nullptr);
+        Block* block;
+        unsigned spins = 0;
+        while (!free_.pop(block)) pipeline_backoff(spins);
+        return block;
+    }
+
+    // From the releasing side; never waits, the ring holds every block
+    void release(Block* block) { free_.push(block); }
+
+    // From the acquiring side, a block it did not use, for its next
+    // acquire(): release() from there would make two producers
+    void put_back(Block* block) { held_ = block; }
+};
+
+// One pulse's receive window on every element
+struct PulseFrame {
+    SampleBlock samples;
+    std::size_t cpi = 0;
+    std::size_t pulse = 0;
+    std::int64_t ingest_ns = 0;         // when ingest started on it
+    std::int64_t sent_ns = 0;           // when the previous stage pushed it
+
+    PulseFrame(std::size_t elements, std::size_t samples) : samples(elements, samples) {}
+};
+
+// One pulse beamformed, beam-major [beams x range bins]
+struct BeamFrame {
+    AlignedBuffer<float> re;
+    AlignedBuffer<float> im;
+    std::size_t cpi = 0;
+    std::size_t pulse = 0;
+    std::int64_t ingest_ns = 0;
+    std::int64_t sent_ns = 0;
+
+    BeamFrame(std::size_t beams, std::size_t samples) : re(beams * samples), im(beams * samples) {}
+};
+
+// One CPI compressed, [beam][pulse][range bin]
+struct CpiFrame {
+    AlignedBuffer<float> re;
+    AlignedBuffer<float> im;
+    std::size_t cpi = 0;
+    std::int64_t ingest_ns = 0;         // of its first pulse
+    std::int64_t sent_ns = 0;
+
+    CpiFrame(std::size_t beams, std::size_t pulses, std::size_t samples)
+        : re(beams * pulses * samples), im(beams * pulses * samples) {}
+};
+
+struct PipelineConfig {
+    std::size_t elements;
+    std::size_t beams;
+    std::size_t samples;                // range bins per pulse
+    std::size_t pulses;                 // per CPI, a power of two
+    std::size_t pulse_frames = 8;       // pool sizes
+    std::size_t beam_frames = 8;
+    std::size_t cpi_frames = 2;
+    int first_core = 0;                 // stage i on core (first_core + i) % cores; < 0: not pinned
+};
+
+// Time a stage spent per block, waiting in its input ring and working on it
+struct StageStats {
+    LatenessHistogram queue;
+    LatenessHistogram service;
+    std::int64_t busy_ns = 0;
+};
+
+// The receive chain as four threads: ingest fills pulse frames from a
+// source (a file, a generator), beamform turns each into beams, compress
+// matched-filters every beam into the current CPI frame, and detect runs
+// the range-Doppler map and CFAR per beam once a CPI is complete and
+// hands the detections to a sink. Neighbouring stages are joined by
+// SpscRings of block pointers, so a block of samples is never copied
+// between threads, and each kind of block comes from a BlockPool that
+// the consuming stage returns it to. The pools, rings, kernels and the
+// detection list are all sized in the constructor: once the detection
+// list has grown to the largest count a CPI produces, run() allocates
+// nothing after its threads start. A full ring or an empty pool makes
+// the stage before it wait, which bounds the memory and the backlog.
+// A null block pushed down the chain ends the run; a partial CPI at the
+// end is dropped.
+class ReceivePipeline {
+public:
+    static constexpr std::size_t kStages = 4;
+    // Fills the block with pulse `pulse` of CPI `cpi`; false ends the stream
+    using Source = std::function<bool(std::size_t cpi, std::size_t pulse, SampleBlock& block)>;
+    // Detections of one beam of one CPI, valid during the call
+    using Sink = std::function<void(std::size_t cpi, std::size_t beam, const std::vector<Detection>& detections)>;
+
+    static const char* stage_name(std::size_t stage) {
+        static const char* const names[kStages] = { "ingest", "beamform", "compress", "detect" };
+        return names[stage];
+    }
+
+private:
+    PipelineConfig config_;
+    Beamformer beamformer_;
+    PulseCompressor compressor_;
+    RangeDopplerProcessor processor_;
+    BlockPool<PulseFrame> pulse_pool_;
+    BlockPool<BeamFrame> beam_pool_;
+    BlockPool<CpiFrame> cpi_pool_;
+    SpscRing<PulseFrame*> to_beamform_;
+    SpscRing<BeamFrame*> to_compress_;
+    SpscRing<CpiFrame*> to_detect_;
+    std::vector<Detection> detections_;
+    StageStats stats_[kStages];
+    LatenessHistogram end_to_end_;
+    bool pinned_[kStages] = {};
+    std::size_t cpis_ = 0;
+
+    template <typename T>
+    static void send(SpscRing<T*>& ring, T* block) {
+        unsigned spins = 0;
+        while (!ring.push(block)) pipeline_backoff(spins);
+    }
+
+    template <typename T>
+    static T* receive(SpscRing<T*>& ring) {
+        T* block;
+        unsigned spins = 0;
+        while (!ring.pop(block)) pipeline_backoff(spins);
+        return block;
+    }
+
+    static bool pin_to_core(std::thread& thread, int core) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+    }
+
+    void record(std::size_t stage, std::int64_t sent_ns, std::int64_t start_ns, std::int64_t end_ns) {
+        stats_[stage].queue.record(start_ns - sent_ns);
+        stats_[stage].service.record(end_ns - start_ns);
+        stats_[stage].busy_ns += end_ns - start_ns;
+    }
+
+    void ingest(const Source& source) {
+        for (std::size_t cpi = 0;; cpi++) {
+            for (std::size_t pulse = 0; pulse < config_.pulses; pulse++) {
+                PulseFrame* frame = pulse_pool_.acquire();
+                std::int64_t start = PulseScheduler::now_ns();
+                if (!source(cpi, pulse, frame->samples)) {
+                    pulse_pool_.put_back(frame);
+                    send<PulseFrame>(to_beamform_, nullptr);
+                    return;
+                }
+                frame->cpi = cpi;
+                frame->pulse = pulse;
+                frame->ingest_ns = start;
+                frame->sent_ns = PulseScheduler::now_ns();
+                record(0, start, start, frame->sent_ns);
+                send(to_beamform_, frame);
+            }
+        }
+    }
+
+    void beamform() {
+        for (;;) {
+            PulseFrame* in = receive(to_beamform_);
+            if (in == nullptr) break;
+            BeamFrame* out = beam_pool_.acquire();
+            std::int64_t start = PulseScheduler::now_ns();
+            beamformer_.form_beams(in->samples, out->re.data(), out->im.data());
+            out->cpi = in->cpi;
+            out->pulse = in->pulse;
+            out->ingest_ns = in->ingest_ns;
+            std::int64_t sent = in->sent_ns;
+            pulse_pool_.release(in);
+            out->sent_ns = PulseScheduler::now_ns();
+            record(1, sent, start, out->sent_ns);
+            send(to_compress_, out);
+        }
+        send<BeamFrame>(to_compress_, nullptr);
+    }
+
+    void compress() {
+        const std::size_t samples = config_.samples, pulses = config_.pulses;
+        CpiFrame* cpi = nullptr;
+        for (;;) {
+            BeamFrame* in = receive(to_compress_);
+            if (in == nullptr) break;
+            if (cpi == nullptr) cpi = cpi_pool_.acquire();
+            std::int64_t start = PulseScheduler::now_ns();
+            if (in->pulse == 0) {
+                cpi->cpi = in->cpi;
+                cpi->ingest_ns = in->ingest_ns;
+            }
+            for (std::size_t b = 0; b < config_.beams; b++) {
+                std::size_t offset = (b * pulses + in->pulse) * samples;
+                compressor_.compress(in->re.data() + b * samples, in->im.data() + b * samples, samples,
+                                     cpi->re.data() + offset, cpi->im.data() + offset);
+            }
+            bool last = in->pulse + 1 == pulses;
+            std::int64_t sent = in->sent_ns;
+            beam_pool_.release(in);
+            std::int64_t end = PulseScheduler::now_ns();
+            record(2, sent, start, end);
+            if (last) {
+                cpi->sent_ns = end;
+                send(to_detect_, cpi);
+                cpi = nullptr;
+            }
+        }
+        if (cpi != nullptr) cpi_pool_.put_back(cpi);
+        send<CpiFrame>(to_detect_, nullptr);
+    }
+
+    void detect(const Sink& sink) {
+        const std::size_t plane = config_.pulses * config_.samples;
+        for (;;) {
+            CpiFrame* in = receive(to_detect_);
+            if (in == nullptr) break;
+            std::int64_t start = PulseScheduler::now_ns();
+            for (std::size_t b = 0; b < config_.beams; b++) {
+                detections_.clear();
+                processor_.process(in->re.data() + b * plane, in->im.data() + b * plane, detections_);
+                sink(in->cpi, b, detections_);
+            }
+            std::int64_t ingest = in->ingest_ns, sent = in->sent_ns;
+            cpi_pool_.release(in);
+            std::int64_t end = PulseScheduler::now_ns();
+            record(3, sent, start, end);
+            end_to_end_.record(end - ingest);
+            cpis_++;
+        }
+    }
+
+public:
+    // weights beam-major [beams x elements] as for Beamformer::set_weights;
+    // pulse_re/pulse_im the transmitted pulse of pulse_length samples
+    ReceivePipeline(const PipelineConfig& config, const float* weights_re, const float* weights_im,
+                    const float* pulse_re, const float* pulse_im, std::size_t pulse_length,
+                    CfarConfig cfar = CfarConfig(), std::size_t max_detections = 4096)
+        : config_(config), beamformer_(config.elements, config.beams),
+          compressor_(pulse_re, pulse_im, pulse_length, 0, true), processor_(config.pulses, config.samples, cfar),
+          pulse_pool_(config.pulse_frames,
+                      [&] { return std::make_unique<PulseFrame>(config.elements, config.samples); }),
+          beam_pool_(config.beam_frames, [&] { return std::make_unique<BeamFrame>(config.beams, config.samples); }),
+          cpi_pool_(config.cpi_frames,
+                    [&] { return std::make_unique<CpiFrame>(config.beams, config.pulses, config.samples); }),
+          to_beamform_(ring_capacity(config.pulse_frames + 1)), to_compress_(ring_capacity(config.beam_frames + 1)),
+          to_detect_(ring_capacity(config.cpi_frames + 1)) {
+        beamformer_.set_weights(weights_re, weights_im);
+        detections_.reserve(max_detections);
+    }
+
+    const PipelineConfig& config() const { return config_; }
+    const StageStats& stats(std::size_t stage) const { return stats_[stage]; }
+    // First pulse ingested to detections handed over, per CPI
+    const LatenessHistogram& end_to_end() const { return end_to_end_; }
+    bool pinned(std::size_t stage) const { return pinned_[stage]; }
+    std::size_t cpis() const { return cpis_; }
+
+    // Runs the four stages on their own threads until the source ends
+    void run(const Source& source, const Sink& sink) {
+        std::thread threads[kStages] = { std::thread([&] { ingest(source); }), std::thread([&] { beamform(); }),
+                                         std::thread([&] { compress(); }), std::thread([&] { detect(sink); }) };
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        for (std::size_t stage = 0; stage < kStages; stage++) {
+            if (config_.first_core >= 0 && cores > 0) {
+                pinned_[stage] = pin_to_core(threads[stage], (config_.first_core + int(stage)) % cores);
+            }
+        }
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    // The same chain one pulse at a time on the calling thread, for
+    // comparison; stage stats record service times only
+    void run_serial(const Source& source, const Sink& sink) {
+        PulseFrame* frame = pulse_pool_.acquire();
+        BeamFrame* beams = beam_pool_.acquire();
+        CpiFrame* cpi = cpi_pool_.acquire();
+        const std::size_t samples = config_.samples, pulses = config_.pulses, plane = pulses * samples;
+        for (std::size_t n = 0;; n++) {
+            std::int64_t first = PulseScheduler::now_ns();
+            for (std::size_t pulse = 0; pulse < pulses; pulse++) {
+                std::int64_t t0 = PulseScheduler::now_ns();
+                if (!source(n, pulse, frame->samples)) {
+                    pulse_pool_.put_back(frame);
+                    beam_pool_.put_back(beams);
+                    cpi_pool_.put_back(cpi);
+                    return;
+                }
+                std::int64_t t1 = PulseScheduler::now_ns();
+                beamformer_.form_beams(frame->samples, beams->re.data(), beams->im.data());
+                std::int64_t t2 = PulseScheduler::now_ns();
+                for (std::size_t b = 0; b < config_.beams; b++) {
+                    std::size_t offset = (b * pulses + pulse) * samples;
+                    compressor_.compress(beams->re.data() + b * samples, beams->im.data() + b * samples, samples,
+                                         cpi->re.data() + offset, cpi->im.data() + offset);
+                }
+                std::int64_t t3 = PulseScheduler::now_ns();
+                record(0, t0, t0, t1);
+                record(1, t1, t1, t2);
+                record(2, t2, t2, t3);
+            }
+            std::int64_t start = PulseScheduler::now_ns();
+            for (std::size_t b = 0; b < config_.beams; b++) {
+                detections_.clear();
+                processor_.process(cpi->re.data() + b * plane, cpi->im.data() + b * plane, detections_);
+                sink(n, b, detections_);
+            }
+            std::int64_t end = PulseScheduler::now_ns();
+            record(3, start, start, end);
+            end_to_end_.record(end - first);
+            cpis_++;
+        }
+    }
+};
+
+// Source reading recorded pulses from a file of interleaved I/Q float32
+// pairs: per pulse, each element's samples in turn. Ends at the end of
+// the file, or starts over with loop. Not copyable; pass std::ref(source)
+// as the pipeline's Source.
+class IqFileSource {
+private:
+    std::FILE* file_;
+    AlignedBuffer<float> scratch_;
+    bool loop_;
+
+    bool read_element(SampleBlock& block, std::size_t e) {
+        if (std::fread(scratch_.data(), 2 * sizeof(float), block.samples, file_) != block.samples) return false;
+        float* re = block.element_re(e);
+        float* im = block.element_im(e);
+        for (std::size_t s = 0; s < block.samples; s++) {
+            re[s] = scratch_[2 * s];
+            im[s] = scratch_[2 * s + 1];
+        }
+        return true;
+    }
+
+public:
+    IqFileSource(const char* path, std::size_t samples, bool loop = false)
+        : file_(std::fopen(path, "rb")), scratch_(2 * samples), loop_(loop) {}
+    ~IqFileSource() {
+        if (file_ != nullptr) std::fclose(file_);
+    }
+    IqFileSource(const IqFileSource&) = delete;
+    IqFileSource& operator=(const IqFileSource&) = delete;
+
+    bool is_open() const { return file_ != nullptr; }
+
+    bool operator()(std::size_t, std::size_t, SampleBlock& block) {
+        if (file_ == nullptr) return false;
+        if (!read_element(block, 0)) {
+            if (!loop_) return false;
+            std::rewind(file_);
+            if (!read_element(block, 0)) return false;
+        }
+        for (std::size_t e = 1; e < block.elements; e++) {
+            if (!read_element(block, e)) return false;
+        }
+        return true;
+    }
+};
+
+#endif // RECEIVE_PIPELINE_HPP
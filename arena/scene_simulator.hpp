@@ -0,0 +1,323 @@
+// scene_simulator.hpp
+#ifndef SCENE_SIMULATOR_HPP
+#define SCENE_SIMULATOR_HPP
+
+#include "aligned_buffer.hpp"
+#include "array_geometry.hpp"
+#include "beamformer.hpp"
+#include "steering.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr double kSpeedOfLight = 299792458.0;
+
+// splitmix64's finalizer: a bijection on 64 bits that mixes every input
+// bit into every output bit. Hashing a counter gives a random stream that
+// can be entered anywhere, so any slice of the noise can be generated by
+// any thread and still come out the same.
+inline std::uint64_t noise_hash(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Natural log of a positive normal float, branch-free so loops calling it
+// vectorize: x = 2^e * m with m in [sqrt(1/2), sqrt(2)), and log m =
+// 2 atanh((m - 1) / (m + 1)) by its series to s^7. Relative error below
+// 1e-7.
+inline float fast_log(float x) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    std::int32_t exponent = static_cast<std::int32_t>(bits >> 23) - 127;
+    bits = (bits & 0x7fffff) | 0x3f800000;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    bool high = m > 1.41421356f;
+    m = high ? m * 0.5f : m;
+    float e = static_cast<float>(exponent) + (high ? 1.0f : 0.0f);
+    float s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+    float series = s * (2.0f + s2 * (0.666666667f + s2 * (0.4f + s2 * 0.285714286f)));
+    return e * 0.693147181f + series;
+}
+
+// Square root of a positive normal float without std::sqrt, whose errno
+// path for negative input is a branch that stops GCC vectorizing: the
+// exponent-halving guess for 1 / sqrt(x), three Newton steps, times x.
+// Relative error below 2e-7.
+inline float fast_sqrt(float x) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f375a86 - (bits >> 1);
+    float y;
+    std::memcpy(&y, &bits, sizeof(y));
+    float half = 0.5f * x;
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+    return x * y;
+}
+
+// One complex Gaussian sample of standard deviation sigma per part from
+// the hash of counter, by Box-Muller: 31 bits for the radius and 24 for
+// the angle. The radius is cut off at 6.7 sigma, where the power of
+// complex noise passes its mean 2 sigma^2 with probability 2e-10.
+inline SinCos gaussian_pair(std::uint64_t counter, float sigma) {
+    std::uint64_t h = noise_hash(counter);
+    float u = (static_cast<float>(static_cast<std::int32_t>(h >> 33)) + 0.5f) * 4.656612873e-10f;
+    float angle = static_cast<float>(static_cast<std::int32_t>(h & 0xffffff)) * 3.745070718e-7f - kPi;
+    float radius = sigma * fast_sqrt(-2.0f * fast_log(u));
+    SinCos w = fast_sincos(angle);
+    return { radius * w.sin, radius * w.cos };
+}
+
+// count complex Gaussian samples of power 2 sigma^2 into re/im from
+// counters key, key + 1, ...
+inline void gaussian_noise(std::uint64_t key, float sigma, std::size_t count, float* __restrict re,
+                           float* __restrict im) {
+    for (std::size_t i = 0; i < count; i++) {
+        SinCos g = gaussian_pair(key + i, sigma);
+        re[i] = g.cos;
+        im[i] = g.sin;
+    }
+}
+
+// A point target: range and azimuth change linearly with time
+struct SceneTarget {
+    double range;                       // metres at time 0
+    double velocity;                    // radial, metres/second, positive receding
+    double azimuth;                     // radians at time 0
+    double elevation;
+    double azimuth_rate;                // radians/second
+    double amplitude;                   // per element, against noise_power
+};
+
+struct SceneConfig {
+    double carrier_freq = 10e9;
+    double sample_rate = 100e6;
+    double pulse_repetition_interval = 200e-6;
+    double window_start = 0;            // seconds from transmit to sample 0
+    double noise_power = 1;             // complex, per element and sample
+    std::size_t clutter_patches = 0;
+    double clutter_power = 0;           // mean power of each patch, per element
+    double clutter_spread = 0.05;       // pulse-to-pulse fluctuation of a patch, relative
+    std::size_t clutter_extent = 4096;  // samples of the window the patches are spread over
+    std::size_t pulses_per_cpi = 64;
+    std::size_t cpis = 0;               // 0: no end
+    std::uint64_t seed = 1;
+    std::size_t threads = 1;
+};
+
+// Received baseband samples of every element of an array, pulse by pulse,
+// for moving point targets, ground clutter and receiver noise. Pulse n
+// (cpi * pulses_per_cpi + pulse) is sent at n * PRI; a scatterer at range
+// R and direction d returns the transmitted pulse delayed by 2R / c
+// (rounded to a sample), rotated by -4 pi R / lambda, which over the
+// pulses is its Doppler, and by -2 pi d . p on the element at p. Clutter
+// is clutter_patches stationary scatterers at elevation 0, spread at
+// random over the first clutter_extent samples of the receive window and
+// +/-60 degrees of azimuth, each with a Rayleigh amplitude and a small
+// Gaussian fluctuation from pulse to pulse that widens its zero-Doppler
+// line.
+//
+// Noise is Box-Muller on a counter-based hash: the stream of element e on
+// pulse n is fixed by (seed, n, e), so a pulse comes out the same however
+// the elements are split between threads and in whatever order pulses
+// are asked for. Each thread takes a contiguous run of elements: noise,
+// then every echo as a complex multiply-add of the pulse into the row,
+// both vectorized over samples. The threads - 1 workers are started in
+// the constructor and wait between pulses, so fill() allocates nothing.
+// fill() works as a ReceivePipeline source via std::ref.
+class SceneSimulator {
+private:
+    struct Echo {
+        std::ptrdiff_t delay;           // samples
+        float re;                       // amplitude and carrier phase
+        float im;
+        float kx;                       // -2 pi d
+        float ky;
+        float kz;
+    };
+
+    const ArrayGeometry& geometry_;
+    SceneConfig config_;
+    std::size_t length_;
+    AlignedBuffer<float> pulse_re_;
+    AlignedBuffer<float> pulse_im_;
+    std::vector<SceneTarget> targets_;
+    std::vector<SceneTarget> clutter_;
+    std::vector<Echo> echoes_;
+    std::uint64_t pulse_index_ = 0;
+    SampleBlock* block_ = nullptr;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    std::size_t generation_ = 0;
+    std::size_t pending_ = 0;
+    bool stop_ = false;
+
+    void add_echo(const SceneTarget& scatterer, double t, double amplitude_re, double amplitude_im,
+                  std::size_t samples) {
+        double range = scatterer.range + scatterer.velocity * t;
+        std::ptrdiff_t delay = static_cast<std::ptrdiff_t>(
+            std::llround((2 * range / kSpeedOfLight - config_.window_start) * config_.sample_rate));
+        if (delay >= static_cast<std::ptrdiff_t>(samples) || delay + static_cast<std::ptrdiff_t>(length_) <= 0) {
+            return;
+        }
+        double cycles = 2 * range * config_.carrier_freq / kSpeedOfLight;
+        double phase = -2 * M_PI * (cycles - std::floor(cycles));
+        Direction d = direction(scatterer.azimuth + scatterer.azimuth_rate * t, scatterer.elevation);
+        echoes_.push_back({ delay,
+                            static_cast<float>(amplitude_re * std::cos(phase) - amplitude_im * std::sin(phase)),
+                            static_cast<float>(amplitude_re * std::sin(phase) + amplitude_im * std::cos(phase)),
+                            static_cast<float>(-2 * M_PI * d.u), static_cast<float>(-2 * M_PI * d.v),
+                            static_cast<float>(-2 * M_PI * d.w) });
+    }
+
+    // Elements [part * E / threads, (part + 1) * E / threads) of the pulse
+    void synthesize(std::size_t part) {
+        SampleBlock& block = *block_;
+        const std::size_t threads = workers_.size() + 1;
+        const std::size_t first = part * block.elements / threads, last = (part + 1) * block.elements / threads;
+        const float sigma = static_cast<float>(std::sqrt(config_.noise_power / 2));
+        const float* x = geometry_.x();
+        const float* y = geometry_.y();
+        const float* z = geometry_.z();
+        for (std::size_t e = first; e < last; e++) {
+            float* __restrict re = block.element_re(e);
+            float* __restrict im = block.element_im(e);
+            std::uint64_t key = noise_hash(config_.seed ^ noise_hash((pulse_index_ << 24) + e));
+            gaussian_noise(key, sigma, block.samples, re, im);
+            for (const Echo& echo : echoes_) {
+                // Echo amplitude times this element's phase, then the pulse
+                // from max(delay, 0) to the end of the window
+                SinCos w = fast_sincos(echo.kx * x[e] + echo.ky * y[e] + echo.kz * z[e]);
+                float ar = echo.re * w.cos - echo.im * w.sin, ai = echo.re * w.sin + echo.im * w.cos;
+                std::ptrdiff_t from = echo.delay < 0 ? -echo.delay : 0;
+                std::ptrdiff_t to = std::min(static_cast<std::ptrdiff_t>(length_),
+                                             static_cast<std::ptrdiff_t>(block.samples) - echo.delay);
+                float* __restrict yr = re + (echo.delay + from);
+                float* __restrict yi = im + (echo.delay + from);
+                const float* __restrict pr = pulse_re_.data() + from;
+                const float* __restrict pi = pulse_im_.data() + from;
+                for (std::ptrdiff_t k = 0; k < to - from; k++) {
+                    yr[k] += ar * pr[k] - ai * pi[k];
+                    yi[k] += ar * pi[k] + ai * pr[k];
+                }
+            }
+        }
+    }
+
+    void work(std::size_t part) {
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+            lock.unlock();
+            synthesize(part);
+            lock.lock();
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+public:
+    // The geometry must outlive the simulator; pulse_re/pulse_im is the
+    // transmitted pulse of length samples
+    SceneSimulator(const ArrayGeometry& geometry, const float* pulse_re, const float* pulse_im, std::size_t length,
+                   const SceneConfig& config, std::vector<SceneTarget> targets = {})
+        : geometry_(geometry), config_(config), length_(length), pulse_re_(length), pulse_im_(length),
+          targets_(std::move(targets)) {
+        std::memcpy(pulse_re_.data(), pulse_re, length * sizeof(float));
+        std::memcpy(pulse_im_.data(), pulse_im, length * sizeof(float));
+        double near = config.window_start * kSpeedOfLight / 2;
+        double far = near + kSpeedOfLight / (2 * config.sample_rate) * static_cast<double>(config.clutter_extent);
+        for (std::size_t c = 0; c < config.clutter_patches; c++) {
+            // Uniform range and azimuth, Rayleigh amplitude, all from the seed
+            std::uint64_t key = noise_hash(config.seed ^ noise_hash(~static_cast<std::uint64_t>(c)));
+            double u1 = (noise_hash(key) >> 11) * 0x1.0p-53, u2 = (noise_hash(key + 1) >> 11) * 0x1.0p-53;
+            double u3 = ((noise_hash(key + 2) >> 11) + 0.5) * 0x1.0p-53;
+            double range = near + u1 * (far - near);
+            clutter_.push_back({ range, 0, (u2 - 0.5) * 2 * M_PI / 3, 0, 0,
+                                 std::sqrt(-config.clutter_power * std::log(u3)) });
+        }
+        echoes_.reserve(targets_.size() + clutter_.size());
+        std::size_t threads = std::max<std::size_t>(config.threads, 1);
+        for (std::size_t part = 1; part < threads; part++) workers_.emplace_back([this, part] { work(part); });
+    }
+
+    ~SceneSimulator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread& worker : workers_) worker.join();
+    }
+
+    SceneSimulator(const SceneSimulator&) = delete;
+    SceneSimulator& operator=(const SceneSimulator&) = delete;
+
+    const SceneConfig& config() const { return config_; }
+    std::size_t threads() const { return workers_.size() + 1; }
+    const std::vector<SceneTarget>& clutter() const { return clutter_; }
+
+    // Range bin (sample) and Doppler bin (of pulses_per_cpi, zero at
+    // pulses_per_cpi / 2, folded) where a target shows at time 0
+    double range_bin(const SceneTarget& target) const {
+        return (2 * target.range / kSpeedOfLight - config_.window_start) * config_.sample_rate;
+    }
+    double doppler_bin(const SceneTarget& target) const {
+        double cycles_per_pulse = -2 * target.velocity * config_.carrier_freq / kSpeedOfLight *
+                                  config_.pulse_repetition_interval;
+        double bins = cycles_per_pulse * config_.pulses_per_cpi;
+        double n = static_cast<double>(config_.pulses_per_cpi);
+        return std::fmod(std::fmod(bins + n / 2, n) + n, n);
+    }
+
+    // Pulse `pulse` of CPI `cpi` for every element of the geometry into
+    // block (block.elements == geometry size); false past config.cpis
+    bool fill(std::size_t cpi, std::size_t pulse, SampleBlock& block) {
+        if (config_.cpis != 0 && cpi >= config_.cpis) return false;
+        pulse_index_ = cpi * config_.pulses_per_cpi + pulse;
+        double t = static_cast<double>(pulse_index_) * config_.pulse_repetition_interval;
+        echoes_.clear();
+        for (const SceneTarget& target : targets_) add_echo(target, t, target.amplitude, 0, block.samples);
+        for (std::size_t c = 0; c < clutter_.size(); c++) {
+            std::uint64_t key = noise_hash(config_.seed ^ noise_hash(~static_cast<std::uint64_t>(c)));
+            SinCos g = gaussian_pair(key + 3 + pulse_index_, static_cast<float>(config_.clutter_spread));
+            double amplitude = clutter_[c].amplitude;
+            add_echo(clutter_[c], t, amplitude * (1 + g.cos), amplitude * g.sin, block.samples);
+        }
+        block_ = &block;
+        if (!workers_.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = workers_.size();
+            generation_++;
+        }
+        start_.notify_all();
+        synthesize(0);
+        if (!workers_.empty()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&] { return pending_ == 0; });
+        }
+        return true;
+    }
+
+    bool operator()(std::size_t cpi, std::size_t pulse, SampleBlock& block) { return fill(cpi, pulse, block); }
+};
+
+#endif // SCENE_SIMULATOR_HPP
@@ -0,0 +1,76 @@
+// steering.hpp
+#ifndef STEERING_HPP
+#define STEERING_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kTwoPi = 6.28318530717959f;
+
+// Single-precision sine and cosine of x together. Branch-free, so loops
+// calling it vectorize: x = r + q * pi/2 with r in [-pi/4, pi/4] (pi/2 is
+// split in three parts to keep r exact), both minimax polynomials are
+// evaluated on r and the quadrant q selects and signs them. q is rounded
+// by adding 1.5 * 2^23, which leaves it in the low mantissa bits, rather
+// than with floor, which keeps GCC from vectorizing. Valid for |x| < 6e6;
+// absolute error stays below 1e-6 for |x| < 1e4.
+struct SinCos {
+    float sin;
+    float cos;
+};
+
+inline SinCos fast_sincos(float x) {
+    const float round_shift = 12582912.0f;
+    float shifted = x * 0.636619772f + round_shift;
+    uint32_t quadrant;
+    std::memcpy(&quadrant, &shifted, sizeof(quadrant));
+    float q = shifted - round_shift;
+    float r = x - q * 1.5703125f;
+    r -= q * 4.837512969970703125e-4f;
+    r -= q * 7.54978995489188216e-8f;
+    float r2 = r * r;
+    float sp = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float cp = 1.0f - 0.5f * r2 +
+               r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+    float ss = (quadrant & 1) ? cp : sp;
+    float cc = (quadrant & 1) ? sp : cp;
+    return { (quadrant & 2) ? -ss : ss, ((quadrant + 1) & 2) ? -cc : cc };
+}
+
+// Complex weights of one beam, split into real and imaginary planes:
+// w[i] = taper[i] * exp(j * k * position[i]). For a linear array with
+// positions in wavelengths, k = -2 pi sin(theta) steers to theta.
+inline void steering_kernel(const float* __restrict position, const float* __restrict taper, std::size_t count,
+                            float k, float* __restrict re, float* __restrict im) {
+    for (std::size_t i = 0; i < count; i++) {
+        SinCos w = fast_sincos(k * position[i]);
+        re[i] = taper[i] * w.cos;
+        im[i] = taper[i] * w.sin;
+    }
+}
+
+// The same for elements anywhere in space, positions as separate x, y, z
+// planes: w[i] = taper[i] * exp(j * (k . p[i])), three multiply-adds per
+// element for the phase. k = -2 pi * (unit vector towards the target)
+// steers there, positions in wavelengths.
+inline void steering_kernel_3d(const float* __restrict x, const float* __restrict y, const float* __restrict z,
+                               const float* __restrict taper, std::size_t count, float kx, float ky, float kz,
+                               float* __restrict re, float* __restrict im) {
+    for (std::size_t i = 0; i < count; i++) {
+        SinCos w = fast_sincos(kx * x[i] + ky * y[i] + kz * z[i]);
+        re[i] = taper[i] * w.cos;
+        im[i] = taper[i] * w.sin;
+    }
+}
+
+// y[i] = sin(x[i]) / 2 + 1 over a whole plane
+inline void half_sine_plus_one(const float* __restrict x, std::size_t count, float* __restrict y) {
+    for (std::size_t i = 0; i < count; i++) {
+        y[i] = fast_sincos(x[i]).sin * 0.5f + 1.0f;
+    }
+}
+
+#endif // STEERING_HPP
@@ -0,0 +1,169 @@
+// steering_table.hpp
+#ifndef STEERING_TABLE_HPP
+#define STEERING_TABLE_HPP
+
+#include "aligned_buffer.hpp"
+#include "steering.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// count angles start, start + step, ... in radians
+struct AngleGrid {
+    double start;
+    double step;
+    std::size_t count;
+
+    double angle(std::size_t i) const { return start + step * i; }
+
+    // Nearest grid index, clamped to the grid
+    std::size_t nearest(double angle) const {
+        double i = std::round((angle - start) / step);
+        return static_cast<std::size_t>(std::min(std::max(i, 0.0), static_cast<double>(count - 1)));
+    }
+};
+
+// Precomputed complex weights for every node of an azimuth x elevation
+// grid, in one aligned buffer: node (a, e) holds N real parts then N
+// imaginary parts, so steering to a node is a pointer and the planes are
+// in the layout steering_weights writes. Elements lie along the array
+// axis (positions in wavelengths); azimuth is measured from broadside in
+// the plane through that axis, so a node steers to direction cosine
+// u = cos(el) sin(az) and its weights are taper * exp(-2 pi i u x).
+// Nodes are computed on first use and marked in a fill map; fill_all()
+// builds the whole table up front. Not thread-safe while filling.
+//
+// Between nodes, steer() starts from the nearest node and corrects the
+// remaining du with unit phase ramps exp(-2 pi i du x), which multiply:
+// a coarse ramp from fine_steps steps across the widest cell, then a fine
+// ramp from fine_steps steps across one coarse step. That is two complex
+// multiplies per element and no sin/cos. The ramps take about
+// 3 * fine_steps rows, and the phase error is at most
+// pi * x_max * (widest cell in u) / fine_steps^2.
+class SteeringTable {
+private:
+    std::size_t elements_;
+    AngleGrid azimuth_;
+    AngleGrid elevation_;
+    AlignedBuffer<float> position_;
+    AlignedBuffer<float> taper_;
+    AlignedBuffer<float> table_;        // [az][el][re N, im N]
+    std::vector<std::uint8_t> filled_;
+    std::size_t filled_count_ = 0;
+    // Coarse ramps for du = j * coarse_step_, j in [-fine_steps, fine_steps],
+    // then fine ramps for du = m * coarse_step_ / fine_steps, m in
+    // [-half_steps_, half_steps_]
+    std::size_t fine_steps_;
+    std::size_t half_steps_;
+    double coarse_step_;
+    AlignedBuffer<float> ramps_;        // [ramp][re N, im N]
+
+    static double direction_cosine(double azimuth, double elevation) {
+        return std::cos(elevation) * std::sin(azimuth);
+    }
+
+    void fill(std::size_t node) {
+        std::size_t az = node / elevation_.count, el = node % elevation_.count;
+        float k = static_cast<float>(-2 * M_PI * direction_cosine(azimuth_.angle(az), elevation_.angle(el)));
+        float* re = table_.data() + node * 2 * elements_;
+        steering_kernel(position_.data(), taper_.data(), elements_, k, re, re + elements_);
+        filled_[node] = 1;
+        filled_count_++;
+    }
+
+public:
+    SteeringTable(const float* position, const float* taper, std::size_t elements, AngleGrid azimuth,
+                  AngleGrid elevation, std::size_t fine_steps = 64)
+        : elements_(elements), azimuth_(azimuth), elevation_(elevation), position_(elements), taper_(elements),
+          table_(azimuth.count * elevation.count * 2 * elements), filled_(azimuth.count * elevation.count),
+          fine_steps_(fine_steps), half_steps_((fine_steps + 1) / 2),
+          ramps_(2 * (2 * fine_steps + 2 * half_steps_ + 2) * elements) {
+        std::memcpy(position_.data(), position, elements * sizeof(float));
+        std::memcpy(taper_.data(), taper, elements * sizeof(float));
+
+        // Widest u gap between neighbouring nodes; a point in a cell is
+        // within half of it along each axis of its nearest node
+        double gap = 0;
+        for (std::size_t a = 0; a < azimuth.count; a++) {
+            for (std::size_t e = 0; e < elevation.count; e++) {
+                double u = direction_cosine(azimuth.angle(a), elevation.angle(e));
+                if (a + 1 < azimuth.count) {
+                    gap = std::max(gap, std::fabs(direction_cosine(azimuth.angle(a + 1), elevation.angle(e)) - u));
+                }
+                if (e + 1 < elevation.count) {
+                    gap = std::max(gap, std::fabs(direction_cosine(azimuth.angle(a), elevation.angle(e + 1)) - u));
+                }
+            }
+        }
+        coarse_step_ = gap > 0 ? gap / fine_steps : 1.0;
+        AlignedBuffer<float> ones(elements);
+        std::fill(ones.data(), ones.data() + elements, 1.0f);
+        double steps = static_cast<double>(fine_steps), half = static_cast<double>(half_steps_);
+        for (std::size_t ramp = 0; ramp < 2 * fine_steps + 2 * half_steps_ + 2; ramp++) {
+            double du = ramp <= 2 * fine_steps
+                            ? (static_cast<double>(ramp) - steps) * coarse_step_
+                            : (static_cast<double>(ramp - 2 * fine_steps - 1) - half) * coarse_step_ / steps;
+            float* re = ramps_.data() + ramp * 2 * elements;
+            steering_kernel(position_.data(), ones.data(), elements, static_cast<float>(-2 * M_PI * du), re,
+                            re + elements);
+        }
+    }
+
+    std::size_t elements() const { return elements_; }
+    const AngleGrid& azimuth() const { return azimuth_; }
+    const AngleGrid& elevation() const { return elevation_; }
+    std::size_t nodes() const { return filled_.size(); }
+    std::size_t filled() const { return filled_count_; }
+    std::size_t table_bytes() const { return (table_.size() + ramps_.size()) * sizeof(float); }
+
+    void fill_all() {
+        for (std::size_t node = 0; node < filled_.size(); node++) {
+            if (!filled_[node]) fill(node);
+        }
+    }
+
+    // Weights of grid node (az, el): real parts, imaginary parts at + elements()
+    const float* weights(std::size_t az, std::size_t el) {
+        std::size_t node = az * elevation_.count + el;
+        if (!filled_[node]) fill(node);
+        return table_.data() + node * 2 * elements_;
+    }
+
+    // Weights of the node nearest (azimuth, elevation)
+    const float* nearest(double azimuth, double elevation) {
+        return weights(azimuth_.nearest(azimuth), elevation_.nearest(elevation));
+    }
+
+    // Weights for any direction inside the grid into re/im: the nearest
+    // node times the coarse and fine ramps for the rest of the way
+    void steer(double azimuth, double elevation, float* __restrict re, float* __restrict im) {
+        std::size_t az = azimuth_.nearest(azimuth), el = elevation_.nearest(elevation);
+        const float* node = weights(az, el);
+        double du = direction_cosine(azimuth, elevation) - direction_cosine(azimuth_.angle(az), elevation_.angle(el));
+        double steps = static_cast<double>(fine_steps_), half = static_cast<double>(half_steps_);
+        double j = std::min(std::max(std::round(du / coarse_step_), -steps), steps);
+        double m = std::min(std::max(std::round((du / coarse_step_ - j) * steps), -half), half);
+        std::size_t coarse_row = static_cast<std::size_t>(j + steps);
+        std::size_t fine_row = 2 * fine_steps_ + 1 + static_cast<std::size_t>(m + half);
+        const float* coarse = ramps_.data() + coarse_row * 2 * elements_;
+        const float* fine = ramps_.data() + fine_row * 2 * elements_;
+        const float* __restrict nr = node;
+        const float* __restrict ni = node + elements_;
+        const float* __restrict cr = coarse;
+        const float* __restrict ci = coarse + elements_;
+        const float* __restrict fr = fine;
+        const float* __restrict fi = fine + elements_;
+        for (std::size_t i = 0; i < elements_; i++) {
+            float rr = cr[i] * fr[i] - ci[i] * fi[i];
+            float ri = cr[i] * fi[i] + ci[i] * fr[i];
+            re[i] = nr[i] * rr - ni[i] * ri;
+            im[i] = nr[i] * ri + ni[i] * rr;
+        }
+    }
+};
+
+#endif // STEERING_TABLE_HPP
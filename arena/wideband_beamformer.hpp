@@ -0,0 +1,181 @@
+// wideband_beamformer.hpp
+#ifndef WIDEBAND_BEAMFORMER_HPP
+#define WIDEBAND_BEAMFORMER_HPP
+
+#include "aligned_buffer.hpp"
+#include "beamformer.hpp"
+#include "fft.hpp"
+#include "steering.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// True-time-delay receive beamformer in the frequency domain. A phase
+// shift steers correctly only at the frequency it was computed for: across
+// a band of B Hz around the carrier fc, the element at x wavelengths is
+// off by 2 pi x sin(theta) B / (2 fc) at the band edges, which for a large
+// array smears the beam. Delaying each element by x sin(theta) / fc is
+// exact at every frequency, and in the frequency domain a delay is one
+// complex weight per bin:
+//
+//   beam b, bin f = sum over e of conj(w_e(f)) * X_e(f),
+//   w_e(f) = taper_e * exp(-2 pi i sin(theta_b) x_e (1 + f / fc))
+//
+// which at f = 0 is the narrowband weight. The stream is cut overlap-save:
+// each block of fft_size samples per element overlaps the last by
+// 2 * guard() samples, where guard() covers the largest delay plus the tail
+// of the delay response, and each block contributes hop() = fft_size -
+// 2 * guard() beam samples. Bins outside the signal bandwidth roll off
+// with a raised cosine, which keeps that tail short.
+//
+// The per-element spectra are shared by all beams, so the cost per beam
+// is one complex multiply-add per element and bin plus one inverse FFT,
+// where a time-domain fractional-delay filter costs a complex multiply-add
+// per element and tap. The weight table holds beams * elements * fft_size
+// complex values, stored conjugated, element-major, in the FFT's
+// bit-reversed bin order with 1/fft_size folded in; kBlocksPerPass blocks
+// go through together so each element's weights are read once per pass.
+// Keeps per-element history between calls: one instance per stream.
+class WidebandBeamformer {
+public:
+    static constexpr std::size_t kBlocksPerPass = 4;
+    // Samples of delay response kept past the largest element delay
+    static constexpr std::size_t kDelayTail = 16;
+
+private:
+    std::size_t elements_;
+    std::size_t beams_;
+    std::size_t guard_;
+    std::size_t hop_;
+    FftPlan plan_;
+    AlignedBuffer<float> weights_re_;   // [element][beam][position]
+    AlignedBuffer<float> weights_im_;
+    AlignedBuffer<float> history_re_;   // [element][2 * guard]
+    AlignedBuffer<float> history_im_;
+    AlignedBuffer<float> spectra_re_;   // [block][position], one element
+    AlignedBuffer<float> spectra_im_;
+    AlignedBuffer<float> beams_re_;     // [beam][block][position]
+    AlignedBuffer<float> beams_im_;
+
+    static void multiply_accumulate(const float* __restrict wr, const float* __restrict wi, const float* __restrict xr,
+                                    const float* __restrict xi, float* __restrict yr, float* __restrict yi,
+                                    std::size_t count) {
+        for (std::size_t k = 0; k < count; k++) {
+            yr[k] += wr[k] * xr[k] - wi[k] * xi[k];
+            yi[k] += wr[k] * xi[k] + wi[k] * xr[k];
+        }
+    }
+
+    static std::size_t guard_for(const float* position, std::size_t elements, const float* angles,
+                                 std::size_t beams, double center_freq, double sample_rate) {
+        double max_position = 0, max_sine = 0;
+        for (std::size_t e = 0; e < elements; e++) max_position = std::max(max_position, std::fabs(double(position[e])));
+        for (std::size_t b = 0; b < beams; b++) max_sine = std::max(max_sine, std::fabs(std::sin(double(angles[b]))));
+        return static_cast<std::size_t>(std::ceil(max_position * max_sine * sample_rate / center_freq)) + kDelayTail;
+    }
+
+public:
+    // position in wavelengths at center_freq; angles in radians off
+    // broadside; bandwidth < sample_rate; fft_size a power of two larger
+    // than 2 * guard() (check hop() > 0)
+    WidebandBeamformer(const float* position, const float* taper, std::size_t elements, const float* angles,
+                       std::size_t beams, double center_freq, double sample_rate, double bandwidth,
+                       std::size_t fft_size)
+        : elements_(elements), beams_(beams),
+          guard_(guard_for(position, elements, angles, beams, center_freq, sample_rate)),
+          hop_(fft_size > 2 * guard_ ? fft_size - 2 * guard_ : 0), plan_(fft_size),
+          weights_re_(elements * beams * fft_size), weights_im_(elements * beams * fft_size),
+          history_re_(elements * 2 * guard_), history_im_(elements * 2 * guard_),
+          spectra_re_(kBlocksPerPass * fft_size), spectra_im_(kBlocksPerPass * fft_size),
+          beams_re_(beams * kBlocksPerPass * fft_size), beams_im_(beams * kBlocksPerPass * fft_size) {
+        AlignedBuffer<float> re(elements), im(elements);
+        double band_edge = bandwidth / 2, nyquist = sample_rate / 2;
+        for (std::size_t p = 0; p < fft_size; p++) {
+            std::size_t bin = plan_.scrambled_bin(p);
+            double f = (bin < fft_size / 2 ? double(bin) : double(bin) - double(fft_size)) * sample_rate / fft_size;
+            double gain = 1;
+            if (std::fabs(f) > band_edge) {
+                gain = 0.5 + 0.5 * std::cos(M_PI * (std::fabs(f) - band_edge) / (nyquist - band_edge));
+            }
+            float scale = static_cast<float>(gain / fft_size);
+            for (std::size_t b = 0; b < beams; b++) {
+                float k = static_cast<float>(-2 * M_PI * std::sin(double(angles[b])) * (1 + f / center_freq));
+                steering_kernel(position, taper, elements, k, re.data(), im.data());
+                for (std::size_t e = 0; e < elements; e++) {
+                    weights_re_[(e * beams + b) * fft_size + p] = scale * re[e];
+                    weights_im_[(e * beams + b) * fft_size + p] = -scale * im[e];
+                }
+            }
+        }
+    }
+
+    std::size_t elements() const { return elements_; }
+    std::size_t beams() const { return beams_; }
+    std::size_t fft_size() const { return plan_.size(); }
+    std::size_t guard() const { return guard_; }
+    std::size_t hop() const { return hop_; }
+    std::size_t table_bytes() const { return 2 * weights_re_.size() * sizeof(float); }
+
+    // Consumes in.samples (a multiple of hop()) new samples per element and
+    // writes as many beam samples, beam-major [beams x in.samples], delayed
+    // by guard(): the samples that started guard() before this block
+    void form_beams(const SampleBlock& in, float* out_re, float* out_im) {
+        const std::size_t size = plan_.size(), overlap = 2 * guard_, samples = in.samples;
+        for (std::size_t s0 = 0; s0 < samples; s0 += kBlocksPerPass * hop_) {
+            std::size_t blocks = std::min(kBlocksPerPass, (samples - s0) / hop_);
+            std::fill(beams_re_.data(), beams_re_.data() + beams_re_.size(), 0.0f);
+            std::fill(beams_im_.data(), beams_im_.data() + beams_im_.size(), 0.0f);
+            for (std::size_t e = 0; e < elements_; e++) {
+                for (std::size_t t = 0; t < blocks; t++) {
+                    // Block t covers stream samples [start - overlap, start + hop)
+                    std::size_t start = s0 + t * hop_;
+                    float* xr = spectra_re_.data() + t * size;
+                    float* xi = spectra_im_.data() + t * size;
+                    std::size_t from_history = start < overlap ? overlap - start : 0;
+                    std::memcpy(xr, history_re_.data() + e * overlap + (overlap - from_history),
+                                from_history * sizeof(float));
+                    std::memcpy(xi, history_im_.data() + e * overlap + (overlap - from_history),
+                                from_history * sizeof(float));
+                    std::memcpy(xr + from_history, in.element_re(e) + start + from_history - overlap,
+                                (size - from_history) * sizeof(float));
+                    std::memcpy(xi + from_history, in.element_im(e) + start + from_history - overlap,
+                                (size - from_history) * sizeof(float));
+                    plan_.forward_scrambled(xr, xi);
+                }
+                for (std::size_t b = 0; b < beams_; b++) {
+                    const float* wr = weights_re_.data() + (e * beams_ + b) * size;
+                    const float* wi = weights_im_.data() + (e * beams_ + b) * size;
+                    for (std::size_t t = 0; t < blocks; t++) {
+                        multiply_accumulate(wr, wi, spectra_re_.data() + t * size, spectra_im_.data() + t * size,
+                                            beams_re_.data() + (b * kBlocksPerPass + t) * size,
+                                            beams_im_.data() + (b * kBlocksPerPass + t) * size, size);
+                    }
+                }
+            }
+            for (std::size_t b = 0; b < beams_; b++) {
+                for (std::size_t t = 0; t < blocks; t++) {
+                    float* yr = beams_re_.data() + (b * kBlocksPerPass + t) * size;
+                    float* yi = beams_im_.data() + (b * kBlocksPerPass + t) * size;
+                    plan_.inverse_scrambled(yr, yi);
+                    std::memcpy(out_re + b * samples + s0 + t * hop_, yr + guard_, hop_ * sizeof(float));
+                    std::memcpy(out_im + b * samples + s0 + t * hop_, yi + guard_, hop_ * sizeof(float));
+                }
+            }
+        }
+
+        // Keep the last 2 * guard() samples of the stream for the next call
+        for (std::size_t e = 0; e < elements_; e++) {
+            float* hr = history_re_.data() + e * overlap;
+            float* hi = history_im_.data() + e * overlap;
+            std::size_t kept = samples < overlap ? overlap - samples : 0;
+            std::memmove(hr, hr + overlap - kept, kept * sizeof(float));
+            std::memmove(hi, hi + overlap - kept, kept * sizeof(float));
+            std::memcpy(hr + kept, in.element_re(e) + samples - (overlap - kept), (overlap - kept) * sizeof(float));
+            std::memcpy(hi + kept, in.element_im(e) + samples - (overlap - kept), (overlap - kept) * sizeof(float));
+        }
+    }
+};
+
+#endif // WIDEBAND_BEAMFORMER_HPP
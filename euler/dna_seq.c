@@ -1,72 +1,2346 @@
+#include "dna_seq.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Allocation helpers that abort instead of returning NULL
+static void* xmalloc(size_t size) {
+    void* p = malloc(size);
+    if (p == NULL && size != 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void* xcalloc(size_t count, size_t size) {
+    void* p = calloc(count, size);
+    if (p == NULL && count != 0 && size != 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", count * size);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void* xrealloc(void* ptr, size_t size) {
+    void* p = realloc(ptr, size);
+    if (p == NULL && size != 0) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// Map a nucleotide to its 2-bit code, or -1 for anything that is not ACGT
+static inline int encodeBase(char c) {
+    switch (c) {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return -1;
+    }
+}
+
+static inline char decodeBase(int code) {
+    return "ACGT"[code & 3];
+}
+
+static inline kmer_t kmerMask(int k) {
+    return k == MAX_K ? ~(kmer_t)0 : (((kmer_t)1 << (2 * k)) - 1);
+}
+
+// Pack the first k bases of s; returns 0 if s contains a non-ACGT base
+static int encodeKmer(const char* s, int k, kmer_t* out) {
+    kmer_t kmer = 0;
+    for (int i = 0; i < k; i++) {
+        int code = encodeBase(s[i]);
+        if (code < 0) return 0;
+        kmer = (kmer << 2) | (kmer_t)code;
+    }
+    *out = kmer;
+    return 1;
+}
+
+// Reverse the order of the 32 2-bit bases in a word
+static inline uint64_t reverseBases64(uint64_t x) {
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+// Reverse complement of a packed k-mer. With A=0, C=1, G=2, T=3 the
+// complement of a base is its bitwise NOT, so this is a NOT, a base
+// reversal of the whole word and a shift to drop the unused high bases.
+static inline kmer_t reverseComplement(kmer_t kmer, int k) {
+    kmer = ~kmer;
+#ifdef KMER_WIDE
+    kmer_t reversed = ((kmer_t)reverseBases64((uint64_t)kmer) << 64) | reverseBases64((uint64_t)(kmer >> 64));
+#else
+    kmer_t reversed = reverseBases64(kmer);
+#endif
+    return reversed >> (2 * (MAX_K - k));
+}
 
-#define MAX_READ_LENGTH 100
-#define MAX_READS 1000
+// The smaller of a k-mer and its reverse complement
+static inline kmer_t canonicalKmer(kmer_t kmer, int k) {
+    kmer_t rc = reverseComplement(kmer, k);
+    return rc < kmer ? rc : kmer;
+}
 
-// Structure to represent a node in the de Bruijn graph
-typedef struct Node {
-    char kmer[MAX_READ_LENGTH];
-    struct Node* next;
-} Node;
+// Neighbour mask for a canonical node from one occurrence of a k-mer read
+// as `kmer`: bit b (b < 4) is successor b of the canonical k-mer and bit
+// 4 + b successor b of its reverse complement. A predecessor base a of the
+// occurrence is successor 3 - a of the reverse complement. pred and succ
+// are base codes, or -1 when the occurrence has no such neighbour.
+static inline uint8_t canonicalMask(kmer_t kmer, kmer_t canonical, int pred, int succ) {
+    unsigned mask = (succ >= 0 ? 1u << succ : 0u) | (pred >= 0 ? 16u << (3 - pred) : 0u);
+    if (kmer != canonical) mask = (mask >> 4) | (mask << 4);
+    return (uint8_t)mask;
+}
+
+// 64-bit finalizer from MurmurHash3; wide k-mers fold both halves first
+static inline uint64_t hashKmer(kmer_t kmer) {
+#ifdef KMER_WIDE
+    uint64_t h = (uint64_t)kmer ^ ((uint64_t)(kmer >> 64) * 0x9e3779b97f4a7c15ULL);
+#else
+    uint64_t h = kmer;
+#endif
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void kmerTableInit(KmerTable* table, size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) capacity <<= 1;
+    table->keys = (kmer_t*)xmalloc(capacity * sizeof(kmer_t));
+    table->ids = (uint32_t*)xcalloc(capacity, sizeof(uint32_t));
+    table->capacity = capacity;
+    table->size = 0;
+}
+
+static void kmerTableFree(KmerTable* table) {
+    free(table->keys);
+    free(table->ids);
+    table->keys = NULL;
+    table->ids = NULL;
+    table->capacity = table->size = 0;
+}
+
+// Look up a k-mer; returns its node ID or UINT32_MAX if absent
+static uint32_t kmerTableFind(const KmerTable* table, kmer_t kmer) {
+    size_t mask = table->capacity - 1;
+    size_t slot = hashKmer(kmer) & mask;
+    while (table->ids[slot] != 0) {
+        if (table->keys[slot] == kmer) return table->ids[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+    return UINT32_MAX;
+}
+
+// Double the table and reinsert every occupied slot
+static void kmerTableGrow(KmerTable* table) {
+    KmerTable bigger;
+    kmerTableInit(&bigger, table->capacity);
+    size_t mask = bigger.capacity - 1;
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->ids[i] == 0) continue;
+        size_t slot = hashKmer(table->keys[i]) & mask;
+        while (bigger.ids[slot] != 0) slot = (slot + 1) & mask;
+        bigger.keys[slot] = table->keys[i];
+        bigger.ids[slot] = table->ids[i];
+    }
+    bigger.size = table->size;
+    kmerTableFree(table);
+    *table = bigger;
+}
+
+// Find or insert a k-mer; a newly inserted k-mer gets ID `nextId`
+static uint32_t kmerTableInsert(KmerTable* table, kmer_t kmer, uint32_t nextId, int* inserted) {
+    if ((table->size + 1) * 10 > table->capacity * 7) kmerTableGrow(table);
+    size_t mask = table->capacity - 1;
+    size_t slot = hashKmer(kmer) & mask;
+    while (table->ids[slot] != 0) {
+        if (table->keys[slot] == kmer) {
+            *inserted = 0;
+            return table->ids[slot] - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    table->keys[slot] = kmer;
+    table->ids[slot] = nextId + 1;
+    table->size++;
+    *inserted = 1;
+    return nextId;
+}
+
+// Choose a partition from the high hash bits; slots use the low bits
+static inline int partitionOf(kmer_t kmer, int numParts) {
+    return (int)(((hashKmer(kmer) >> 32) * (uint64_t)numParts) >> 32);
+}
+
+void initGraph(DeBruijnGraph* graph, int k, int numParts, size_t expectedNodes) {
+    memset(graph, 0, sizeof(*graph));
+    graph->k = k;
+    graph->numParts = numParts;
+    graph->parts = (KmerPartition*)xcalloc((size_t)numParts, sizeof(KmerPartition));
+    graph->partBase = (uint32_t*)xcalloc((size_t)numParts + 1, sizeof(uint32_t));
+    size_t perPart = expectedNodes / (size_t)numParts;
+    if (perPart < 16) perPart = 16;
+    for (int p = 0; p < numParts; p++) {
+        KmerPartition* part = &graph->parts[p];
+        kmerTableInit(&part->table, perPart);
+        part->capacity = (uint32_t)perPart;
+        part->kmers = (kmer_t*)xmalloc(perPart * sizeof(kmer_t));
+        part->outMask = (uint8_t*)xcalloc(perPart, 1);
+    }
+}
+
+void freeGraph(DeBruijnGraph* graph) {
+    for (int p = 0; p < graph->numParts; p++) {
+        kmerTableFree(&graph->parts[p].table);
+        free(graph->parts[p].kmers);
+        free(graph->parts[p].outMask);
+        free(graph->parts[p].counts);
+    }
+    free(graph->parts);
+    free(graph->partBase);
+    free(graph->kmers);
+    free(graph->outMask);
+    free(graph->offsets);
+    free(graph->targets);
+    memset(graph, 0, sizeof(*graph));
+}
+
+// Map a minimizer hash to one of numBuckets buckets. The minimum of many
+// hashes is skewed towards zero, so it is mixed again before scaling.
+static inline int minimizerBucket(uint64_t minHash, int numBuckets) {
+    return (int)(((hashKmer((kmer_t)(minHash ^ 0x2545f4914f6cdd1dULL)) >> 32) * (uint64_t)numBuckets) >> 32);
+}
+
+// Minimizer of a packed k-mer: the smallest hash over its m-mers. Canonical
+// graphs hash canonical m-mers, so a k-mer and its reverse complement share
+// a minimizer.
+static uint64_t kmerMinimizer(kmer_t kmer, int k, int m, int canonical) {
+    kmer_t mmerMask = kmerMask(m);
+    uint64_t best = UINT64_MAX;
+    for (int shift = 0; shift <= 2 * (k - m); shift += 2) {
+        kmer_t mmer = (kmer >> shift) & mmerMask;
+        uint64_t h = hashKmer(canonical ? canonicalKmer(mmer, m) : mmer);
+        if (h < best) best = h;
+    }
+    return best;
+}
 
-// Function to create a new node
-Node* createNode(const char* kmer) {
-    Node* newNode = (Node*)malloc(sizeof(Node));
-    strcpy(newNode->kmer, kmer);
-    newNode->next = NULL;
-    return newNode;
+// Look up the global node ID of a k-mer, or UINT32_MAX if it is not a node
+static uint32_t findNode(const DeBruijnGraph* graph, kmer_t kmer) {
+    int p = graph->minimizerLen
+                ? minimizerBucket(kmerMinimizer(kmer, graph->k, graph->minimizerLen, graph->canonical),
+                                  graph->numParts)
+                : partitionOf(kmer, graph->numParts);
+    uint32_t id = kmerTableFind(&graph->parts[p].table, kmer);
+    return id == UINT32_MAX ? UINT32_MAX : graph->partBase[p] + id;
 }
 
-// Function to add an edge between two nodes in the de Bruijn graph
-void addEdge(Node* graph[], const char* fromKmer, const char* toKmer) {
-    Node* newNode = createNode(toKmer);
-    newNode->next = graph[fromKmer[0] - 'A']; // Simple hash function
-    graph[fromKmer[0] - 'A'] = newNode;
+// Canonical graphs are traversed as directed graphs over 2 * numNodes
+// vertices: vertex 2v reads node v's k-mer forward and vertex 2v + 1 reads
+// its reverse complement, so every bidirected edge appears once per strand.
+// Strand-specific graphs have one vertex per node.
+static inline uint32_t numVertices(const DeBruijnGraph* graph) {
+    return graph->canonical ? 2 * graph->numNodes : graph->numNodes;
+}
+
+static inline kmer_t vertexKmer(const DeBruijnGraph* graph, uint32_t v) {
+    if (!graph->canonical) return graph->kmers[v];
+    kmer_t kmer = graph->kmers[v >> 1];
+    return (v & 1) ? reverseComplement(kmer, graph->k) : kmer;
+}
+
+// Successor bases of a vertex as a 4-bit mask
+static inline unsigned vertexSuccessors(const DeBruijnGraph* graph, uint32_t v) {
+    if (!graph->canonical) return graph->outMask[v];
+    return (graph->outMask[v >> 1] >> (4 * (v & 1))) & 15u;
+}
+
+// Look up the vertex spelling a k-mer, or UINT32_MAX if it is not in the graph
+static uint32_t findVertex(const DeBruijnGraph* graph, kmer_t kmer) {
+    if (!graph->canonical) return findNode(graph, kmer);
+    kmer_t canonical = canonicalKmer(kmer, graph->k);
+    uint32_t id = findNode(graph, canonical);
+    return id == UINT32_MAX ? UINT32_MAX : 2 * id + (kmer != canonical);
+}
+
+// Function to create (or look up) the node for a packed k-mer and record
+// the successor bases seen after it
+static void addNode(KmerPartition* part, kmer_t kmer, uint8_t successors) {
+    int inserted;
+    uint32_t id = kmerTableInsert(&part->table, kmer, part->numNodes, &inserted);
+    if (inserted) {
+        if (part->numNodes == part->capacity) {
+            uint32_t capacity = part->capacity * 2;
+            part->kmers = (kmer_t*)xrealloc(part->kmers, capacity * sizeof(kmer_t));
+            part->outMask = (uint8_t*)xrealloc(part->outMask, capacity);
+            memset(part->outMask + part->capacity, 0, capacity - part->capacity);
+            if (part->counts) {
+                part->counts = (uint8_t*)xrealloc(part->counts, capacity);
+                memset(part->counts + part->capacity, 0, capacity - part->capacity);
+            }
+            part->capacity = capacity;
+        }
+        part->kmers[id] = kmer;
+        part->numNodes++;
+    }
+    part->outMask[id] |= successors;
+    if (part->counts && part->counts[id] < UINT8_MAX) part->counts[id]++;
+}
+
+// Cache-blocked Bloom filter: each k-mer maps to one 512-bit block (a
+// single cache line) and sets BLOOM_HASHES bits inside it, so a lookup
+// costs one cache miss regardless of the number of hash functions
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_HASHES 6
+
+struct BloomFilter {
+    uint64_t* blocks;
+    uint64_t numBlocks;
+};
+
+static void bloomInit(BloomFilter* filter, size_t bytes) {
+    filter->numBlocks = bytes / (BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    if (filter->numBlocks == 0) filter->numBlocks = 1;
+    if (filter->numBlocks > UINT32_MAX) filter->numBlocks = UINT32_MAX;
+    size_t size = (size_t)filter->numBlocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    filter->blocks = (uint64_t*)aligned_alloc(64, size);
+    if (filter->blocks == NULL) {
+        fprintf(stderr, "Out of memory allocating %zu bytes\n", size);
+        exit(EXIT_FAILURE);
+    }
+    memset(filter->blocks, 0, size);
+}
+
+#define BLOOM_EDGE_HASHES 2
+
+// A k-mer's block: the one cache line all its bits, edges included, go to
+static inline uint64_t* bloomBlock(const BloomFilter* filter, uint64_t h) {
+    return filter->blocks + (((h >> 32) * filter->numBlocks) >> 32) * BLOOM_BLOCK_WORDS;
+}
+
+static inline uint64_t bloomHash(kmer_t kmer) {
+    return hashKmer(kmer ^ (kmer_t)0x5851f42d4c957f2dULL);
+}
+
+// Add a k-mer; returns 1 if it was (probably) present already
+static int bloomTestAndSet(BloomFilter* filter, kmer_t kmer) {
+    uint64_t h = bloomHash(kmer);
+    uint64_t* block = bloomBlock(filter, h);
+    uint64_t bits = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+    int present = 1;
+    for (int i = 0; i < BLOOM_HASHES; i++, bits >>= 9) {
+        unsigned bit = (unsigned)bits & 511;
+        uint64_t mask = (uint64_t)1 << (bit & 63);
+        if (!(block[bit >> 6] & mask)) {
+            present = 0;
+            block[bit >> 6] |= mask;
+        }
+    }
+    return present;
+}
+
+// Bit positions in the k-mer's block for neighbour bit b of its mask
+static inline uint64_t bloomEdgeBits(uint64_t h, int b) {
+    uint64_t bits = (h ^ (h >> 29)) + (uint64_t)(b + 1) * 0x9e3779b97f4a7c15ULL;
+    bits ^= bits >> 31;
+    bits *= 0xbf58476d1ce4e5b9ULL;
+    return bits ^ (bits >> 27);
+}
+
+// Record the neighbour mask of an occurrence the filter absorbed, so the
+// edges of a k-mer's first occurrence are not lost when it later passes
+// the count threshold. Each mask bit is a key of its own in the k-mer's
+// block, which the test-and-set has just brought into cache.
+static void bloomSetEdges(BloomFilter* filter, kmer_t kmer, uint8_t mask) {
+    if (mask == 0) return;
+    uint64_t h = bloomHash(kmer);
+    uint64_t* block = bloomBlock(filter, h);
+    for (int b = 0; b < 8; b++) {
+        if (!(mask & (1u << b))) continue;
+        uint64_t bits = bloomEdgeBits(h, b);
+        for (int i = 0; i < BLOOM_EDGE_HASHES; i++, bits >>= 9) {
+            unsigned bit = (unsigned)bits & 511;
+            block[bit >> 6] |= (uint64_t)1 << (bit & 63);
+        }
+    }
+}
+
+// Which of the candidate neighbour bits were recorded by bloomSetEdges
+// (false positives possible)
+static uint8_t bloomEdges(const BloomFilter* filter, kmer_t kmer, uint8_t candidates) {
+    uint64_t h = bloomHash(kmer);
+    const uint64_t* block = bloomBlock(filter, h);
+    unsigned mask = 0;
+    for (int b = 0; b < 8; b++) {
+        if (!(candidates & (1u << b))) continue;
+        uint64_t bits = bloomEdgeBits(h, b);
+        int present = 1;
+        for (int i = 0; i < BLOOM_EDGE_HASHES && present; i++, bits >>= 9) {
+            unsigned bit = (unsigned)bits & 511;
+            present = (block[bit >> 6] >> (bit & 63)) & 1;
+        }
+        if (present) mask |= 1u << b;
+    }
+    return (uint8_t)mask;
+}
+
+// A k-mer occurrence together with the base that followed it (as a bit)
+typedef struct KmerRecord {
+    kmer_t kmer;
+    uint8_t successor;
+} KmerRecord;
+
+struct RecordBucket {
+    KmerRecord* records;
+    size_t size;
+    size_t capacity;
+};
+
+// Reads handed to each worker per batch; bounds the bucket memory
+#define READS_PER_WORKER_BATCH 4096
+
+typedef struct WorkerTask {
+    void* ctx;
+    int id;
+    int count;
+} WorkerTask;
+
+// Run fn on numTasks tasks, the first on the calling thread
+static void runTasks(void* (*fn)(void*), void* ctx, int numTasks) {
+    WorkerTask* tasks = (WorkerTask*)xmalloc((size_t)numTasks * sizeof(WorkerTask));
+    pthread_t* threads = (pthread_t*)xmalloc((size_t)numTasks * sizeof(pthread_t));
+    for (int t = 0; t < numTasks; t++) {
+        tasks[t].ctx = ctx;
+        tasks[t].id = t;
+        tasks[t].count = numTasks;
+    }
+    for (int t = 1; t < numTasks; t++) {
+        if (pthread_create(&threads[t], NULL, fn, &tasks[t]) != 0) {
+            fprintf(stderr, "Failed to start worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fn(&tasks[0]);
+    for (int t = 1; t < numTasks; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    free(tasks);
+}
+
+static inline void emitRecord(RecordBucket* row, int numParts, kmer_t kmer, uint8_t successor) {
+    RecordBucket* bucket = &row[partitionOf(kmer, numParts)];
+    if (bucket->size == bucket->capacity) {
+        bucket->capacity = bucket->capacity ? bucket->capacity * 2 : 4096;
+        bucket->records = (KmerRecord*)xrealloc(bucket->records, bucket->capacity * sizeof(KmerRecord));
+    }
+    bucket->records[bucket->size].kmer = kmer;
+    bucket->records[bucket->size].successor = successor;
+    bucket->size++;
+}
+
+// Record one occurrence of a k-mer with its neighbouring bases (-1: none).
+// Canonical graphs store it under its canonical k-mer, with the predecessor
+// as a successor of the reverse strand.
+static inline void emitKmer(RecordBucket* row, int numParts, int k, int canonical, kmer_t kmer, int pred, int succ) {
+    if (!canonical) {
+        emitRecord(row, numParts, kmer, succ >= 0 ? (uint8_t)(1u << succ) : 0);
+        return;
+    }
+    kmer_t key = canonicalKmer(kmer, k);
+    emitRecord(row, numParts, key, canonicalMask(kmer, key, pred, succ));
+}
+
+// Pass 1a: roll a k-mer window over this worker's share of the batch with
+// O(1) shift updates and route each k-mer to its partition's bucket.
+// Non-ACGT bases break the window so no k-mer spans them.
+static void* extractTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    GraphBuilder* builder = (GraphBuilder*)task->ctx;
+    int k = builder->graph->k;
+    int numParts = builder->graph->numParts;
+    int canonical = builder->graph->canonical;
+    kmer_t mask = kmerMask(k);
+    RecordBucket* row = &builder->buckets[(size_t)task->id * numParts];
+    for (int p = 0; p < numParts; p++) row[p].size = 0;
+
+    size_t count = builder->batchEnd - builder->batchBegin;
+    size_t begin = builder->batchBegin + count * task->id / task->count;
+    size_t end = builder->batchBegin + count * (task->id + 1) / task->count;
+    for (size_t i = begin; i < end; i++) {
+        const char* p = builder->reads[i].data;
+        const char* readEnd = p + builder->reads[i].length;
+        kmer_t kmer = 0, prev = 0;
+        int valid = 0, havePrev = 0, prevPred = -1;
+        for (; p < readEnd; p++) {
+            if (*p == '\n' || *p == '\r') continue;
+            int code = encodeBase(*p);
+            if (code < 0) {
+                if (havePrev) emitKmer(row, numParts, k, canonical, prev, prevPred, -1);
+                valid = havePrev = 0;
+                continue;
+            }
+            kmer = ((kmer << 2) | (kmer_t)code) & mask;
+            if (++valid < k) continue;
+            int pred = -1;
+            if (havePrev) {
+                emitKmer(row, numParts, k, canonical, prev, prevPred, code);
+                pred = (int)((prev >> (2 * (k - 1))) & 3);
+            }
+            prev = kmer;
+            prevPred = pred;
+            havePrev = 1;
+        }
+        if (havePrev) emitKmer(row, numParts, k, canonical, prev, prevPred, -1);
+    }
+    return NULL;
 }
 
-// Function to construct the de Bruijn graph from reads
-void constructDeBruijnGraph(Node* graph[], const char* reads[], int numReads, int k) {
+// Pass 1b: worker p drains column p of the bucket matrix into partition p
+static void* mergeTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    GraphBuilder* builder = (GraphBuilder*)task->ctx;
+    int numParts = builder->graph->numParts;
+    KmerPartition* part = &builder->graph->parts[task->id];
+    BloomFilter* bloom = builder->blooms ? &builder->blooms[task->id] : NULL;
+    for (int t = 0; t < task->count; t++) {
+        const RecordBucket* bucket = &builder->buckets[(size_t)t * numParts + task->id];
+        for (size_t r = 0; r < bucket->size; r++) {
+            // The first sighting of a k-mer only sets its Bloom bits,
+            // its neighbours included
+            const KmerRecord* record = &bucket->records[r];
+            if (bloom && !bloomTestAndSet(bloom, record->kmer)) {
+                bloomSetEdges(bloom, record->kmer, record->successor);
+                continue;
+            }
+            addNode(part, record->kmer, record->successor);
+        }
+    }
+    return NULL;
+}
+
+// Drop a partition's k-mers whose table count is below minTableCount and
+// rebuild its table over the survivors
+static void prunePartition(KmerPartition* part, int minTableCount) {
+    uint32_t kept = 0;
+    for (uint32_t id = 0; id < part->numNodes; id++) {
+        if ((int)part->counts[id] < minTableCount) continue;
+        part->kmers[kept] = part->kmers[id];
+        part->outMask[kept] = part->outMask[id];
+        kept++;
+    }
+    kmerTableFree(&part->table);
+    kmerTableInit(&part->table, kept);
+    for (uint32_t id = 0; id < kept; id++) {
+        int inserted;
+        kmerTableInsert(&part->table, part->kmers[id], id, &inserted);
+    }
+    part->numNodes = kept;
+    free(part->counts);
+    part->counts = NULL;
+}
+
+// Drop partition p's k-mers seen fewer than minCount times. The Bloom
+// filter absorbed each k-mer's first occurrence, so the table count is one
+// short of the true count, and the neighbours of that occurrence are read
+// back from the filter for the k-mers that stay. A Bloom false positive
+// can let a singleton through with a count of one, or add a neighbour bit
+// no read has; pruneEdgesTask still drops bits whose k-mer is not a node.
+static void* pruneTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    GraphBuilder* builder = (GraphBuilder*)task->ctx;
+    KmerPartition* part = &builder->graph->parts[task->id];
+    const BloomFilter* bloom = &builder->blooms[task->id];
+    uint8_t neighbours = builder->graph->canonical ? 0xff : 0x0f;
+    for (uint32_t id = 0; id < part->numNodes; id++) {
+        if ((int)part->counts[id] < builder->minCount - 1) continue;
+        part->outMask[id] |= bloomEdges(bloom, part->kmers[id], neighbours);
+    }
+    prunePartition(part, builder->minCount - 1);
+    return NULL;
+}
+
+// Give partitions contiguous global ID ranges and gather node data
+static void joinPartitions(DeBruijnGraph* graph) {
+    uint32_t total = 0;
+    for (int p = 0; p < graph->numParts; p++) {
+        graph->partBase[p] = total;
+        total += graph->parts[p].numNodes;
+    }
+    graph->partBase[graph->numParts] = total;
+    graph->numNodes = total;
+    graph->kmers = (kmer_t*)xmalloc(((size_t)total + 1) * sizeof(kmer_t));
+    graph->outMask = (uint8_t*)xmalloc((size_t)total + 1);
+    for (int p = 0; p < graph->numParts; p++) {
+        KmerPartition* part = &graph->parts[p];
+        memcpy(graph->kmers + graph->partBase[p], part->kmers, part->numNodes * sizeof(kmer_t));
+        memcpy(graph->outMask + graph->partBase[p], part->outMask, part->numNodes);
+        free(part->kmers);
+        free(part->outMask);
+        part->kmers = NULL;
+        part->outMask = NULL;
+    }
+}
+
+// Pass 2b: resolve each successor k-mer to its vertex ID for a node range.
+// Edges of a vertex are ordered by base.
+static void* adjacencyTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    DeBruijnGraph* graph = (DeBruijnGraph*)task->ctx;
+    kmer_t mask = kmerMask(graph->k);
+    uint32_t n = graph->numNodes;
+    uint32_t begin = (uint32_t)((uint64_t)n * task->id / task->count);
+    uint32_t end = (uint32_t)((uint64_t)n * (task->id + 1) / task->count);
+    uint32_t strands = graph->canonical ? 2 : 1;
+    for (uint32_t v = begin * strands; v < end * strands; v++) {
+        uint64_t e = graph->offsets[v];
+        kmer_t shifted = (vertexKmer(graph, v) << 2) & mask;
+        unsigned successors = vertexSuccessors(graph, v);
+        for (int b = 0; b < 4; b++) {
+            if (successors & (1u << b)) {
+                graph->targets[e++] = findVertex(graph, shifted | (kmer_t)b);
+            }
+        }
+    }
+    return NULL;
+}
+
+// After filtering, clear successor bits whose k-mer did not survive. Tasks
+// split by node so both strands of a node's mask stay with one thread.
+static void* pruneEdgesTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    DeBruijnGraph* graph = (DeBruijnGraph*)task->ctx;
+    kmer_t mask = kmerMask(graph->k);
+    uint32_t n = graph->numNodes;
+    uint32_t begin = (uint32_t)((uint64_t)n * task->id / task->count);
+    uint32_t end = (uint32_t)((uint64_t)n * (task->id + 1) / task->count);
+    uint32_t strands = graph->canonical ? 2 : 1;
+    for (uint32_t v = begin * strands; v < end * strands; v++) {
+        kmer_t shifted = (vertexKmer(graph, v) << 2) & mask;
+        unsigned bitBase = graph->canonical ? 4 * (v & 1) : 0;
+        for (int b = 0; b < 4; b++) {
+            if ((vertexSuccessors(graph, v) & (1u << b)) && findVertex(graph, shifted | (kmer_t)b) == UINT32_MAX) {
+                graph->outMask[v / strands] &= (uint8_t)~(1u << (bitBase + b));
+            }
+        }
+    }
+    return NULL;
+}
+
+// Pass 2a: size the CSR rows from the successor masks
+static void buildAdjacency(DeBruijnGraph* graph, int numThreads, int pruneEdges) {
+    uint32_t n = numVertices(graph);
+    if (pruneEdges) runTasks(pruneEdgesTask, graph, numThreads);
+    graph->offsets = (uint64_t*)xmalloc(((size_t)n + 1) * sizeof(uint64_t));
+    uint64_t total = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        graph->offsets[v] = total;
+        total += (uint64_t)__builtin_popcount(vertexSuccessors(graph, v));
+    }
+    graph->offsets[n] = total;
+    graph->numEdges = total;
+    graph->targets = (uint32_t*)xmalloc(total * sizeof(uint32_t));
+    runTasks(adjacencyTask, graph, numThreads);
+}
+
+// Start an incremental build with numThreads workers (one hash partition
+// per worker). Reads are then fed through addReadsToGraph in any number of
+// calls; their text only has to stay valid for the duration of each call.
+void beginGraphBuild(GraphBuilder* builder, DeBruijnGraph* graph, int k, int numThreads, size_t expectedNodes) {
+    if (numThreads < 1) numThreads = 1;
+    initGraph(graph, k, numThreads, expectedNodes);
+    memset(builder, 0, sizeof(*builder));
+    builder->graph = graph;
+    builder->numThreads = numThreads;
+    builder->buckets = (RecordBucket*)xcalloc((size_t)numThreads * numThreads, sizeof(RecordBucket));
+}
+
+// Merge each k-mer with its reverse complement so reads from either strand
+// land on the same nodes (a bidirected graph). Call before adding reads.
+// Use an odd k: an even k-mer can be its own reverse complement, and its
+// two vertices then spell the same sequence.
+void enableCanonicalKmers(GraphBuilder* builder) {
+    builder->graph->canonical = 1;
+}
+
+// Only keep k-mers seen at least minCount (2..MAX_MIN_COUNT) times. A
+// cache-blocked Bloom filter of bloomBytes, split across partitions, absorbs
+// first occurrences so erroneous singletons never reach the hash tables.
+// Returns -1, leaving the build unfiltered, if minCount is out of range.
+int enableKmerFilter(GraphBuilder* builder, int minCount, size_t bloomBytes) {
+    if (minCount < 1 || minCount > MAX_MIN_COUNT) return -1;
+    DeBruijnGraph* graph = builder->graph;
+    builder->minCount = minCount;
+    builder->blooms = (BloomFilter*)xmalloc((size_t)graph->numParts * sizeof(BloomFilter));
+    for (int p = 0; p < graph->numParts; p++) {
+        bloomInit(&builder->blooms[p], bloomBytes / (size_t)graph->numParts);
+        graph->parts[p].counts = (uint8_t*)xcalloc(graph->parts[p].capacity, 1);
+    }
+    return 0;
+}
+
+// Count the k-mers of a set of reads in batches: workers extract k-mers
+// into per-partition buckets, then each worker merges one partition's
+// buckets into that partition's table.
+void addReadsToGraph(GraphBuilder* builder, const SeqView* reads, size_t numReads) {
+    size_t batchSize = (size_t)READS_PER_WORKER_BATCH * builder->numThreads;
+    builder->reads = reads;
+    for (size_t begin = 0; begin < numReads; begin += batchSize) {
+        builder->batchBegin = begin;
+        builder->batchEnd = numReads - begin < batchSize ? numReads : begin + batchSize;
+        runTasks(extractTask, builder, builder->numThreads);
+        runTasks(mergeTask, builder, builder->numThreads);
+    }
+    builder->reads = NULL;
+}
+
+// Assign global node IDs and lay out the CSR adjacency
+void finishGraphBuild(GraphBuilder* builder) {
+    int numThreads = builder->numThreads;
+    for (int b = 0; b < numThreads * numThreads; b++) free(builder->buckets[b].records);
+    free(builder->buckets);
+    builder->buckets = NULL;
+    int filtered = builder->blooms != NULL;
+    if (filtered) {
+        runTasks(pruneTask, builder, numThreads);
+        for (int p = 0; p < builder->graph->numParts; p++) free(builder->blooms[p].blocks);
+        free(builder->blooms);
+        builder->blooms = NULL;
+    }
+    joinPartitions(builder->graph);
+    buildAdjacency(builder->graph, numThreads, filtered);
+}
+
+// Function to construct the de Bruijn graph from NUL-terminated reads
+void constructDeBruijnGraph(DeBruijnGraph* graph, const char* reads[], int numReads, int k, int numThreads) {
+    SeqView* views = (SeqView*)xmalloc((size_t)numReads * sizeof(SeqView) + 1);
     for (int i = 0; i < numReads; i++) {
-        int readLength = strlen(reads[i]);
-        for (int j = 0; j < readLength - k; j++) {
-            char fromKmer[MAX_READ_LENGTH], toKmer[MAX_READ_LENGTH];
-            strncpy(fromKmer, &reads[i][j], k);
-            fromKmer[k] = '\0';
-            strncpy(toKmer, &reads[i][j + 1], k);
-            toKmer[k] = '\0';
-            addEdge(graph, fromKmer, toKmer);
-        }
-    }
-}
-
-// Function to perform an Eulerian walk and reconstruct the DNA sequence
-void eulerianWalk(Node* graph[], char* sequence, const char* startKmer) {
-    Node* stack[MAX_READS];
-    int top = -1;
-
-    // Push the starting k-mer onto the stack
-    stack[++top] = createNode(startKmer);
-
-    while (top >= 0) {
-        Node* current = stack[top];
-        if (graph[current->kmer[0] - 'A'] != NULL) {
-            // Push the next k-mer onto the stack
-            Node* next = graph[current->kmer[0] - 'A'];
-            stack[++top] = createNode(next->kmer);
-            // Remove the edge from the graph
-            graph[current->kmer[0] - 'A'] = next->next;
+        views[i].data = reads[i];
+        views[i].length = strlen(reads[i]);
+    }
+    GraphBuilder builder;
+    beginGraphBuild(&builder, graph, k, numThreads, (size_t)numReads);
+    addReadsToGraph(&builder, views, (size_t)numReads);
+    finishGraphBuild(&builder);
+    free(views);
+}
+
+// Pick a start node for an Eulerian path: the node whose out-degree exceeds
+// its in-degree if there is one, otherwise any node with an outgoing edge
+static uint32_t findPathStart(const uint64_t* offsets, const uint32_t* targets, uint32_t numNodes, uint64_t numEdges) {
+    uint32_t* inDegree = (uint32_t*)xcalloc(numNodes, sizeof(uint32_t));
+    for (uint64_t e = 0; e < numEdges; e++) inDegree[targets[e]]++;
+    uint32_t start = UINT32_MAX;
+    for (uint32_t v = 0; v < numNodes; v++) {
+        uint64_t outDegree = offsets[v + 1] - offsets[v];
+        if (outDegree > inDegree[v]) {
+            start = v;
+            break;
+        }
+        if (start == UINT32_MAX && outDegree > 0) start = v;
+    }
+    free(inDegree);
+    return start;
+}
+
+// Output buffer filled back-to-front as nodes are popped. It grows at the
+// front, since the number of trails (and so the length) is only known
+// once the walk is done.
+typedef struct SpellContext {
+    const void* graph;
+    char* sequence;
+    size_t length;          // bytes before the terminating NUL
+    size_t pos;             // first byte written so far
+    uint32_t trails;
+} SpellContext;
+
+static void beginSpelling(SpellContext* ctx, const void* graph, size_t length) {
+    ctx->graph = graph;
+    ctx->sequence = (char*)xmalloc(length + 1);
+    ctx->sequence[length] = '\0';
+    ctx->length = length;
+    ctx->pos = length;
+    ctx->trails = 0;
+}
+
+// Write one character in front of what is already spelled
+static inline void spellChar(SpellContext* ctx, char c) {
+    if (ctx->pos == 0) {
+        size_t length = 2 * ctx->length + 1;
+        char* bigger = (char*)xmalloc(length + 1);
+        memcpy(bigger + (length - ctx->length), ctx->sequence, ctx->length + 1);
+        free(ctx->sequence);
+        ctx->sequence = bigger;
+        ctx->pos = length - ctx->length;
+        ctx->length = length;
+    }
+    ctx->sequence[--ctx->pos] = c;
+}
+
+// Spells part of a node: tail what it adds after a predecessor's overlap,
+// head the overlap itself
+typedef void (*SpellFn)(SpellContext* ctx, uint32_t node);
+
+// Hierholzer's algorithm over a CSR graph: each node keeps a cursor into
+// its row so every edge is followed once, with a growable node stack.
+// Runs in O(V + E). Nodes pop in reverse path order, and a node popped
+// right after the one above it on the stack precedes it on the path, so
+// tail() spells it and head() spells the first node once the stack is
+// empty. Without an Eulerian path from start (unbalanced degrees), a
+// sub-walk can get stuck at a node other than the one it set out from;
+// the node popped next then has no edge to the last one. That node
+// instead gets the one it was pushed from, so the finished trail starts
+// with the edge it was reached by, and a newline separates the trails.
+// Every edge followed is spelled once and no trail joins two nodes that
+// are not linked.
+static void hierholzer(const uint64_t* offsets, const uint32_t* targets, uint32_t numNodes, uint32_t start,
+                       SpellFn tail, SpellFn head, SpellContext* ctx) {
+    uint64_t* cursor = (uint64_t*)xmalloc(((size_t)numNodes + 1) * sizeof(uint64_t));
+    memcpy(cursor, offsets, (size_t)numNodes * sizeof(uint64_t));
+    size_t stackCapacity = 1024;
+    size_t top = 0;
+    uint32_t* stack = (uint32_t*)xmalloc(stackCapacity * sizeof(uint32_t));
+    uint32_t below = UINT32_MAX;    // node under the last one popped
+
+    // Push the starting node onto the stack
+    stack[top++] = start;
+    ctx->trails = 1;
+
+    while (top > 0) {
+        uint32_t current = stack[top - 1];
+        if (cursor[current] < offsets[current + 1]) {
+            // Follow the next unused edge
+            if (top == stackCapacity) {
+                stackCapacity *= 2;
+                stack = (uint32_t*)xrealloc(stack, stackCapacity * sizeof(uint32_t));
+            }
+            stack[top++] = targets[cursor[current]++];
         } else {
-            // Pop the k-mer and append it to the sequence
-            strcat(sequence, &current->kmer[strlen(current->kmer) - 1]);
             top--;
-            free(current);
+            if (below != UINT32_MAX && current != below) {
+                // Stuck elsewhere: close the trail at the edge it was reached by
+                tail(ctx, below);
+                head(ctx, below);
+                spellChar(ctx, '\n');
+                ctx->trails++;
+            }
+            tail(ctx, current);
+            below = top > 0 ? stack[top - 1] : UINT32_MAX;
+            if (top == 0) head(ctx, current);
+        }
+    }
+    free(stack);
+    free(cursor);
+}
+
+// Each k-mer after the first on a trail adds its last base
+static void spellKmerTail(SpellContext* ctx, uint32_t node) {
+    kmer_t kmer = vertexKmer((const DeBruijnGraph*)ctx->graph, node);
+    spellChar(ctx, decodeBase((int)(kmer & 3)));
+}
+
+// The first k-mer of a trail also spells its first k - 1 bases
+static void spellKmerHead(SpellContext* ctx, uint32_t node) {
+    const DeBruijnGraph* graph = (const DeBruijnGraph*)ctx->graph;
+    kmer_t kmer = vertexKmer(graph, node) >> 2;
+    for (int i = 1; i < graph->k; i++, kmer >>= 2) spellChar(ctx, decodeBase((int)(kmer & 3)));
+}
+
+// Move the spelled text to the front of the buffer
+static char* finishSpelling(SpellContext* ctx) {
+    if (ctx->pos > 0) memmove(ctx->sequence, ctx->sequence + ctx->pos, ctx->length - ctx->pos + 1);
+    return ctx->sequence;
+}
+
+// Function to perform an Eulerian walk and reconstruct the DNA sequence.
+// Nodes are popped in reverse path order, so the sequence is written
+// back-to-front. Pass startKmer = NULL to choose the start from degree
+// balance. Returns a malloc'd string, or NULL if the start k-mer is not in
+// the graph. When the edges reachable from the start form an Eulerian
+// path the string is that path, k + edges bases; otherwise it holds the
+// trails the walk broke into, one per line, each spelling only k-mers and
+// edges of the graph (*trails, if not NULL, gets their number). Edges not
+// reachable from the start are not spelled. A canonical graph is walked
+// over its vertices; without inverted repeats the two strands form
+// separate components and the walk spells one of them.
+char* eulerianWalk(const DeBruijnGraph* graph, const char* startKmer, uint32_t* trails) {
+    int k = graph->k;
+    uint32_t start;
+    if (startKmer != NULL) {
+        kmer_t startCode;
+        if (!encodeKmer(startKmer, k, &startCode) ||
+            (start = findVertex(graph, startCode)) == UINT32_MAX) {
+            return NULL;
+        }
+    } else {
+        start = findPathStart(graph->offsets, graph->targets, numVertices(graph), graph->numEdges);
+        if (start == UINT32_MAX) return NULL;
+    }
+
+    // One base per edge plus the k bases of the start node, if the walk
+    // does not break into trails
+    SpellContext ctx;
+    beginSpelling(&ctx, graph, (size_t)graph->numEdges + (size_t)k);
+    hierholzer(graph->offsets, graph->targets, numVertices(graph), start, spellKmerTail, spellKmerHead, &ctx);
+    if (trails != NULL) *trails = ctx.trails;
+    return finishSpelling(&ctx);
+}
+
+static inline int unitigBase(const UnitigGraph* unitigs, uint64_t i) {
+    return (int)((unitigs->bases[i >> 5] >> (2 * (i & 31))) & 3);
+}
+
+void freeUnitigGraph(UnitigGraph* unitigs) {
+    free(unitigs->seqStart);
+    free(unitigs->bases);
+    free(unitigs->offsets);
+    free(unitigs->targets);
+    memset(unitigs, 0, sizeof(*unitigs));
+}
+
+// Growable packed base store used while unitigs are laid out
+typedef struct BaseWriter {
+    uint64_t* words;
+    uint64_t length;
+    uint64_t capacity;      // in words
+} BaseWriter;
+
+static void appendBase(BaseWriter* writer, int code) {
+    uint64_t word = writer->length >> 5;
+    if (word == writer->capacity) {
+        writer->capacity = writer->capacity ? writer->capacity * 2 : 1024;
+        writer->words = (uint64_t*)xrealloc(writer->words, writer->capacity * sizeof(uint64_t));
+    }
+    if ((writer->length & 31) == 0) writer->words[word] = 0;
+    writer->words[word] |= (uint64_t)code << (2 * (writer->length & 31));
+    writer->length++;
+}
+
+// Compact the node-level graph into unitigs. A vertex continues its
+// predecessor's unitig when that predecessor has exactly one successor and
+// the vertex has exactly one predecessor; every other vertex starts a
+// unitig. Isolated cycles have no such start and are opened at an
+// arbitrary vertex. On a canonical graph, placing a vertex also places its
+// mirror on the other strand, so each path is stored once; the mirror of
+// a unitig starts at the mirror of its last vertex. The node-level graph
+// is left intact; callers free it once compacted.
+void compactGraph(const DeBruijnGraph* graph, UnitigGraph* unitigs) {
+    uint32_t n = numVertices(graph);
+    int k = graph->k;
+    int canonical = graph->canonical;
+    memset(unitigs, 0, sizeof(*unitigs));
+    unitigs->k = k;
+    unitigs->canonical = canonical;
+
+    uint8_t* inDegree = (uint8_t*)xcalloc(n, 1);
+    for (uint64_t e = 0; e < graph->numEdges; e++) inDegree[graph->targets[e]]++;
+    // Bit 0: vertex continues its predecessor's unitig; bit 1: placed in a unitig
+    uint8_t* state = (uint8_t*)xcalloc(n, 1);
+    for (uint32_t u = 0; u < n; u++) {
+        if (graph->offsets[u + 1] - graph->offsets[u] != 1) continue;
+        uint32_t v = graph->targets[graph->offsets[u]];
+        if (v != u && inDegree[v] == 1) state[v] |= 1;
+    }
+    free(inDegree);
+
+    // headOf maps the first vertex of each oriented unitig to it; ends
+    // holds each unitig's first and last vertex to resolve links
+    uint32_t* headOf = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    uint32_t capacity = 1024;
+    uint32_t* ends = (uint32_t*)xmalloc(2 * (size_t)capacity * sizeof(uint32_t));
+    unitigs->seqStart = (uint64_t*)xmalloc(((size_t)capacity + 1) * sizeof(uint64_t));
+    BaseWriter writer = { NULL, 0, 0 };
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t v = 0; v < n; v++) {
+            if (state[v] & 2) continue;
+            if (pass == 0 && (state[v] & 1)) continue;  // interior vertex, or part of a cycle
+            uint32_t id = unitigs->numUnitigs++;
+            if (id == capacity) {
+                capacity *= 2;
+                ends = (uint32_t*)xrealloc(ends, 2 * (size_t)capacity * sizeof(uint32_t));
+                unitigs->seqStart = (uint64_t*)xrealloc(unitigs->seqStart, ((size_t)capacity + 1) * sizeof(uint64_t));
+            }
+            unitigs->seqStart[id] = writer.length;
+            headOf[v] = canonical ? 2 * id : id;
+            kmer_t kmer = vertexKmer(graph, v);
+            for (int i = k - 1; i >= 0; i--) appendBase(&writer, (int)((kmer >> (2 * i)) & 3));
+
+            uint32_t cur = v;
+            state[cur] |= 2;
+            if (canonical) state[cur ^ 1] |= 2;
+            while (graph->offsets[cur + 1] - graph->offsets[cur] == 1) {
+                uint32_t next = graph->targets[graph->offsets[cur]];
+                if (!(state[next] & 1) || (state[next] & 2)) break;
+                appendBase(&writer, (int)(vertexKmer(graph, next) & 3));
+                state[next] |= 2;
+                if (canonical) state[next ^ 1] |= 2;
+                cur = next;
+            }
+            ends[2 * id] = v;
+            ends[2 * id + 1] = cur;
+            if (canonical) headOf[cur ^ 1] = 2 * id + 1;
+        }
+    }
+    unitigs->seqStart[unitigs->numUnitigs] = writer.length;
+    unitigs->bases = writer.words;
+    free(state);
+
+    // Links leave from each oriented unitig's last vertex and always land
+    // on a head
+    uint32_t m = canonical ? 2 * unitigs->numUnitigs : unitigs->numUnitigs;
+    uint32_t* last = (uint32_t*)xmalloc(((size_t)m + 1) * sizeof(uint32_t));
+    for (uint32_t u = 0; u < m; u++) {
+        if (!canonical) last[u] = ends[2 * u + 1];
+        else last[u] = (u & 1) ? ends[u - 1] ^ 1 : ends[u + 1];
+    }
+    free(ends);
+    unitigs->offsets = (uint64_t*)xmalloc(((size_t)m + 1) * sizeof(uint64_t));
+    uint64_t total = 0;
+    for (uint32_t u = 0; u < m; u++) {
+        unitigs->offsets[u] = total;
+        total += graph->offsets[last[u] + 1] - graph->offsets[last[u]];
+    }
+    unitigs->offsets[m] = total;
+    unitigs->numEdges = total;
+    unitigs->targets = (uint32_t*)xmalloc(total * sizeof(uint32_t));
+    for (uint32_t u = 0; u < m; u++) {
+        uint64_t e = unitigs->offsets[u];
+        for (uint64_t g = graph->offsets[last[u]]; g < graph->offsets[last[u] + 1]; g++) {
+            unitigs->targets[e++] = headOf[graph->targets[g]];
+        }
+    }
+    free(last);
+    free(headOf);
+}
+
+static inline uint32_t numOrientedUnitigs(const UnitigGraph* unitigs) {
+    return unitigs->canonical ? 2 * unitigs->numUnitigs : unitigs->numUnitigs;
+}
+
+static inline uint64_t unitigLength(const UnitigGraph* unitigs, uint32_t u) {
+    if (unitigs->canonical) u >>= 1;
+    return unitigs->seqStart[u + 1] - unitigs->seqStart[u];
+}
+
+// Spell bases [from, to) of oriented unitig u, back to front. The reverse
+// strand reads the complement of the stored bases in reverse.
+static void spellUnitigBases(SpellContext* ctx, uint32_t u, uint64_t from, uint64_t to) {
+    const UnitigGraph* unitigs = (const UnitigGraph*)ctx->graph;
+    if (unitigs->canonical && (u & 1)) {
+        uint64_t last = unitigs->seqStart[(u >> 1) + 1] - 1;
+        for (uint64_t i = to; i > from; i--) spellChar(ctx, decodeBase(3 - unitigBase(unitigs, last - (i - 1))));
+        return;
+    }
+    uint64_t first = unitigs->seqStart[unitigs->canonical ? u >> 1 : u];
+    for (uint64_t i = to; i > from; i--) spellChar(ctx, decodeBase(unitigBase(unitigs, first + i - 1)));
+}
+
+// A linked unitig overlaps its predecessor by k - 1 bases
+static void spellUnitigTail(SpellContext* ctx, uint32_t u) {
+    const UnitigGraph* unitigs = (const UnitigGraph*)ctx->graph;
+    spellUnitigBases(ctx, u, (uint64_t)(unitigs->k - 1), unitigLength(unitigs, u));
+}
+
+static void spellUnitigHead(SpellContext* ctx, uint32_t u) {
+    spellUnitigBases(ctx, u, 0, (uint64_t)(((const UnitigGraph*)ctx->graph)->k - 1));
+}
+
+// Eulerian walk over the compacted graph. Each link is followed once and
+// each unitig visit spells its bases past the k - 1 overlap. On a balanced
+// graph this spells the same path as eulerianWalk; otherwise a unitig with
+// several incoming links (a collapsed repeat) is spelled once per link,
+// where the node-level walk can only use its interior edges once. A walk
+// that breaks into trails returns them one per line, as eulerianWalk does.
+char* eulerianWalkUnitigs(const UnitigGraph* unitigs, uint32_t* trails) {
+    uint32_t m = numOrientedUnitigs(unitigs);
+    uint32_t start = findPathStart(unitigs->offsets, unitigs->targets, m, unitigs->numEdges);
+    if (start == UINT32_MAX) {
+        // No links at all: the graph is a single unitig (or empty)
+        if (unitigs->numUnitigs == 0) return NULL;
+        start = 0;
+    }
+    size_t length = (size_t)unitigLength(unitigs, start);
+    for (uint64_t e = 0; e < unitigs->numEdges; e++) {
+        length += (size_t)unitigLength(unitigs, unitigs->targets[e]) - (size_t)(unitigs->k - 1);
+    }
+    SpellContext ctx;
+    beginSpelling(&ctx, unitigs, length);
+    hierholzer(unitigs->offsets, unitigs->targets, m, start, spellUnitigTail, spellUnitigHead, &ctx);
+    if (trails != NULL) *trails = ctx.trails;
+    return finishSpelling(&ctx);
+}
+
+// Bytes of input parsed per window; views for one window are handed to the
+// k-mer stage before the next window is read
+#define READER_WINDOW_SIZE ((size_t)64 << 20)
+
+// Advance to the start of the line after position pos
+static size_t nextLine(const char* text, size_t len, size_t pos) {
+    const char* nl = (const char*)memchr(text + pos, '\n', len - pos);
+    return nl ? (size_t)(nl - text) + 1 : len;
+}
+
+// First record start at or after pos, or len if none can be confirmed
+// inside the buffer. A FASTQ record start is an '@' line followed two lines
+// later by a '+' line, which a quality line starting with '@' never is.
+static size_t nextRecordStart(const char* text, size_t len, size_t pos, SeqFormat format) {
+    if (pos > 0 && pos < len && text[pos - 1] != '\n') pos = nextLine(text, len, pos);
+    while (pos < len) {
+        if (format == FORMAT_FASTA && text[pos] == '>') return pos;
+        if (format == FORMAT_FASTQ && text[pos] == '@') {
+            size_t plusLine = nextLine(text, len, nextLine(text, len, pos));
+            if (plusLine >= len) return len;
+            if (text[plusLine] == '+') return pos;
+        }
+        pos = nextLine(text, len, pos);
+    }
+    return len;
+}
+
+static int detectFormat(const char* text, size_t len, SeqFormat* format) {
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '>') { *format = FORMAT_FASTA; return 1; }
+        if (text[i] == '@') { *format = FORMAT_FASTQ; return 1; }
+        if (text[i] != '\n' && text[i] != '\r' && text[i] != ' ') break;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+// Top up the inflate buffer; returns the number of bytes added
+static size_t fillBuffer(SeqReader* reader) {
+    size_t added = 0;
+    while (!reader->eof && reader->bufferLen < reader->bufferSize) {
+        size_t want = reader->bufferSize - reader->bufferLen;
+        if (want > INT32_MAX) want = INT32_MAX;
+        int got = gzread(reader->gz, reader->buffer + reader->bufferLen, (unsigned)want);
+        if (got < 0) {
+            int err;
+            fprintf(stderr, "gzip read error: %s\n", gzerror(reader->gz, &err));
+            exit(EXIT_FAILURE);
+        }
+        if (got == 0) reader->eof = 1;
+        reader->bufferLen += (size_t)got;
+        added += (size_t)got;
+    }
+    return added;
+}
+#endif
+
+// Open a FASTA/FASTQ file; returns 0 on success, -1 after printing an error
+int openSeqReader(SeqReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) {
+        perror(path);
+        return -1;
+    }
+    unsigned char magic[2] = {0, 0};
+    ssize_t got = pread(reader->fd, magic, 2, 0);
+    reader->compressed = got == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+
+    if (reader->compressed) {
+#ifdef HAVE_ZLIB
+        reader->gz = gzdopen(reader->fd, "rb");
+        if (reader->gz == NULL) {
+            fprintf(stderr, "%s: cannot open gzip stream\n", path);
+            close(reader->fd);
+            return -1;
+        }
+        gzbuffer(reader->gz, 1 << 20);
+        reader->bufferSize = READER_WINDOW_SIZE;
+        reader->buffer = (char*)xmalloc(reader->bufferSize);
+        fillBuffer(reader);
+        if (!detectFormat(reader->buffer, reader->bufferLen, &reader->format)) {
+            fprintf(stderr, "%s: not a FASTA or FASTQ file\n", path);
+            gzclose(reader->gz);
+            free(reader->buffer);
+            return -1;
+        }
+        return 0;
+#else
+        fprintf(stderr, "%s: gzip input needs a build with -DHAVE_ZLIB -lz\n", path);
+        close(reader->fd);
+        return -1;
+#endif
+    }
+
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0) {
+        perror(path);
+        close(reader->fd);
+        return -1;
+    }
+    reader->mapSize = (size_t)st.st_size;
+    if (reader->mapSize > 0) {
+        void* map = mmap(NULL, reader->mapSize, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map == MAP_FAILED) {
+            perror(path);
+            close(reader->fd);
+            return -1;
         }
+        madvise(map, reader->mapSize, MADV_SEQUENTIAL);
+        reader->map = (const char*)map;
+    }
+    if (!detectFormat(reader->map, reader->mapSize, &reader->format)) {
+        fprintf(stderr, "%s: not a FASTA or FASTQ file\n", path);
+        if (reader->map) munmap((void*)reader->map, reader->mapSize);
+        close(reader->fd);
+        return -1;
     }
+    return 0;
 }
 
-int main() {
+// Hand out the next window of whole records. The previous window's text is
+// invalidated by this call. Returns 0 once the input is exhausted.
+int nextSeqWindow(SeqReader* reader, const char** text, size_t* len) {
+    if (!reader->compressed) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t consumed = reader->pos / page * page;
+        if (consumed > reader->released) {
+            madvise((void*)(reader->map + reader->released), consumed - reader->released, MADV_DONTNEED);
+            reader->released = consumed;
+        }
+        if (reader->pos >= reader->mapSize) return 0;
+        size_t end = reader->pos + READER_WINDOW_SIZE;
+        end = end >= reader->mapSize ? reader->mapSize
+                                     : nextRecordStart(reader->map, reader->mapSize, end, reader->format);
+        *text = reader->map + reader->pos;
+        *len = end - reader->pos;
+        reader->pos = end;
+        return 1;
+    }
+#ifdef HAVE_ZLIB
+    size_t carry = reader->bufferLen - reader->windowEnd;
+    memmove(reader->buffer, reader->buffer + reader->windowEnd, carry);
+    reader->bufferLen = carry;
+    reader->windowEnd = 0;
+    fillBuffer(reader);
+    if (reader->bufferLen == 0) return 0;
+    size_t end = reader->bufferLen;
+    while (!reader->eof) {
+        // Cut at the first record found in the last eighth of the buffer;
+        // grow the buffer if a single record is longer than that
+        end = nextRecordStart(reader->buffer, reader->bufferLen, reader->bufferLen - reader->bufferLen / 8,
+                              reader->format);
+        if (end < reader->bufferLen) break;
+        reader->bufferSize *= 2;
+        reader->buffer = (char*)xrealloc(reader->buffer, reader->bufferSize);
+        fillBuffer(reader);
+        end = reader->bufferLen;
+    }
+    *text = reader->buffer;
+    *len = end;
+    reader->windowEnd = end;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void closeSeqReader(SeqReader* reader) {
+#ifdef HAVE_ZLIB
+    if (reader->compressed) {
+        gzclose(reader->gz);
+        free(reader->buffer);
+        return;
+    }
+#endif
+    if (reader->map) munmap((void*)reader->map, reader->mapSize);
+    close(reader->fd);
+}
+
+// Growable list of views produced by one parser thread
+typedef struct ViewList {
+    SeqView* views;
+    size_t size;
+    size_t capacity;
+} ViewList;
+
+static void pushView(ViewList* list, const char* data, size_t length) {
+    if (list->size == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->views = (SeqView*)xrealloc(list->views, list->capacity * sizeof(SeqView));
+    }
+    list->views[list->size].data = data;
+    list->views[list->size].length = length;
+    list->size++;
+}
+
+// Parse whole records out of text; anything before the first header line
+// (and blank lines between records) is skipped
+static void parseRecords(SeqFormat format, const char* text, size_t len, ViewList* out) {
+    size_t pos = 0;
+    while (pos < len) {
+        char marker = format == FORMAT_FASTA ? '>' : '@';
+        if (text[pos] != marker) {
+            pos = nextLine(text, len, pos);
+            continue;
+        }
+        size_t seqStart = nextLine(text, len, pos);
+        size_t seqEnd = seqStart;
+        if (format == FORMAT_FASTA) {
+            // Sequence runs until the next header line or the end of text
+            while (seqEnd < len && text[seqEnd] != '>') seqEnd = nextLine(text, len, seqEnd);
+            pos = seqEnd;
+        } else {
+            seqEnd = nextLine(text, len, seqStart);
+            // Skip the '+' separator and the quality line
+            pos = nextLine(text, len, nextLine(text, len, seqEnd));
+        }
+        while (seqEnd > seqStart && (text[seqEnd - 1] == '\n' || text[seqEnd - 1] == '\r')) seqEnd--;
+        if (seqEnd > seqStart) pushView(out, text + seqStart, seqEnd - seqStart);
+    }
+}
+
+typedef struct ParseContext {
+    SeqFormat format;
+    const char* text;
+    size_t* bounds;         // numTasks + 1 chunk boundaries on record starts
+    ViewList* lists;        // one per task
+} ParseContext;
+
+static void* parseTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    ParseContext* ctx = (ParseContext*)task->ctx;
+    size_t begin = ctx->bounds[task->id];
+    size_t end = ctx->bounds[task->id + 1];
+    ctx->lists[task->id].size = 0;
+    parseRecords(ctx->format, ctx->text + begin, end - begin, &ctx->lists[task->id]);
+    return NULL;
+}
+
+// Parse one window with numThreads workers. The window is cut into chunks
+// aligned to record boundaries, each parsed independently, and the views
+// are gathered in input order into *views (grown as needed).
+size_t parseSeqWindow(SeqFormat format, const char* text, size_t len, int numThreads,
+                      SeqView** views, size_t* capacity) {
+    ParseContext ctx;
+    ctx.format = format;
+    ctx.text = text;
+    ctx.bounds = (size_t*)xmalloc(((size_t)numThreads + 1) * sizeof(size_t));
+    ctx.lists = (ViewList*)xcalloc((size_t)numThreads, sizeof(ViewList));
+    ctx.bounds[0] = 0;
+    for (int t = 1; t < numThreads; t++) {
+        size_t pos = nextRecordStart(text, len, len / numThreads * t, format);
+        ctx.bounds[t] = pos < ctx.bounds[t - 1] ? ctx.bounds[t - 1] : pos;
+    }
+    ctx.bounds[numThreads] = len;
+    runTasks(parseTask, &ctx, numThreads);
+
+    size_t total = 0;
+    for (int t = 0; t < numThreads; t++) total += ctx.lists[t].size;
+    if (total > *capacity) {
+        *capacity = total;
+        *views = (SeqView*)xrealloc(*views, total * sizeof(SeqView));
+    }
+    size_t n = 0;
+    for (int t = 0; t < numThreads; t++) {
+        memcpy(*views + n, ctx.lists[t].views, ctx.lists[t].size * sizeof(SeqView));
+        n += ctx.lists[t].size;
+        free(ctx.lists[t].views);
+    }
+    free(ctx.lists);
+    free(ctx.bounds);
+    return n;
+}
+
+// External-memory build. Pass 1 streams the reads once, cuts each run of
+// k-mers into super-k-mers (maximal stretches whose k-mers fall in the same
+// minimizer bucket) and appends them, 2-bit packed, to one temporary file
+// per bucket. Every occurrence of a k-mer has the same minimizer, so pass 2
+// can count the buckets one at a time, each into its own graph partition,
+// and only one bucket's counting state is in memory at once.
+#define DEFAULT_MINIMIZER_LEN 13
+#define MAX_BUCKETS 512
+#define MAX_SUPER_KMER_BASES ((uint32_t)1 << 20)
+
+// Per-thread, per-bucket output of pass 1, flushed to the bucket files
+typedef struct ByteBuffer {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+// Scratch arrays for one pass-1 worker, reused across reads
+typedef struct SuperKmerScratch {
+    uint8_t* codes;         // current run of bases as 2-bit codes
+    uint64_t* mmerHash;     // hash of the m-mer starting at each position
+    uint32_t* window;       // monotone deque of m-mer positions
+    int* bucket;            // minimizer bucket of each k-mer
+    size_t capacity;
+} SuperKmerScratch;
+
+typedef struct ExternalBuilder {
+    int k;
+    int m;
+    int canonical;
+    int numBuckets;
+    int numThreads;
+    int* fds;               // unlinked temporary file per bucket
+    uint64_t* bucketBytes;
+    ByteBuffer* out;        // numThreads x numBuckets
+    SuperKmerScratch* scratch;
+    size_t flushBytes;
+    const SeqView* reads;
+    size_t numReads;
+} ExternalBuilder;
+
+// Make room for size more bytes and return a pointer to them
+static uint8_t* reserveBytes(ByteBuffer* buffer, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (capacity < buffer->size + size) capacity *= 2;
+        buffer->data = (uint8_t*)xrealloc(buffer->data, capacity);
+        buffer->capacity = capacity;
+    }
+    uint8_t* out = buffer->data + buffer->size;
+    buffer->size += size;
+    return out;
+}
+
+static void writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            perror("writing bucket file");
+            exit(EXIT_FAILURE);
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+// Record layout: a 32-bit header followed by the bases packed four to a
+// byte. The header holds the base count in bits 6 and up, then the
+// predecessor and the successor as a 3-bit has-base flag and code each.
+static void appendSuperKmer(ByteBuffer* buffer, const uint8_t* codes, uint32_t numBases, int predecessor,
+                            int successor) {
+    uint32_t header = (numBases << 6) | (predecessor >= 0 ? 4u | (uint32_t)predecessor : 0u) << 3 |
+                      (successor >= 0 ? 4u | (uint32_t)successor : 0u);
+    size_t packedSize = (numBases + 3) / 4;
+    uint8_t* out = reserveBytes(buffer, sizeof(header) + packedSize);
+    memcpy(out, &header, sizeof(header));
+    uint8_t* packed = out + sizeof(header);
+    memset(packed, 0, packedSize);
+    for (uint32_t i = 0; i < numBases; i++) packed[i >> 2] |= (uint8_t)(codes[i] << (2 * (i & 3)));
+}
+
+static void ensureScratch(SuperKmerScratch* scratch, size_t length) {
+    if (length <= scratch->capacity) return;
+    size_t capacity = scratch->capacity ? scratch->capacity : 1024;
+    while (capacity < length) capacity *= 2;
+    scratch->codes = (uint8_t*)xrealloc(scratch->codes, capacity);
+    scratch->mmerHash = (uint64_t*)xrealloc(scratch->mmerHash, capacity * sizeof(uint64_t));
+    scratch->window = (uint32_t*)xrealloc(scratch->window, capacity * sizeof(uint32_t));
+    scratch->bucket = (int*)xrealloc(scratch->bucket, capacity * sizeof(int));
+    scratch->capacity = capacity;
+}
+
+// Split one run of valid bases into super-k-mers. Minimizers come from a
+// sliding-window minimum over the m-mer hashes (O(1) amortized per k-mer).
+static void emitRun(ExternalBuilder* eb, SuperKmerScratch* scratch, ByteBuffer* row, size_t length) {
+    int k = eb->k, m = eb->m;
+    if (length < (size_t)k) return;
+    const uint8_t* codes = scratch->codes;
+    kmer_t mmerMask = kmerMask(m), mmer = 0, mmerRc = 0;
+    for (size_t i = 0; i < length; i++) {
+        mmer = ((mmer << 2) | (kmer_t)codes[i]) & mmerMask;
+        mmerRc = (mmerRc >> 2) | ((kmer_t)(3 - codes[i]) << (2 * (m - 1)));
+        if (i + 1 < (size_t)m) continue;
+        scratch->mmerHash[i + 1 - m] = hashKmer(eb->canonical && mmerRc < mmer ? mmerRc : mmer);
+    }
+    size_t numKmers = length - (size_t)k + 1;
+    size_t head = 0, tail = 0;
+    for (size_t j = 0; j + 1 < (size_t)(k - m + 1); j++) {
+        while (tail > head && scratch->mmerHash[scratch->window[tail - 1]] >= scratch->mmerHash[j]) tail--;
+        scratch->window[tail++] = (uint32_t)j;
+    }
+    for (size_t i = 0; i < numKmers; i++) {
+        size_t j = i + (size_t)(k - m);
+        while (tail > head && scratch->mmerHash[scratch->window[tail - 1]] >= scratch->mmerHash[j]) tail--;
+        scratch->window[tail++] = (uint32_t)j;
+        while (scratch->window[head] < i) head++;
+        scratch->bucket[i] = minimizerBucket(scratch->mmerHash[scratch->window[head]], eb->numBuckets);
+    }
+    size_t start = 0;
+    for (size_t i = 1; i <= numKmers; i++) {
+        if (i < numKmers && scratch->bucket[i] == scratch->bucket[start] &&
+            i - start + (size_t)k <= MAX_SUPER_KMER_BASES) {
+            continue;
+        }
+        // k-mers start..i-1 share a bucket; the bases on either side of the
+        // super-k-mer, where the run has them, are its outer neighbours
+        size_t end = i - 1 + (size_t)k;
+        int predecessor = start > 0 ? codes[start - 1] : -1;
+        int successor = end < length ? codes[end] : -1;
+        appendSuperKmer(&row[scratch->bucket[start]], codes + start, (uint32_t)(end - start), predecessor,
+                        successor);
+        start = i;
+    }
+}
+
+static void* superKmerTask(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    ExternalBuilder* eb = (ExternalBuilder*)task->ctx;
+    SuperKmerScratch* scratch = &eb->scratch[task->id];
+    ByteBuffer* row = &eb->out[(size_t)task->id * eb->numBuckets];
+    size_t begin = eb->numReads * task->id / task->count;
+    size_t end = eb->numReads * (task->id + 1) / task->count;
+    for (size_t r = begin; r < end; r++) {
+        ensureScratch(scratch, eb->reads[r].length);
+        size_t length = 0;
+        for (size_t i = 0; i < eb->reads[r].length; i++) {
+            char c = eb->reads[r].data[i];
+            if (c == '\n' || c == '\r') continue;
+            int code = encodeBase(c);
+            if (code < 0) {
+                emitRun(eb, scratch, row, length);
+                length = 0;
+                continue;
+            }
+            scratch->codes[length++] = (uint8_t)code;
+        }
+        emitRun(eb, scratch, row, length);
+    }
+    return NULL;
+}
+
+// Write out every bucket whose buffered output reached flushBytes (or all
+// of them when force is set), in one sequential write per buffer
+static void flushBuckets(ExternalBuilder* eb, int force) {
+    for (int b = 0; b < eb->numBuckets; b++) {
+        size_t pending = 0;
+        for (int t = 0; t < eb->numThreads; t++) pending += eb->out[(size_t)t * eb->numBuckets + b].size;
+        if (pending == 0 || (!force && pending < eb->flushBytes)) continue;
+        for (int t = 0; t < eb->numThreads; t++) {
+            ByteBuffer* buffer = &eb->out[(size_t)t * eb->numBuckets + b];
+            writeAll(eb->fds[b], buffer->data, buffer->size);
+            eb->bucketBytes[b] += buffer->size;
+            buffer->size = 0;
+        }
+    }
+}
+
+// Pass 2 for one bucket: replay its super-k-mers into partition b,
+// counting every occurrence exactly
+static void countBucket(DeBruijnGraph* graph, int fd, uint64_t size, int b) {
+    if (size == 0) return;
+    uint8_t* data = (uint8_t*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mapping bucket file");
+        exit(EXIT_FAILURE);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    KmerPartition* part = &graph->parts[b];
+    int k = graph->k;
+    kmer_t mask = kmerMask(k);
+    uint64_t pos = 0;
+    while (pos < size) {
+        uint32_t header;
+        memcpy(&header, data + pos, sizeof(header));
+        pos += sizeof(header);
+        uint32_t numBases = header >> 6;
+        const uint8_t* packed = data + pos;
+        kmer_t kmer = 0;
+        int pred = (header & 32) ? (int)((header >> 3) & 3) : -1;
+        for (uint32_t i = 0; i < numBases; i++) {
+            int code = (packed[i >> 2] >> (2 * (i & 3))) & 3;
+            kmer = ((kmer << 2) | (kmer_t)code) & mask;
+            if (i + 1 < (uint32_t)k) continue;
+            int succ;
+            if (i + 1 < numBases) {
+                succ = (packed[(i + 1) >> 2] >> (2 * ((i + 1) & 3))) & 3;
+            } else {
+                succ = (header & 4) ? (int)(header & 3) : -1;
+            }
+            if (graph->canonical) {
+                kmer_t key = canonicalKmer(kmer, k);
+                addNode(part, key, canonicalMask(kmer, key, pred, succ));
+            } else {
+                addNode(part, kmer, succ >= 0 ? (uint8_t)(1u << succ) : 0);
+            }
+            pred = (int)((kmer >> (2 * (k - 1))) & 3);
+        }
+        pos += (numBases + 3) / 4;
+    }
+    munmap(data, size);
+}
+
+// Build the graph for a FASTA/FASTQ file without holding all k-mer
+// occurrences in memory. memoryBudget bounds the per-bucket counting state
+// and picks the number of buckets; temporary files go to tmpDir and are
+// unlinked as soon as they are created. With minCount = 1 the graph has
+// exactly the nodes and edges of the in-memory build; with minCount > 1 the
+// counts are exact (no Bloom false positives). canonical merges the two
+// strands as enableCanonicalKmers does. Returns 0 on success, -1 if the
+// file cannot be read or minCount is not in 1..MAX_MIN_COUNT.
+int buildGraphExternal(DeBruijnGraph* graph, const char* path, int k, int canonical, int numThreads, int minCount,
+                       size_t memoryBudget, const char* tmpDir) {
+    if (minCount < 1 || minCount > MAX_MIN_COUNT) return -1;
+    SeqReader reader;
+    if (openSeqReader(&reader, path) != 0) return -1;
+    struct stat st;
+    uint64_t inputBytes = fstat(reader.fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    if (reader.compressed) inputBytes *= 4;
+
+    // Counting state is dominated by ~40 bytes of hash table and node data
+    // per distinct k-mer, which in error-rich data approaches one per base
+    int numBuckets = 16;
+    while (numBuckets < MAX_BUCKETS && (uint64_t)numBuckets * memoryBudget < inputBytes * 16) numBuckets *= 2;
+
+    ExternalBuilder eb;
+    memset(&eb, 0, sizeof(eb));
+    eb.k = k;
+    eb.m = k < DEFAULT_MINIMIZER_LEN ? k : DEFAULT_MINIMIZER_LEN;
+    eb.canonical = canonical;
+    eb.numBuckets = numBuckets;
+    eb.numThreads = numThreads < 1 ? 1 : numThreads;
+    eb.fds = (int*)xmalloc((size_t)numBuckets * sizeof(int));
+    eb.bucketBytes = (uint64_t*)xcalloc((size_t)numBuckets, sizeof(uint64_t));
+    eb.out = (ByteBuffer*)xcalloc((size_t)eb.numThreads * numBuckets, sizeof(ByteBuffer));
+    eb.scratch = (SuperKmerScratch*)xcalloc((size_t)eb.numThreads, sizeof(SuperKmerScratch));
+    eb.flushBytes = memoryBudget / 4 / (size_t)numBuckets;
+    if (eb.flushBytes > ((size_t)4 << 20)) eb.flushBytes = (size_t)4 << 20;
+    if (eb.flushBytes < ((size_t)64 << 10)) eb.flushBytes = (size_t)64 << 10;
+
+    // mkstemp picks an unused name and creates the file exclusively, so a
+    // file or symlink planted under a guessable name is never opened
+    size_t nameLength = strlen(tmpDir) + 32;
+    char* name = (char*)xmalloc(nameLength);
+    for (int b = 0; b < numBuckets; b++) {
+        snprintf(name, nameLength, "%s/dna_seq.XXXXXX", tmpDir);
+        eb.fds[b] = mkstemp(name);
+        if (eb.fds[b] < 0) {
+            perror(name);
+            exit(EXIT_FAILURE);
+        }
+        unlink(name);
+    }
+    free(name);
+
+    // Pass 1: partition the reads into bucket files
+    SeqView* views = NULL;
+    size_t capacity = 0;
+    const char* text;
+    size_t len;
+    while (nextSeqWindow(&reader, &text, &len)) {
+        eb.numReads = parseSeqWindow(reader.format, text, len, eb.numThreads, &views, &capacity);
+        eb.reads = views;
+        runTasks(superKmerTask, &eb, eb.numThreads);
+        flushBuckets(&eb, 0);
+    }
+    flushBuckets(&eb, 1);
+    free(views);
+    closeSeqReader(&reader);
+    for (int i = 0; i < eb.numThreads * numBuckets; i++) free(eb.out[i].data);
+    free(eb.out);
+    for (int t = 0; t < eb.numThreads; t++) {
+        free(eb.scratch[t].codes);
+        free(eb.scratch[t].mmerHash);
+        free(eb.scratch[t].window);
+        free(eb.scratch[t].bucket);
+    }
+    free(eb.scratch);
+
+    // Pass 2: one bucket at a time, each into its own partition
+    initGraph(graph, k, numBuckets, (size_t)numBuckets * 16);
+    graph->minimizerLen = eb.m;
+    graph->canonical = canonical;
+    for (int b = 0; b < numBuckets; b++) {
+        KmerPartition* part = &graph->parts[b];
+        if (minCount > 1) part->counts = (uint8_t*)xcalloc(part->capacity, 1);
+        countBucket(graph, eb.fds[b], eb.bucketBytes[b], b);
+        close(eb.fds[b]);
+        if (minCount > 1) prunePartition(part, minCount);
+        // Trim the node arrays to size; they are copied out when joining
+        part->kmers = (kmer_t*)xrealloc(part->kmers, ((size_t)part->numNodes + 1) * sizeof(kmer_t));
+        part->outMask = (uint8_t*)xrealloc(part->outMask, (size_t)part->numNodes + 1);
+        part->capacity = part->numNodes + 1;
+    }
+    free(eb.fds);
+    free(eb.bucketBytes);
+    joinPartitions(graph);
+    buildAdjacency(graph, eb.numThreads, minCount > 1);
+    return 0;
+}
+
+// Build the graph for a FASTA/FASTQ file, parsing and counting one window
+// at a time. With minCount > 1, k-mers seen fewer times are filtered out
+// through a Bloom filter of bloomBytes (0 picks a size from the file size).
+// Returns 0 on success, -1 if the file cannot be read or minCount is not
+// in 1..MAX_MIN_COUNT.
+int buildGraphFromFile(DeBruijnGraph* graph, const char* path, int k, int canonical, int numThreads, int minCount,
+                       size_t bloomBytes) {
+    if (minCount < 1 || minCount > MAX_MIN_COUNT) return -1;
+    SeqReader reader;
+    if (openSeqReader(&reader, path) != 0) return -1;
+    GraphBuilder builder;
+    beginGraphBuild(&builder, graph, k, numThreads, (size_t)1 << 20);
+    if (canonical) enableCanonicalKmers(&builder);
+    if (minCount > 1) {
+        if (bloomBytes == 0) {
+            // About 40 bits per distinct k-mer for FASTQ at a 1% error rate,
+            // shared by the k-mers and the neighbours of their first occurrences
+            struct stat st;
+            bloomBytes = fstat(reader.fd, &st) == 0 ? (size_t)st.st_size / 2 : 0;
+            if (reader.compressed) bloomBytes *= 4;
+            if (bloomBytes < ((size_t)1 << 20)) bloomBytes = (size_t)1 << 20;
+        }
+        enableKmerFilter(&builder, minCount, bloomBytes);
+    }
+    SeqView* views = NULL;
+    size_t capacity = 0;
+    const char* text;
+    size_t len;
+    while (nextSeqWindow(&reader, &text, &len)) {
+        size_t n = parseSeqWindow(reader.format, text, len, builder.numThreads, &views, &capacity);
+        addReadsToGraph(&builder, views, n);
+    }
+    free(views);
+    closeSeqReader(&reader);
+    finishGraphBuild(&builder);
+    return 0;
+}
+
+// Check that two graphs have the same nodes and the same edges, whatever
+// their partitioning and node numbering
+int sameGraph(const DeBruijnGraph* a, const DeBruijnGraph* b) {
+    if (a->canonical != b->canonical || a->numNodes != b->numNodes || a->numEdges != b->numEdges) return 0;
+    for (uint32_t u = 0; u < numVertices(a); u++) {
+        uint32_t v = findVertex(b, vertexKmer(a, u));
+        if (v == UINT32_MAX || vertexSuccessors(a, u) != vertexSuccessors(b, v)) return 0;
+        if (a->offsets[u + 1] - a->offsets[u] != b->offsets[v + 1] - b->offsets[v]) return 0;
+        for (uint64_t e = a->offsets[u], f = b->offsets[v]; e < a->offsets[u + 1]; e++, f++) {
+            if (vertexKmer(a, a->targets[e]) != vertexKmer(b, b->targets[f])) return 0;
+        }
+    }
+    return 1;
+}
+
+#ifndef DNA_SEQ_NO_MAIN
+// Demo and benchmarks. Build with -DDNA_SEQ_NO_MAIN to link the assembler
+// into another program, such as dna_seq_test.c.
+
+static double elapsedSeconds(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// Bytes held by the finished graph (hash tables, node arrays and CSR)
+static size_t graphBytes(const DeBruijnGraph* graph) {
+    size_t bytes = ((size_t)graph->numNodes + 1) * (sizeof(kmer_t) + 1) +
+                   ((size_t)numVertices(graph) + 1) * sizeof(uint64_t) + graph->numEdges * sizeof(uint32_t);
+    for (int p = 0; p < graph->numParts; p++) {
+        bytes += graph->parts[p].table.capacity * (sizeof(kmer_t) + sizeof(uint32_t));
+    }
+    return bytes;
+}
+
+static size_t unitigBytes(const UnitigGraph* unitigs) {
+    return ((size_t)unitigs->numUnitigs + 1 + numOrientedUnitigs(unitigs) + 1) * sizeof(uint64_t) +
+           (size_t)((unitigs->seqStart[unitigs->numUnitigs] + 31) / 32) * sizeof(uint64_t) +
+           unitigs->numEdges * sizeof(uint32_t);
+}
+
+// Current and peak resident set size in MB
+static double currentRssMB(void) {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL) {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(statm);
+    }
+    return (double)resident * (double)sysconf(_SC_PAGESIZE) / 1e6;
+}
+
+static double peakRssMB(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)usage.ru_maxrss / 1e3;
+}
+
+// Random genome for the synthetic benchmarks (seeded, so reproducible)
+static char* randomGenome(size_t length) {
+    srand(42);
+    char* genome = (char*)xmalloc(length + 1);
+    for (size_t i = 0; i < length; i++) genome[i] = decodeBase(rand());
+    genome[length] = '\0';
+    return genome;
+}
+
+static size_t randomReadStart(size_t genomeLength, int readLength) {
+    return (((size_t)rand() << 31) ^ (size_t)rand()) % (genomeLength - readLength);
+}
+
+// Copy random segments of the genome over other positions so the graph
+// gets the branching that repeats cause in real genomes
+static void addRepeats(char* genome, size_t genomeLength, int count, int repeatLength) {
+    for (int i = 0; i < count; i++) {
+        size_t from = randomReadStart(genomeLength, repeatLength);
+        size_t to = randomReadStart(genomeLength, repeatLength);
+        memmove(genome + to, genome + from, (size_t)repeatLength);
+    }
+}
+
+// Substitute each base with a different one with probability errorRate
+static void addSequencingErrors(char* read, int length, double errorRate) {
+    if (errorRate <= 0) return;
+    for (int i = 0; i < length; i++) {
+        if (rand() < errorRate * ((double)RAND_MAX + 1.0)) {
+            read[i] = decodeBase(encodeBase(read[i]) + 1 + rand() % 3);
+        }
+    }
+}
+
+// Sample numReads reads from a genome into one contiguous buffer, returned
+// through *storage; the read pointers are returned
+static const char** makeSyntheticReads(const char* genome, size_t genomeLength, int numReads, int readLength,
+                                       double errorRate, char** storage) {
+    *storage = (char*)xmalloc((size_t)numReads * (readLength + 1));
+    const char** reads = (const char**)xmalloc((size_t)numReads * sizeof(char*));
+    for (int i = 0; i < numReads; i++) {
+        size_t pos = randomReadStart(genomeLength, readLength);
+        char* read = *storage + (size_t)i * (readLength + 1);
+        memcpy(read, genome + pos, readLength);
+        read[readLength] = '\0';
+        addSequencingErrors(read, readLength, errorRate);
+        reads[i] = read;
+    }
+    return reads;
+}
+
+// Write synthetic reads sampled from a random genome as FASTQ
+static int writeSyntheticReads(const char* path, long long numReads, int readLength, size_t genomeLength,
+                               double errorRate) {
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return -1;
+    }
+    char* genome = randomGenome(genomeLength);
+    char* quality = (char*)xmalloc((size_t)readLength);
+    char* read = (char*)xmalloc((size_t)readLength);
+    memset(quality, 'I', (size_t)readLength);
+    for (long long i = 0; i < numReads; i++) {
+        size_t pos = randomReadStart(genomeLength, readLength);
+        memcpy(read, genome + pos, (size_t)readLength);
+        addSequencingErrors(read, readLength, errorRate);
+        fprintf(out, "@read%lld pos=%zu\n", i, pos);
+        fwrite(read, 1, (size_t)readLength, out);
+        fputs("\n+\n", out);
+        fwrite(quality, 1, (size_t)readLength, out);
+        fputc('\n', out);
+    }
+    free(read);
+    free(quality);
+    free(genome);
+    if (fclose(out) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// Benchmark: parse throughput of the reader alone (records are parsed into
+// views and their bases counted, nothing else). Run twice to compare a
+// cold and a warm page cache.
+static int benchmarkParse(const char* path, int numThreads) {
+    SeqReader reader;
+    if (openSeqReader(&reader, path) != 0) return -1;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SeqView* views = NULL;
+    size_t capacity = 0, records = 0, bytes = 0, bases = 0;
+    const char* text;
+    size_t len;
+    while (nextSeqWindow(&reader, &text, &len)) {
+        size_t n = parseSeqWindow(reader.format, text, len, numThreads, &views, &capacity);
+        for (size_t i = 0; i < n; i++) bases += views[i].length;
+        records += n;
+        bytes += len;
+    }
+    double seconds = elapsedSeconds(&start);
+    free(views);
+    closeSeqReader(&reader);
+    printf("Parsed %s with %d threads: %zu records, %zu bases, %zu bytes, %.3f s, %.2f GB/s (%.1f M records/s)\n",
+           reader.format == FORMAT_FASTA ? "FASTA" : "FASTQ", numThreads, records, bases, bytes, seconds,
+           (double)bytes / seconds / 1e9, (double)records / seconds / 1e6);
+    return 0;
+}
+
+// Benchmark: graph build from a file with 1, 2, 4, ... maxThreads workers
+static int benchmarkFileBuild(const char* path, int k, int maxThreads) {
+    printf("Graph build from %s, k=%d\n", path, k);
+    double baseline = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        DeBruijnGraph graph;
+        if (buildGraphFromFile(&graph, path, k, 0, threads, 1, 0) != 0) return -1;
+        double seconds = elapsedSeconds(&start);
+        if (threads == 1) baseline = seconds;
+        printf("  %2d threads: nodes %u, edges %llu, %.2f s, %.2fx\n", threads, graph.numNodes,
+               (unsigned long long)graph.numEdges, seconds, baseline / seconds);
+        freeGraph(&graph);
+    }
+    return 0;
+}
+
+// Assemble a read file: build the graph, walk it and write the sequence as
+// FASTA to stdout; statistics go to stderr
+static int assembleFile(const char* path, int k, int canonical, int numThreads, int compact, int minCount,
+                        size_t bloomBytes, size_t memoryBudget, const char* tmpDir) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    DeBruijnGraph graph;
+    int status = memoryBudget > 0
+                     ? buildGraphExternal(&graph, path, k, canonical, numThreads, minCount, memoryBudget, tmpDir)
+                     : buildGraphFromFile(&graph, path, k, canonical, numThreads, minCount, bloomBytes);
+    if (status != 0) return -1;
+    fprintf(stderr, "Graph: %u nodes, %llu edges, built in %.2f s with %d threads\n", graph.numNodes,
+            (unsigned long long)graph.numEdges, elapsedSeconds(&start), numThreads);
+    char* sequence;
+    uint32_t trails = 0;
+    if (compact) {
+        UnitigGraph unitigs;
+        compactGraph(&graph, &unitigs);
+        freeGraph(&graph);
+        fprintf(stderr, "Compacted: %u unitigs, %llu links\n", unitigs.numUnitigs,
+                (unsigned long long)unitigs.numEdges);
+        sequence = eulerianWalkUnitigs(&unitigs, &trails);
+        freeUnitigGraph(&unitigs);
+    } else {
+        sequence = eulerianWalk(&graph, NULL, &trails);
+        freeGraph(&graph);
+    }
+    if (sequence == NULL) return 0;
+    if (trails == 1) {
+        printf(">euler_path length=%zu\n%s\n", strlen(sequence), sequence);
+    } else {
+        // No Eulerian path: one record per trail
+        fprintf(stderr, "No Eulerian path; the walk broke into %u trails\n", trails);
+        uint32_t t = 0;
+        for (char* trail = strtok(sequence, "\n"); trail != NULL; trail = strtok(NULL, "\n")) {
+            printf(">euler_trail_%u length=%zu\n%s\n", ++t, strlen(trail), trail);
+        }
+    }
+    free(sequence);
+    return 0;
+}
+
+// Benchmark: external build under a memory budget against the in-memory
+// build. The external build runs first so each peak RSS reading is its own.
+static int benchmarkExternal(const char* path, int k, int canonical, size_t memoryBudget, int numThreads,
+                             const char* tmpDir) {
+    printf("External build of %s, k=%d%s, budget %zu MB, %d threads\n", path, k, canonical ? " (canonical)" : "",
+           memoryBudget >> 20, numThreads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    DeBruijnGraph external;
+    if (buildGraphExternal(&external, path, k, canonical, numThreads, 1, memoryBudget, tmpDir) != 0) return -1;
+    printf("  external:  %u nodes, %llu edges, %d buckets, %.2f s, peak RSS %.0f MB (graph %.0f MB)\n",
+           external.numNodes, (unsigned long long)external.numEdges, external.numParts, elapsedSeconds(&start),
+           peakRssMB(), graphBytes(&external) / 1048576.0);
+    DeBruijnGraph inMemory;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (buildGraphFromFile(&inMemory, path, k, canonical, numThreads, 1, 0) != 0) return -1;
+    printf("  in-memory: %u nodes, %llu edges, %.2f s, peak RSS %.0f MB\n", inMemory.numNodes,
+           (unsigned long long)inMemory.numEdges, elapsedSeconds(&start), peakRssMB());
+    int same = sameGraph(&external, &inMemory);
+    printf("  graphs %s\n", same ? "identical" : "DIFFER");
+    freeGraph(&external);
+    freeGraph(&inMemory);
+    return same ? 0 : -1;
+}
+
+// Benchmark: sample reads uniformly from a random genome and time the
+// graph build with 1, 2, 4, ... maxThreads workers. Reads live in one
+// contiguous buffer to keep setup cheap.
+static void benchmarkGraphBuild(int numReads, int readLength, int k, size_t genomeLength, int maxThreads) {
+    char* genome = randomGenome(genomeLength);
+    char* storage;
+    const char** reads = makeSyntheticReads(genome, genomeLength, numReads, readLength, 0, &storage);
+
+    printf("Graph build: %d reads x %d bp, k=%d, genome %zu bp\n", numReads, readLength, k, genomeLength);
+    double baseline = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        DeBruijnGraph graph;
+        constructDeBruijnGraph(&graph, reads, numReads, k, threads);
+        double seconds = elapsedSeconds(&start);
+        if (threads == 1) baseline = seconds;
+
+        printf("  %2d threads: nodes %u, edges %llu, %.2f s, %.1f M k-mers/s, %.2fx, %.1f MB graph\n",
+               threads, graph.numNodes, (unsigned long long)graph.numEdges, seconds,
+               (double)numReads * (readLength - k + 1) / seconds / 1e6, baseline / seconds,
+               (double)graphBytes(&graph) / 1e6);
+        freeGraph(&graph);
+    }
+
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// Benchmark: graph build over reads with substitution errors, unfiltered
+// and with the Bloom prefilter keeping k-mers seen at least twice. The
+// filter is sized for ~16 bits per expected distinct k-mer, its own and
+// those of its first occurrence's neighbours.
+static void benchmarkFilter(int numReads, int readLength, int k, size_t genomeLength, double errorRate,
+                            int numThreads) {
+    char* genome = randomGenome(genomeLength);
+    char* storage;
+    const char** reads = makeSyntheticReads(genome, genomeLength, numReads, readLength, errorRate, &storage);
+    free(genome);
+    SeqView* views = (SeqView*)xmalloc((size_t)numReads * sizeof(SeqView));
+    for (int i = 0; i < numReads; i++) {
+        views[i].data = reads[i];
+        views[i].length = (size_t)readLength;
+    }
+    double expectedKmers = (double)genomeLength + (double)numReads * readLength * errorRate * k;
+    size_t bloomBytes = (size_t)(expectedKmers * 16 / 8);
+
+    printf("K-mer filter: %d reads x %d bp, k=%d, genome %zu bp, %.2f%% errors, %d threads\n", numReads,
+           readLength, k, genomeLength, errorRate * 100, numThreads);
+    for (int minCount = 1; minCount <= 2; minCount++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        DeBruijnGraph graph;
+        GraphBuilder builder;
+        beginGraphBuild(&builder, &graph, k, numThreads, (size_t)numReads);
+        if (minCount > 1) enableKmerFilter(&builder, minCount, bloomBytes);
+        addReadsToGraph(&builder, views, (size_t)numReads);
+        finishGraphBuild(&builder);
+        double seconds = elapsedSeconds(&start);
+        printf("  %-14s nodes %10u  edges %10llu  graph %8.1f MB  bloom %7.1f MB  %.2f s\n",
+               minCount > 1 ? "min count 2:" : "unfiltered:", graph.numNodes, (unsigned long long)graph.numEdges,
+               (double)graphBytes(&graph) / 1e6, minCount > 1 ? (double)bloomBytes / 1e6 : 0.0, seconds);
+        freeGraph(&graph);
+    }
+    free(views);
+    free(reads);
+    free(storage);
+}
+
+// Reverse-complement a read in place
+static void reverseComplementRead(char* read, int length) {
+    for (int i = 0, j = length - 1; i <= j; i++, j--) {
+        char a = decodeBase(3 - encodeBase(read[j]));
+        read[j] = decodeBase(3 - encodeBase(read[i]));
+        read[i] = a;
+    }
+}
+
+// Benchmark: reads drawn from both strands, assembled strand-specifically
+// and with canonical k-mers. Reports graph size and the unitig (contig)
+// count and length of each.
+static void benchmarkCanonical(int numReads, int readLength, int k, size_t genomeLength, double errorRate,
+                               int numThreads) {
+    char* genome = randomGenome(genomeLength);
+    char* storage;
+    const char** reads = makeSyntheticReads(genome, genomeLength, numReads, readLength, errorRate, &storage);
+    free(genome);
+    SeqView* views = (SeqView*)xmalloc((size_t)numReads * sizeof(SeqView));
+    for (int i = 0; i < numReads; i++) {
+        if (rand() & 1) reverseComplementRead((char*)reads[i], readLength);
+        views[i].data = reads[i];
+        views[i].length = (size_t)readLength;
+    }
+
+    printf("Strands: %d reads x %d bp from both strands, k=%d, genome %zu bp, %.2f%% errors, %d threads\n",
+           numReads, readLength, k, genomeLength, errorRate * 100, numThreads);
+    for (int canonical = 0; canonical <= 1; canonical++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        DeBruijnGraph graph;
+        GraphBuilder builder;
+        beginGraphBuild(&builder, &graph, k, numThreads, (size_t)numReads);
+        if (canonical) enableCanonicalKmers(&builder);
+        addReadsToGraph(&builder, views, (size_t)numReads);
+        finishGraphBuild(&builder);
+        double seconds = elapsedSeconds(&start);
+        size_t tableBytes = 0;
+        for (int p = 0; p < graph.numParts; p++) {
+            tableBytes += graph.parts[p].table.capacity * (sizeof(kmer_t) + sizeof(uint32_t));
+        }
+        UnitigGraph unitigs;
+        compactGraph(&graph, &unitigs);
+        uint64_t longest = 0;
+        for (uint32_t u = 0; u < unitigs.numUnitigs; u++) {
+            uint64_t length = unitigs.seqStart[u + 1] - unitigs.seqStart[u];
+            if (length > longest) longest = length;
+        }
+        printf("  %-16s nodes %9u  edges %9llu  table %6.1f MB  graph %6.1f MB  unitigs %8u  longest %8llu bp"
+               "  %.2f s\n",
+               canonical ? "canonical:" : "strand-specific:", graph.numNodes, (unsigned long long)graph.numEdges,
+               (double)tableBytes / 1e6, (double)graphBytes(&graph) / 1e6, unitigs.numUnitigs,
+               (unsigned long long)longest, seconds);
+        freeUnitigGraph(&unitigs);
+        freeGraph(&graph);
+    }
+    free(views);
+    free(reads);
+    free(storage);
+}
+
+// Benchmark: node-level graph against its compacted form. Reads tile a
+// random genome with repeats; the walk, node count and memory are reported
+// before and after compaction (the node-level graph is freed in between).
+static void benchmarkCompaction(int numReads, int readLength, int k, size_t genomeLength, int numThreads) {
+    char* genome = randomGenome(genomeLength);
+    addRepeats(genome, genomeLength, (int)(genomeLength / 10000), 1000);
+    char* storage;
+    const char** reads = makeSyntheticReads(genome, genomeLength, numReads, readLength, 0, &storage);
+    DeBruijnGraph graph;
+    constructDeBruijnGraph(&graph, reads, numReads, k, numThreads);
+    free(reads);
+    free(storage);
+    free(genome);
+
+    printf("Compaction: %d reads x %d bp, k=%d, genome %zu bp with repeats\n", numReads, readLength, k, genomeLength);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char* sequence = eulerianWalk(&graph, NULL, NULL);
+    double walkSeconds = elapsedSeconds(&start);
+    size_t nodeLength = sequence ? strlen(sequence) : 0;
+    free(sequence);
+    printf("  k-mer graph: %10u nodes %10llu edges %8.1f MB  walk %.3f s (%zu bp)  RSS %.1f MB\n", graph.numNodes,
+           (unsigned long long)graph.numEdges, (double)graphBytes(&graph) / 1e6, walkSeconds, nodeLength,
+           currentRssMB());
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    UnitigGraph unitigs;
+    compactGraph(&graph, &unitigs);
+    double compactSeconds = elapsedSeconds(&start);
+    double peakBuilt = peakRssMB();
+    freeGraph(&graph);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sequence = eulerianWalkUnitigs(&unitigs, NULL);
+    walkSeconds = elapsedSeconds(&start);
+    size_t unitigLength = sequence ? strlen(sequence) : 0;
+    free(sequence);
+    printf("  unitigs:     %10u nodes %10llu edges %8.1f MB  walk %.3f s (%zu bp)  RSS %.1f MB\n",
+           unitigs.numUnitigs, (unsigned long long)unitigs.numEdges, (double)unitigBytes(&unitigs) / 1e6,
+           walkSeconds, unitigLength, currentRssMB());
+    printf("  compaction %.3f s, peak RSS %.1f MB (reached while both graphs were alive)\n", compactSeconds, peakBuilt);
+    freeUnitigGraph(&unitigs);
+}
+
+// Benchmark: Hierholzer on the complete de Bruijn graph of order k, which
+// has 4^k nodes, 4^(k+1) edges and an Eulerian circuit whose spelling is a
+// de Bruijn sequence. The graph is laid out directly (node ID = k-mer) so
+// only the walk is timed. Work per edge is constant; time per edge also
+// reflects cache misses, since successor IDs are scattered.
+static void benchmarkEulerianWalk(uint64_t maxEdges) {
+    printf("Eulerian walk on complete de Bruijn graphs:\n");
+    for (int k = 6; k < MAX_K && ((uint64_t)4 << (2 * k)) <= maxEdges; k++) {
+        DeBruijnGraph graph;
+        memset(&graph, 0, sizeof(graph));
+        graph.k = k;
+        graph.numNodes = (uint32_t)1 << (2 * k);
+        graph.numEdges = (uint64_t)graph.numNodes * 4;
+        graph.kmers = (kmer_t*)xmalloc((size_t)graph.numNodes * sizeof(kmer_t));
+        graph.offsets = (uint64_t*)xmalloc(((size_t)graph.numNodes + 1) * sizeof(uint64_t));
+        graph.targets = (uint32_t*)xmalloc(graph.numEdges * sizeof(uint32_t));
+        uint32_t mask = graph.numNodes - 1;
+        for (uint32_t v = 0; v < graph.numNodes; v++) {
+            graph.kmers[v] = v;
+            graph.offsets[v] = (uint64_t)v * 4;
+            for (uint32_t b = 0; b < 4; b++) graph.targets[(uint64_t)v * 4 + b] = ((v << 2) | b) & mask;
+        }
+        graph.offsets[graph.numNodes] = graph.numEdges;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        char* sequence = eulerianWalk(&graph, NULL, NULL);
+        double seconds = elapsedSeconds(&start);
+        size_t length = strlen(sequence);
+        printf("  k=%2d  edges %11llu  %8.3f s  %6.2f ns/edge  %s\n", k,
+               (unsigned long long)graph.numEdges, seconds, seconds * 1e9 / (double)graph.numEdges,
+               length == graph.numEdges + (uint64_t)k ? "all edges used" : "INCOMPLETE");
+        free(sequence);
+        freeGraph(&graph);
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: dna_seq                                  run the built-in example\n"
+            "       dna_seq [-k K] [-t threads] [-C] [-c] [-m minCount] [-B bloomMB] [-M budgetMB [-T tmpdir]]\n"
+            "               reads.{fa,fq}[.gz]\n"
+            "           -C: canonical k-mers, merging both strands; -c: walk the compacted graph\n"
+            "           -m: drop k-mers seen fewer times (1..255)\n"
+            "           -M: count k-mers out of core in minimizer buckets under tmpdir\n"
+            "       dna_seq --write-reads out.fq reads readLength genomeLength [errorRate]\n"
+            "       dna_seq --bench-parse reads.fq [threads]\n"
+            "       dna_seq --bench-file reads.fq [k] [maxThreads]\n"
+            "       dna_seq --bench-external reads.fq [k] [budgetMB] [threads] [-C]\n"
+            "       dna_seq --bench [reads] [readLength] [k] [genomeLength] [maxThreads]\n"
+            "       dna_seq --bench-walk [maxEdges]\n"
+            "       dna_seq --bench-compact [reads] [readLength] [k] [genomeLength] [threads]\n"
+            "       dna_seq --bench-filter [reads] [readLength] [k] [genomeLength] [errorRate] [threads]\n"
+            "       dna_seq --bench-canonical [reads] [readLength] [k] [genomeLength] [errorRate] [threads]\n");
+}
+
+int main(int argc, char* argv[]) {
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        int numReads = argc > 2 ? atoi(argv[2]) : 10000000;
+        int readLength = argc > 3 ? atoi(argv[3]) : 100;
+        int k = argc > 4 ? atoi(argv[4]) : 31;
+        size_t genomeLength = argc > 5 ? strtoull(argv[5], NULL, 10) : 10000000;
+        int maxThreads = argc > 6 ? atoi(argv[6]) : cores;
+        if (k < 1 || k > MAX_K || readLength <= k || genomeLength <= (size_t)readLength || maxThreads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        benchmarkGraphBuild(numReads, readLength, k, genomeLength, maxThreads);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-walk") == 0) {
+        benchmarkEulerianWalk(argc > 2 ? strtoull(argv[2], NULL, 10) : 100000000);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-compact") == 0) {
+        int numReads = argc > 2 ? atoi(argv[2]) : 1000000;
+        int readLength = argc > 3 ? atoi(argv[3]) : 100;
+        int k = argc > 4 ? atoi(argv[4]) : 31;
+        size_t genomeLength = argc > 5 ? strtoull(argv[5], NULL, 10) : 5000000;
+        int threads = argc > 6 ? atoi(argv[6]) : cores;
+        if (k < 1 || k > MAX_K || readLength <= k || genomeLength <= 1000 || threads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        benchmarkCompaction(numReads, readLength, k, genomeLength, threads);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-filter") == 0) {
+        int numReads = argc > 2 ? atoi(argv[2]) : 1000000;
+        int readLength = argc > 3 ? atoi(argv[3]) : 100;
+        int k = argc > 4 ? atoi(argv[4]) : 31;
+        size_t genomeLength = argc > 5 ? strtoull(argv[5], NULL, 10) : 5000000;
+        double errorRate = argc > 6 ? atof(argv[6]) : 0.01;
+        int threads = argc > 7 ? atoi(argv[7]) : cores;
+        if (k < 1 || k > MAX_K || readLength <= k || genomeLength <= (size_t)readLength || threads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        benchmarkFilter(numReads, readLength, k, genomeLength, errorRate, threads);
+        return 0;
+    }
+    if (argc >= 6 && strcmp(argv[1], "--write-reads") == 0) {
+        int readLength = atoi(argv[4]);
+        size_t genomeLength = strtoull(argv[5], NULL, 10);
+        if (readLength < 1 || genomeLength <= (size_t)readLength) {
+            fprintf(stderr, "Genome must be longer than the reads\n");
+            return 1;
+        }
+        double errorRate = argc > 6 ? atof(argv[6]) : 0;
+        return writeSyntheticReads(argv[2], atoll(argv[3]), readLength, genomeLength, errorRate) == 0 ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--bench-parse") == 0) {
+        int threads = argc > 3 ? atoi(argv[3]) : cores;
+        return benchmarkParse(argv[2], threads < 1 ? 1 : threads) == 0 ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--bench-file") == 0) {
+        int k = argc > 3 ? atoi(argv[3]) : 31;
+        int maxThreads = argc > 4 ? atoi(argv[4]) : cores;
+        if (k < 1 || k > MAX_K || maxThreads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        return benchmarkFileBuild(argv[2], k, maxThreads) == 0 ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--bench-external") == 0) {
+        int k = argc > 3 ? atoi(argv[3]) : 31;
+        size_t budget = (argc > 4 ? strtoull(argv[4], NULL, 10) : 256) << 20;
+        int threads = argc > 5 ? atoi(argv[5]) : cores;
+        const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+        if (k < 1 || k > MAX_K || budget == 0 || threads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        int canonical = argc > 6 && strcmp(argv[6], "-C") == 0;
+        return benchmarkExternal(argv[2], k, canonical, budget, threads, tmpDir) == 0 ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-canonical") == 0) {
+        int numReads = argc > 2 ? atoi(argv[2]) : 1000000;
+        int readLength = argc > 3 ? atoi(argv[3]) : 100;
+        int k = argc > 4 ? atoi(argv[4]) : 31;
+        size_t genomeLength = argc > 5 ? strtoull(argv[5], NULL, 10) : 5000000;
+        double errorRate = argc > 6 ? atof(argv[6]) : 0;
+        int threads = argc > 7 ? atoi(argv[7]) : cores;
+        if (k < 1 || k > MAX_K || readLength <= k || genomeLength <= (size_t)readLength || threads < 1) {
+            fprintf(stderr, "Invalid benchmark parameters (k must be 1..%d)\n", MAX_K);
+            return 1;
+        }
+        benchmarkCanonical(numReads, readLength, k, genomeLength, errorRate, threads);
+        return 0;
+    }
+    if (argc >= 2) {
+        int k = 31, threads = cores, canonical = 0, compact = 0, minCount = 1;
+        size_t bloomBytes = 0, memoryBudget = 0;
+        const char* path = NULL;
+        const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+                k = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+                threads = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+                minCount = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+                bloomBytes = strtoull(argv[++i], NULL, 10) << 20;
+            } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+                memoryBudget = strtoull(argv[++i], NULL, 10) << 20;
+            } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+                tmpDir = argv[++i];
+            } else if (strcmp(argv[i], "-c") == 0) {
+                compact = 1;
+            } else if (strcmp(argv[i], "-C") == 0) {
+                canonical = 1;
+            } else if (argv[i][0] != '-' && path == NULL) {
+                path = argv[i];
+            } else {
+                usage();
+                return 1;
+            }
+        }
+        if (path == NULL || k < 1 || k > MAX_K || threads < 1) {
+            usage();
+            return 1;
+        }
+        if (minCount < 1 || minCount > MAX_MIN_COUNT) {
+            fprintf(stderr, "Invalid minCount %d (must be 1..%d)\n", minCount, MAX_MIN_COUNT);
+            usage();
+            return 1;
+        }
+        return assembleFile(path, k, canonical, threads, compact, minCount, bloomBytes, memoryBudget, tmpDir) == 0 ? 0 : 1;
+    }
+
     // Example reads (fragments of DNA)
     const char* reads[] = {
         "ATGGCGTGCA",
@@ -75,20 +2349,22 @@ int main() {
         "ATCCAGCGTA"
     };
     int numReads = sizeof(reads) / sizeof(reads[0]);
-    int k = 3; // k-mer size
-
-    // Initialize the de Bruijn graph
-    Node* graph[26] = {NULL}; // Simple hash table for A-Z
+    // k-mer size: every 5-mer of the reads' sequence occurs once, so the
+    // graph is one path; at k = 3 repeats such as ATG leave it unbalanced
+    int k = 5;
 
     // Construct the de Bruijn graph
-    constructDeBruijnGraph(graph, reads, numReads, k);
+    DeBruijnGraph graph;
+    constructDeBruijnGraph(&graph, reads, numReads, k, 1);
 
     // Reconstruct the DNA sequence using an Eulerian walk
-    char sequence[MAX_READ_LENGTH * MAX_READS] = "";
-    eulerianWalk(graph, sequence, "ATG"); // Start with the first k-mer
+    char* sequence = eulerianWalk(&graph, "ATGGC", NULL); // Start with the first k-mer
 
     // Print the reconstructed sequence
-    printf("Reconstructed DNA Sequence: %s\n", sequence);
+    printf("Reconstructed DNA Sequence: %s\n", sequence ? sequence : "(start k-mer not found)");
 
+    free(sequence);
+    freeGraph(&graph);
     return 0;
 }
+#endif
@@ -0,0 +1,158 @@
+#ifndef DNA_SEQ_H
+#define DNA_SEQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// K-mers are packed two bits per base (A=0, C=1, G=2, T=3) into a single
+// machine word. Build with -DKMER_WIDE to use 128-bit words for k up to 64.
+#ifdef KMER_WIDE
+typedef unsigned __int128 kmer_t;
+#define MAX_K 64
+#else
+typedef uint64_t kmer_t;
+#define MAX_K 32
+#endif
+
+// Occurrence counts are 8 bits and saturate, so a minimum count above this
+// could never be met
+#define MAX_MIN_COUNT UINT8_MAX
+
+// Open-addressing hash table from packed k-mer to node ID
+typedef struct KmerTable {
+    kmer_t* keys;
+    uint32_t* ids;      // node ID + 1, 0 marks an empty slot
+    size_t capacity;    // always a power of two
+    size_t size;
+} KmerTable;
+
+// One hash partition of the node set. Each partition is filled by a single
+// thread, so no locking is needed; IDs are local until partitions are joined.
+typedef struct KmerPartition {
+    KmerTable table;
+    kmer_t* kmers;      // local node ID -> packed k-mer (counting only)
+    uint8_t* outMask;   // local node ID -> successor bases (counting only)
+    uint8_t* counts;    // local node ID -> occurrences, saturating (filtered builds only)
+    uint32_t numNodes;
+    uint32_t capacity;
+} KmerPartition;
+
+// Structure to represent the de Bruijn graph: one node per distinct k-mer,
+// one edge per distinct (k+1)-mer, adjacency stored in CSR form
+typedef struct DeBruijnGraph {
+    int k;
+    int numParts;
+    int minimizerLen;   // 0: partition by k-mer hash; else by minimizer bucket
+    int canonical;      // nodes are canonical k-mers (see numVertices)
+    KmerPartition* parts;
+    uint32_t* partBase; // global ID of each partition's first node
+    kmer_t* kmers;      // node ID -> packed k-mer
+    uint8_t* outMask;   // successor bases seen for each node (bit b = base b);
+                        // canonical graphs use bits 4-7 for the reverse strand
+    uint32_t numNodes;
+    uint64_t* offsets;  // CSR row offsets, numVertices + 1 entries
+    uint32_t* targets;  // CSR column indices (vertex IDs), numEdges entries
+    uint64_t numEdges;
+} DeBruijnGraph;
+
+// A read as a zero-copy view into the input text. FASTA sequences may span
+// several lines, so the k-mer stage skips embedded line breaks.
+typedef struct SeqView {
+    const char* data;
+    size_t length;
+} SeqView;
+
+typedef struct BloomFilter BloomFilter;
+typedef struct RecordBucket RecordBucket;
+
+// Incremental graph construction state. Buckets form a numThreads x
+// numParts matrix: row t is written only by worker t during extraction and
+// column p is read only by worker p during merging, so neither phase takes
+// a lock.
+typedef struct GraphBuilder {
+    DeBruijnGraph* graph;
+    const SeqView* reads;
+    size_t batchBegin;
+    size_t batchEnd;
+    int numThreads;
+    RecordBucket* buckets;
+    int minCount;           // keep k-mers seen at least this often (filtered builds)
+    BloomFilter* blooms;    // one per partition, absorbs first occurrences
+} GraphBuilder;
+
+// Compacted de Bruijn graph: every maximal non-branching path becomes one
+// unitig whose bases are stored packed 2 bits per base, 32 to a word.
+// Links join a unitig's last k-mer to the first k-mer of its successors.
+// Compacting a canonical graph stores each unitig once and links oriented
+// unitigs: 2u reads unitig u as stored, 2u + 1 its reverse complement.
+typedef struct UnitigGraph {
+    int k;
+    int canonical;
+    uint32_t numUnitigs;
+    uint64_t* seqStart;     // base offset of each unitig, numUnitigs + 1 entries
+    uint64_t* bases;        // packed sequence of all unitigs back to back
+    uint64_t* offsets;      // CSR row offsets over links, one row per oriented unitig
+    uint32_t* targets;
+    uint64_t numEdges;
+} UnitigGraph;
+
+typedef enum SeqFormat {
+    FORMAT_FASTA,
+    FORMAT_FASTQ
+} SeqFormat;
+
+// Streaming FASTA/FASTQ reader. Plain files are mmapped and handed out in
+// windows that end on record boundaries, with consumed pages released
+// behind the cursor. Gzip input (built with -DHAVE_ZLIB) is inflated into a
+// buffer; the partial record at the end of each window is carried over.
+typedef struct SeqReader {
+    SeqFormat format;
+    int fd;
+    const char* map;        // whole-file mapping (plain input)
+    size_t mapSize;
+    size_t pos;             // start of the next window in the mapping
+    size_t released;        // mapping prefix already returned to the kernel
+#ifdef HAVE_ZLIB
+    gzFile gz;
+#endif
+    int compressed;
+    char* buffer;           // inflated text (gzip input)
+    size_t bufferSize;
+    size_t bufferLen;
+    size_t windowEnd;       // buffer[windowEnd, bufferLen) is carried over
+    int eof;
+} SeqReader;
+
+void initGraph(DeBruijnGraph* graph, int k, int numParts, size_t expectedNodes);
+void freeGraph(DeBruijnGraph* graph);
+
+// Incremental build: begin, optionally enable canonical k-mers and the
+// Bloom prefilter, add reads in batches, finish (see dna_seq.c)
+void beginGraphBuild(GraphBuilder* builder, DeBruijnGraph* graph, int k, int numThreads, size_t expectedNodes);
+void enableCanonicalKmers(GraphBuilder* builder);
+int enableKmerFilter(GraphBuilder* builder, int minCount, size_t bloomBytes);
+void addReadsToGraph(GraphBuilder* builder, const SeqView* reads, size_t numReads);
+void finishGraphBuild(GraphBuilder* builder);
+void constructDeBruijnGraph(DeBruijnGraph* graph, const char* reads[], int numReads, int k, int numThreads);
+
+char* eulerianWalk(const DeBruijnGraph* graph, const char* startKmer, uint32_t* trails);
+void compactGraph(const DeBruijnGraph* graph, UnitigGraph* unitigs);
+void freeUnitigGraph(UnitigGraph* unitigs);
+char* eulerianWalkUnitigs(const UnitigGraph* unitigs, uint32_t* trails);
+
+int openSeqReader(SeqReader* reader, const char* path);
+int nextSeqWindow(SeqReader* reader, const char** text, size_t* len);
+void closeSeqReader(SeqReader* reader);
+size_t parseSeqWindow(SeqFormat format, const char* text, size_t len, int numThreads,
+                      SeqView** views, size_t* capacity);
+
+int buildGraphExternal(DeBruijnGraph* graph, const char* path, int k, int canonical, int numThreads, int minCount,
+                       size_t memoryBudget, const char* tmpDir);
+int buildGraphFromFile(DeBruijnGraph* graph, const char* path, int k, int canonical, int numThreads, int minCount,
+                       size_t bloomBytes);
+int sameGraph(const DeBruijnGraph* a, const DeBruijnGraph* b);
+
+#endif
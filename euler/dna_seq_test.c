@@ -0,0 +1,631 @@
+// dna_seq_test.c: randomized checks of the assembler against brute force
+// over the reads it was given, and of the walks against the reads and the
+// genome they came from.
+//   gcc -O2 -pthread -DDNA_SEQ_NO_MAIN -o dna_seq_test dna_seq.c dna_seq_test.c
+#include "dna_seq.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void randomBases(char* s, size_t length) {
+    for (size_t i = 0; i < length; i++) s[i] = "ACGT"[rand() & 3];
+    s[length] = '\0';
+}
+
+static void reverseComplementString(const char* s, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        char c = s[length - 1 - i];
+        out[i] = c == 'A' ? 'T' : c == 'C' ? 'G' : c == 'G' ? 'C' : c == 'T' ? 'A' : c;
+    }
+    out[length] = '\0';
+}
+
+// Reads of readLength sampled uniformly from genome, a fraction from the
+// reverse strand, with substitution errors at errorRate. One buffer holds
+// them all; it is returned through *storage.
+static char** sampleReads(const char* genome, size_t genomeLength, int numReads, int readLength, double reverseRate,
+                          double errorRate, char** storage) {
+    char* buffer = (char*)malloc((size_t)numReads * (size_t)(readLength + 1));
+    char** reads = (char**)malloc((size_t)numReads * sizeof(char*));
+    for (int r = 0; r < numReads; r++) {
+        char* read = buffer + (size_t)r * (size_t)(readLength + 1);
+        size_t start = (size_t)rand() % (genomeLength - (size_t)readLength + 1);
+        if ((double)rand() / RAND_MAX < reverseRate) {
+            reverseComplementString(genome + start, (size_t)readLength, read);
+        } else {
+            memcpy(read, genome + start, (size_t)readLength);
+            read[readLength] = '\0';
+        }
+        for (int i = 0; i < readLength; i++) {
+            if ((double)rand() / RAND_MAX < errorRate) {
+                int code = (int)(strchr("ACGT", read[i]) - "ACGT");
+                read[i] = "ACGT"[(code + 1 + rand() % 3) & 3];
+            }
+        }
+        reads[r] = read;
+    }
+    *storage = buffer;
+    return reads;
+}
+
+// Sorted windows of one length over a set of reads (and, for canonical
+// graphs, their reverse complements), as pointers into the read text.
+// Windows holding anything but ACGT are left out, as the assembler skips
+// them.
+static size_t windowLength;
+
+static int compareWindows(const void* a, const void* b) {
+    return memcmp(*(const char* const*)a, *(const char* const*)b, windowLength);
+}
+
+typedef struct WindowSet {
+    const char** windows;
+    size_t count;
+    size_t length;
+    char* reverse;          // reverse complements of the reads (both strands)
+} WindowSet;
+
+static void addWindows(WindowSet* set, const char* read, size_t readLength) {
+    for (size_t i = 0; i + set->length <= readLength; i++) {
+        if (strspn(read + i, "ACGT") >= set->length) set->windows[set->count++] = read + i;
+    }
+}
+
+static void buildWindowSet(WindowSet* set, char** reads, int numReads, size_t length, int bothStrands) {
+    size_t total = 0;
+    for (int r = 0; r < numReads; r++) total += strlen(reads[r]) + 1;
+    set->windows = (const char**)malloc((bothStrands ? 2 : 1) * (total + 1) * sizeof(char*));
+    set->reverse = bothStrands ? (char*)malloc(total + 1) : NULL;
+    set->count = 0;
+    set->length = length;
+    char* rc = set->reverse;
+    for (int r = 0; r < numReads; r++) {
+        size_t readLength = strlen(reads[r]);
+        addWindows(set, reads[r], readLength);
+        if (bothStrands) {
+            reverseComplementString(reads[r], readLength, rc);
+            addWindows(set, rc, readLength);
+            rc += readLength + 1;
+        }
+    }
+    windowLength = length;
+    qsort(set->windows, set->count, sizeof(char*), compareWindows);
+}
+
+// Occurrences of a window in the reads
+static size_t countWindow(const WindowSet* set, const char* window) {
+    size_t lo = 0, hi = set->count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (memcmp(set->windows[mid], window, set->length) < 0) lo = mid + 1; else hi = mid;
+    }
+    size_t count = 0;
+    while (lo + count < set->count && memcmp(set->windows[lo + count], window, set->length) == 0) count++;
+    return count;
+}
+
+static void freeWindowSet(WindowSet* set) {
+    free(set->windows);
+    free(set->reverse);
+}
+
+// Vertices of a canonical graph are its nodes on either strand
+static uint32_t vertexCount(const DeBruijnGraph* graph) {
+    return graph->canonical ? 2 * graph->numNodes : graph->numNodes;
+}
+
+// The bases of vertex v, first base in the high bits; odd vertices of a
+// canonical graph read their node's reverse complement
+static void vertexBases(const DeBruijnGraph* graph, uint32_t v, char* out) {
+    kmer_t kmer = graph->kmers[graph->canonical ? v >> 1 : v];
+    for (int i = graph->k - 1; i >= 0; i--, kmer >>= 2) out[i] = "ACGT"[(int)(kmer & 3)];
+    out[graph->k] = '\0';
+    if (graph->canonical && (v & 1)) {
+        char forward[MAX_K + 1];
+        memcpy(forward, out, (size_t)graph->k + 1);
+        reverseComplementString(forward, (size_t)graph->k, out);
+    }
+}
+
+static int compareStrings(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// Distinct windows seen at least minCount times
+static size_t frequentWindows(const WindowSet* set, size_t minCount) {
+    size_t frequent = 0;
+    for (size_t i = 0, run = 1; i < set->count; i++, run++) {
+        if (i > 0 && memcmp(set->windows[i - 1], set->windows[i], set->length) != 0) run = 1;
+        if (run == minCount) frequent++;
+    }
+    return frequent;
+}
+
+// Distinct (k+1)-mers whose two k-mers are both seen at least minCount
+// times: the edges left once rarer k-mers are dropped
+static size_t expectedEdges(const WindowSet* edges, const WindowSet* kmers, size_t minCount) {
+    size_t expected = 0;
+    for (size_t i = 0; i < edges->count; i++) {
+        if (i > 0 && memcmp(edges->windows[i - 1], edges->windows[i], edges->length) == 0) continue;
+        if (countWindow(kmers, edges->windows[i]) >= minCount && countWindow(kmers, edges->windows[i] + 1) >= minCount) {
+            expected++;
+        }
+    }
+    return expected;
+}
+
+// The graph must have one vertex per distinct k-mer seen at least minCount
+// times in the reads, and its edges must join two k-mers that occur
+// together in a (k+1)-mer of the reads; every such (k+1)-mer between two
+// kept k-mers must be an edge. A canonical graph is
+// checked against the reads on both strands; use an odd k, so that no
+// k-mer is its own reverse complement.
+static void checkGraph(const DeBruijnGraph* graph, char** reads, int numReads, int minCount) {
+    int k = graph->k;
+    WindowSet kmers, edges;
+    buildWindowSet(&kmers, reads, numReads, (size_t)k, graph->canonical);
+    buildWindowSet(&edges, reads, numReads, (size_t)k + 1, graph->canonical);
+    uint32_t n = vertexCount(graph);
+    assert(n == frequentWindows(&kmers, (size_t)minCount));
+    assert(graph->numEdges == expectedEdges(&edges, &kmers, (size_t)minCount));
+
+    char* bases = (char*)malloc((size_t)n * (size_t)(k + 1));
+    char** nodes = (char**)malloc(((size_t)n + 1) * sizeof(char*));
+    for (uint32_t v = 0; v < n; v++) {
+        nodes[v] = bases + (size_t)v * (size_t)(k + 1);
+        vertexBases(graph, v, nodes[v]);
+        assert(countWindow(&kmers, nodes[v]) >= (size_t)minCount);
+    }
+    char* edge = (char*)malloc((size_t)k + 2);
+    for (uint32_t u = 0; u < n; u++) {
+        int seen = 0;
+        for (uint64_t e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+            const char* target = nodes[graph->targets[e]];
+            assert(memcmp(nodes[u] + 1, target, (size_t)k - 1) == 0);
+            int base = (int)(strchr("ACGT", target[k - 1]) - "ACGT");
+            assert(!(seen & (1 << base)));
+            seen |= 1 << base;
+            memcpy(edge, nodes[u], (size_t)k);
+            edge[k] = target[k - 1];
+            assert(countWindow(&edges, edge) > 0);
+        }
+    }
+    // Distinct nodes: equal counts then make the node set the k-mer set
+    qsort(nodes, n, sizeof(char*), compareStrings);
+    for (uint32_t v = 1; v < n; v++) assert(strcmp(nodes[v - 1], nodes[v]) != 0);
+
+    free(edge);
+    free(nodes);
+    free(bases);
+    freeWindowSet(&kmers);
+    freeWindowSet(&edges);
+}
+
+// Build through the incremental builder, in batches of batchSize reads
+static void buildInBatches(DeBruijnGraph* graph, char** reads, int numReads, int k, int canonical, int numThreads,
+                           int batchSize) {
+    SeqView* views = (SeqView*)malloc((size_t)numReads * sizeof(SeqView));
+    for (int r = 0; r < numReads; r++) {
+        views[r].data = reads[r];
+        views[r].length = strlen(reads[r]);
+    }
+    GraphBuilder builder;
+    beginGraphBuild(&builder, graph, k, numThreads, 16);
+    if (canonical) enableCanonicalKmers(&builder);
+    for (int begin = 0; begin < numReads; begin += batchSize) {
+        addReadsToGraph(&builder, views + begin, (size_t)(numReads - begin < batchSize ? numReads - begin : batchSize));
+    }
+    finishGraphBuild(&builder);
+    free(views);
+}
+
+// Reads with errors (and a few non-ACGT bases) sampled from a random genome
+static void checkRandomReads(int k, int canonical, int numReads, int readLength, size_t genomeLength,
+                             int numThreads) {
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    char** reads = sampleReads(genome, genomeLength, numReads, readLength, canonical ? 0.5 : 0.0, 0.01, &storage);
+    for (int r = 0; r < numReads; r += 7) reads[r][rand() % readLength] = 'N';
+
+    DeBruijnGraph graph;
+    if (canonical) {
+        buildInBatches(&graph, reads, numReads, k, 1, numThreads, numReads);
+    } else {
+        constructDeBruijnGraph(&graph, (const char**)reads, numReads, k, numThreads);
+    }
+    checkGraph(&graph, reads, numReads, 1);
+
+    freeGraph(&graph);
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// Error-free reads tiling a genome whose k-mers are all distinct form a
+// single path (one unitig), which both walks must spell back exactly (a
+// canonical walk may spell either strand)
+static void checkReassembly(size_t genomeLength, int k, int canonical, int numThreads) {
+    char* genome = (char*)malloc(genomeLength + 1);
+    char* reverse = (char*)malloc(genomeLength + 1);
+    int readLength = 100, step = 40;
+    int numReads = (int)((genomeLength - (size_t)readLength + step - 1) / (size_t)step) + 1;
+    char* storage = (char*)malloc((size_t)numReads * (size_t)(readLength + 1));
+    char** reads = (char**)malloc((size_t)numReads * sizeof(char*));
+    DeBruijnGraph graph;
+    for (;;) {
+        randomBases(genome, genomeLength);
+        for (int r = 0; r < numReads; r++) {
+            size_t start = (size_t)r * (size_t)step;
+            if (start + (size_t)readLength > genomeLength) start = genomeLength - (size_t)readLength;
+            reads[r] = storage + (size_t)r * (size_t)(readLength + 1);
+            memcpy(reads[r], genome + start, (size_t)readLength);
+            reads[r][readLength] = '\0';
+        }
+        if (canonical) {
+            buildInBatches(&graph, reads, numReads, k, 1, numThreads, numReads);
+        } else {
+            constructDeBruijnGraph(&graph, (const char**)reads, numReads, k, numThreads);
+        }
+        // A repeated k-mer (on either strand, for a canonical graph) merges
+        // nodes; draw another genome. Canonical graphs hold the edges of
+        // both strands.
+        uint64_t edges = (uint64_t)(genomeLength - (size_t)k) * (canonical ? 2 : 1);
+        if (graph.numNodes == genomeLength - (size_t)k + 1 && graph.numEdges == edges) break;
+        freeGraph(&graph);
+    }
+    reverseComplementString(genome, genomeLength, reverse);
+
+    uint32_t trails;
+    char* sequence = eulerianWalk(&graph, NULL, &trails);
+    assert(sequence != NULL && trails == 1);
+    assert(strcmp(sequence, genome) == 0 || (canonical && strcmp(sequence, reverse) == 0));
+    free(sequence);
+    char first[MAX_K + 1];
+    memcpy(first, genome, (size_t)k);
+    first[k] = '\0';
+    sequence = eulerianWalk(&graph, first, NULL);
+    assert(sequence != NULL && strcmp(sequence, genome) == 0);
+    free(sequence);
+
+    UnitigGraph unitigs;
+    compactGraph(&graph, &unitigs);
+    assert(unitigs.numUnitigs == 1);
+    sequence = eulerianWalkUnitigs(&unitigs, &trails);
+    assert(sequence != NULL && trails == 1);
+    assert(strcmp(sequence, genome) == 0 || (canonical && strcmp(sequence, reverse) == 0));
+    free(sequence);
+    freeUnitigGraph(&unitigs);
+
+    freeGraph(&graph);
+    free(reads);
+    free(storage);
+    free(reverse);
+    free(genome);
+}
+
+// Every trail of a walk must spell only (k+1)-mers of the reads, however
+// the graph's unbalanced nodes break the walk up. Returns the trail count.
+static uint32_t checkTrails(char* sequence, uint32_t trails, const WindowSet* edges, int k) {
+    uint32_t lines = 0;
+    for (char* trail = strtok(sequence, "\n"); trail != NULL; trail = strtok(NULL, "\n"), lines++) {
+        size_t length = strlen(trail);
+        assert(length >= (size_t)k);
+        for (size_t i = 0; i + (size_t)k < length; i++) assert(countWindow(edges, trail + i) > 0);
+    }
+    assert(lines == trails);
+    return lines;
+}
+
+// Reads with errors give a graph full of tips and bubbles, which breaks
+// the walk into trails; the node-level and unitig walks must both stay on
+// edges of the reads
+static void checkWalkSpellsReads(int k, int canonical, int numThreads) {
+    size_t genomeLength = 20000;
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    int numReads = 2000;
+    char** reads = sampleReads(genome, genomeLength, numReads, 100, canonical ? 0.5 : 0.0, 0.01, &storage);
+    DeBruijnGraph graph;
+    buildInBatches(&graph, reads, numReads, k, canonical, numThreads, numReads);
+
+    WindowSet edges;
+    buildWindowSet(&edges, reads, numReads, (size_t)k + 1, canonical);
+    uint32_t trails;
+    char* sequence = eulerianWalk(&graph, NULL, &trails);
+    assert(sequence != NULL);
+    uint32_t lines = checkTrails(sequence, trails, &edges, k);
+    assert(lines > 1);
+    free(sequence);
+
+    UnitigGraph unitigs;
+    compactGraph(&graph, &unitigs);
+    sequence = eulerianWalkUnitigs(&unitigs, &trails);
+    assert(sequence != NULL);
+    checkTrails(sequence, trails, &edges, k);
+    free(sequence);
+
+    freeUnitigGraph(&unitigs);
+    freeWindowSet(&edges);
+    freeGraph(&graph);
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// Write reads as FASTQ, or as FASTA wrapped at 60 columns so records span
+// lines; returns the path of a new temporary file
+static char* writeReads(char** reads, int numReads, int fasta) {
+    const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    size_t nameLength = strlen(tmpDir) + 32;
+    char* path = (char*)malloc(nameLength);
+    snprintf(path, nameLength, "%s/dna_seq_test.XXXXXX", tmpDir);
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE* out = fdopen(fd, "w");
+    assert(out != NULL);
+    char quality[256];
+    memset(quality, 'I', sizeof(quality));
+    for (int r = 0; r < numReads; r++) {
+        int length = (int)strlen(reads[r]);
+        if (fasta) {
+            fprintf(out, ">read%d\n", r);
+            for (int i = 0; i < length; i += 60) fprintf(out, "%.*s\n", length - i < 60 ? length - i : 60, reads[r] + i);
+        } else {
+            fprintf(out, "@read%d\n%s\n+\n%.*s\n", r, reads[r], length, quality);
+        }
+    }
+    int closed = fclose(out);
+    assert(closed == 0);
+    return path;
+}
+
+// The same reads through a file, and through the incremental builder in
+// several batches
+static void checkFileBuild(int k, int canonical, int fasta, int numThreads) {
+    size_t genomeLength = 20000;
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    int numReads = 2000;
+    char** reads = sampleReads(genome, genomeLength, numReads, 100, canonical ? 0.5 : 0.0, 0.01, &storage);
+    for (int r = 0; r < numReads; r += 7) reads[r][rand() % 100] = 'N';
+    char* path = writeReads(reads, numReads, fasta);
+
+    DeBruijnGraph graph;
+    int status = buildGraphFromFile(&graph, path, k, canonical, numThreads, 1, 0);
+    assert(status == 0);
+    checkGraph(&graph, reads, numReads, 1);
+    freeGraph(&graph);
+
+    buildInBatches(&graph, reads, numReads, k, canonical, numThreads, 700);
+    checkGraph(&graph, reads, numReads, 1);
+    freeGraph(&graph);
+
+    unlink(path);
+    free(path);
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// k-mers seen fewer than minCount times dropped through the Bloom
+// prefilter. The filter gets far more bits than the reads have k-mers, so
+// a false positive letting a rarer k-mer through is vanishingly unlikely.
+static void checkFilteredBuild(int k, int canonical, int minCount, int numThreads) {
+    size_t genomeLength = 20000;
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    int numReads = 2000;
+    char** reads = sampleReads(genome, genomeLength, numReads, 100, canonical ? 0.5 : 0.0, 0.01, &storage);
+    char* path = writeReads(reads, numReads, 0);
+
+    DeBruijnGraph graph;
+    int status = buildGraphFromFile(&graph, path, k, canonical, numThreads, minCount, (size_t)64 << 20);
+    assert(status == 0);
+    assert(graph.numNodes > 0);
+    checkGraph(&graph, reads, numReads, minCount);
+    freeGraph(&graph);
+
+    unlink(path);
+    free(path);
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// minCount at the 8-bit count limit: k-mers of a read copied 255 and 300
+// times (the count saturates) stay at minCount 255, those of a read copied
+// 254 times go, in memory and out of core alike, and a minCount past the
+// limit is rejected
+static void checkMinCountLimit(int canonical, int numThreads) {
+    int copies[] = { 255, 254, 300 };
+    int numReads = copies[0] + copies[1] + copies[2];
+    char distinct[3][201];
+    char** reads = (char**)malloc((size_t)numReads * sizeof(char*));
+    for (int i = 0, r = 0; i < 3; i++) {
+        randomBases(distinct[i], 200);
+        for (int c = 0; c < copies[i]; c++) reads[r++] = distinct[i];
+    }
+    char* path = writeReads(reads, numReads, 0);
+
+    DeBruijnGraph graph;
+    int status = buildGraphFromFile(&graph, path, 31, canonical, numThreads, MAX_MIN_COUNT, (size_t)1 << 20);
+    assert(status == 0);
+    assert(graph.numNodes == 2 * (200 - 31 + 1));
+    checkGraph(&graph, reads, numReads, MAX_MIN_COUNT);
+    const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    DeBruijnGraph external;
+    status = buildGraphExternal(&external, path, 31, canonical, numThreads, MAX_MIN_COUNT, (size_t)64 << 10, tmpDir);
+    assert(status == 0);
+    assert(sameGraph(&graph, &external));
+    freeGraph(&external);
+    freeGraph(&graph);
+    assert(buildGraphFromFile(&graph, path, 31, canonical, numThreads, MAX_MIN_COUNT + 1, 0) == -1);
+    assert(buildGraphFromFile(&graph, path, 31, canonical, numThreads, 0, 0) == -1);
+    assert(buildGraphExternal(&graph, path, 31, canonical, numThreads, MAX_MIN_COUNT + 1, (size_t)64 << 10, tmpDir) == -1);
+
+    GraphBuilder builder;
+    beginGraphBuild(&builder, &graph, 31, numThreads, 16);
+    assert(enableKmerFilter(&builder, MAX_MIN_COUNT + 1, (size_t)1 << 20) == -1);
+    finishGraphBuild(&builder);
+    freeGraph(&graph);
+
+    unlink(path);
+    free(path);
+    free(reads);
+}
+
+// The external build (minimizer buckets on disk, exact counts) must match
+// brute force exactly, and the in-memory build edge for edge
+static void checkExternalBuild(int k, int canonical, int minCount, int fasta, int numThreads) {
+    size_t genomeLength = 20000;
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    int numReads = 2000;
+    char** reads = sampleReads(genome, genomeLength, numReads, 100, canonical ? 0.5 : 0.0, 0.01, &storage);
+    for (int r = 0; r < numReads; r += 7) reads[r][rand() % 100] = 'N';
+    char* path = writeReads(reads, numReads, fasta);
+    const char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    DeBruijnGraph external;
+    // A tiny budget forces many buckets and frequent flushes
+    int status = buildGraphExternal(&external, path, k, canonical, numThreads, minCount, (size_t)64 << 10, tmpDir);
+    assert(status == 0);
+    assert(external.numNodes > 0);
+    checkGraph(&external, reads, numReads, minCount);
+    DeBruijnGraph inMemory;
+    status = buildGraphFromFile(&inMemory, path, k, canonical, numThreads, minCount, (size_t)64 << 20);
+    assert(status == 0);
+    assert(sameGraph(&inMemory, &external));
+    freeGraph(&inMemory);
+    freeGraph(&external);
+
+    unlink(path);
+    free(path);
+    free(reads);
+    free(storage);
+    free(genome);
+}
+
+// Bucket files must get fresh names: symlinks planted under the names a
+// predictable scheme would use (dna_seq.<pid>.bucket<b>) are not followed,
+// their target is left intact, and no bucket file outlives the build
+static void checkBucketFiles(void) {
+    const char* base = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    size_t nameLength = strlen(base) + 64;
+    char* dir = (char*)malloc(nameLength);
+    char* name = (char*)malloc(nameLength);
+    snprintf(dir, nameLength, "%s/dna_seq_test.XXXXXX", base);
+    char* made = mkdtemp(dir);
+    assert(made != NULL);
+    snprintf(name, nameLength, "%s/victim", dir);
+    FILE* victim = fopen(name, "w");
+    assert(victim != NULL);
+    fputs("keep", victim);
+    fclose(victim);
+    for (int b = 0; b < 512; b++) {
+        char link[64];
+        snprintf(link, sizeof(link), "dna_seq.%ld.bucket%d", (long)getpid(), b);
+        snprintf(name, nameLength, "%s/%s", dir, link);
+        int linked = symlink("victim", name);
+        assert(linked == 0);
+    }
+
+    size_t genomeLength = 20000;
+    char* genome = (char*)malloc(genomeLength + 1);
+    randomBases(genome, genomeLength);
+    char* storage;
+    int numReads = 2000;
+    char** reads = sampleReads(genome, genomeLength, numReads, 100, 0.0, 0.01, &storage);
+    char* path = writeReads(reads, numReads, 0);
+    DeBruijnGraph graph;
+    int status = buildGraphExternal(&graph, path, 31, 0, 2, 1, (size_t)64 << 10, dir);
+    assert(status == 0);
+    checkGraph(&graph, reads, numReads, 1);
+    freeGraph(&graph);
+
+    snprintf(name, nameLength, "%s/victim", dir);
+    victim = fopen(name, "r");
+    assert(victim != NULL);
+    char text[8] = "";
+    char* got = fgets(text, sizeof(text), victim);
+    assert(got != NULL && strcmp(text, "keep") == 0);
+    fclose(victim);
+    unlink(name);
+    // Only the planted links are left
+    DIR* listing = opendir(dir);
+    assert(listing != NULL);
+    for (struct dirent* entry; (entry = readdir(listing)) != NULL;) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        assert(strncmp(entry->d_name, "dna_seq.", 8) == 0 && strstr(entry->d_name, ".bucket") != NULL);
+        snprintf(name, nameLength, "%s/%s", dir, entry->d_name);
+        unlink(name);
+    }
+    closedir(listing);
+    int removed = rmdir(dir);
+    assert(removed == 0);
+
+    unlink(path);
+    free(path);
+    free(reads);
+    free(storage);
+    free(genome);
+    free(name);
+    free(dir);
+}
+
+int main() {
+    srand(12345);
+    int graphs = 0;
+
+    char demo[][11] = { "ATGGCGTGCA", "GCGTGCATGG", "CATGGATCCA", "ATCCAGCGTA" };
+    char* demoReads[] = { demo[0], demo[1], demo[2], demo[3] };
+    for (int k = 1; k <= 9; k++, graphs++) {
+        DeBruijnGraph graph;
+        constructDeBruijnGraph(&graph, (const char**)demoReads, 4, k, 1 + k % 3);
+        checkGraph(&graph, demoReads, 4, 1);
+        freeGraph(&graph);
+    }
+
+    int ks[] = { 3, 5, 11, 21, 31, MAX_K - 1 };
+    for (int canonical = 0; canonical <= 1; canonical++) {
+        for (int i = 0; i < (int)(sizeof(ks) / sizeof(ks[0])); i++) {
+            // Canonical graphs need an odd k
+            int k = canonical && ks[i] % 2 == 0 ? ks[i] - 1 : ks[i];
+            for (int threads = 1; threads <= 4; threads++, graphs++) {
+                checkRandomReads(k, canonical, 500 + rand() % 1500, 100, 2000 + (size_t)(rand() % 20000), threads);
+            }
+        }
+        for (int threads = 1; threads <= 4; threads *= 2, graphs += 2) {
+            checkWalkSpellsReads(15, canonical, threads);
+            checkWalkSpellsReads(31, canonical, threads);
+        }
+        for (int round = 0; round < 10; round++, graphs++) {
+            checkReassembly(1000 + (size_t)(rand() % 20000), 21 + 2 * (rand() % 6), canonical, 1 + rand() % 4);
+        }
+        for (int fasta = 0; fasta <= 1; fasta++) {
+            for (int threads = 1; threads <= 4; threads *= 2, graphs += 2) checkFileBuild(31, canonical, fasta, threads);
+        }
+        for (int minCount = 2; minCount <= 3; minCount++) {
+            for (int threads = 1; threads <= 4; threads *= 2, graphs++) {
+                checkFilteredBuild(31, canonical, minCount, threads);
+            }
+        }
+        for (int threads = 1; threads <= 4; threads *= 2, graphs++) checkMinCountLimit(canonical, threads);
+        for (int minCount = 1; minCount <= 2; minCount++) {
+            for (int fasta = 0; fasta <= 1; fasta++, graphs++) checkExternalBuild(31, canonical, minCount, fasta, 3);
+        }
+    }
+    checkBucketFiles();
+    graphs++;
+    printf("All %d graphs matched brute force.\n", graphs);
+    return 0;
+}
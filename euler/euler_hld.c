@@ -0,0 +1,261 @@
+#include "euler_hld.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const HldAggregate EMPTY_AGGREGATE = { 0, LLONG_MIN };
+
+static void* xmalloc(size_t size) {
+    void* p = malloc(size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static inline HldAggregate combine(HldAggregate a, HldAggregate b) {
+    HldAggregate c = { a.sum + b.sum, a.max > b.max ? a.max : b.max };
+    return c;
+}
+
+static inline HldAggregate leaf(long long value) {
+    HldAggregate c = { value, value };
+    return c;
+}
+
+// Decompose the tree and load values (indexed by node). A node's heavy
+// child is the one with the largest subtree. addChild numbers children
+// after their parents, so one backward pass over the nodes completes every
+// subtree size before its parent reads it, and no DFS is needed. Chains
+// are then laid out whole: each chain head in index order claims the next
+// run of positions and its chain follows the heavy links down.
+void buildHeavyLight(HeavyLight* hld, const Tree* tree, const long long* values) {
+    uint32_t n = tree->size;
+    const TreeLinks* links = tree->links;
+    uint32_t* size = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    uint32_t* heavy = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    int* depth = (int*)xmalloc((size_t)n * sizeof(int));
+    for (uint32_t v = 0; v < n; v++) {
+        size[v] = 1;
+        heavy[v] = NO_NODE;
+    }
+    for (uint32_t v = n - 1; v > 0; v--) {
+        uint32_t p = links[v].parent;
+        size[p] += size[v];
+        if (heavy[p] == NO_NODE || size[v] > size[heavy[p]]) heavy[p] = v;
+    }
+    depth[0] = 0;
+    for (uint32_t v = 1; v < n; v++) depth[v] = depth[links[v].parent] + 1;
+
+    hld->size = n;
+    hld->pos = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    hld->slot = (HldSlot*)xmalloc((size_t)n * sizeof(HldSlot));
+    hld->seg = (HldAggregate*)xmalloc(2 * (size_t)n * sizeof(HldAggregate));
+    uint32_t next = 0;
+    for (uint32_t h = 0; h < n; h++) {
+        if (h != 0 && heavy[links[h].parent] == h) continue; // not a chain head
+        HldSlot chain;
+        chain.head = next;
+        chain.headParent = h == 0 ? NO_NODE : hld->pos[links[h].parent];
+        chain.headDepth = depth[h];
+        for (uint32_t v = h; v != NO_NODE; v = heavy[v], next++) {
+            hld->pos[v] = next;
+            hld->slot[next] = chain;
+            hld->seg[n + next] = leaf(values[v]);
+        }
+    }
+    for (uint32_t i = n - 1; i > 0; i--) hld->seg[i] = combine(hld->seg[2 * i], hld->seg[2 * i + 1]);
+    free(size);
+    free(heavy);
+    free(depth);
+}
+
+void freeHeavyLight(HeavyLight* hld) {
+    free(hld->pos);
+    free(hld->slot);
+    free(hld->seg);
+    memset(hld, 0, sizeof(*hld));
+}
+
+static void updateLeaf(HeavyLight* hld, uint32_t p, HldAggregate value) {
+    HldAggregate* seg = hld->seg;
+    p += hld->size;
+    seg[p] = value;
+    for (p >>= 1; p > 0; p >>= 1) seg[p] = combine(seg[2 * p], seg[2 * p + 1]);
+}
+
+void hldSetValue(HeavyLight* hld, uint32_t node, long long value) {
+    updateLeaf(hld, hld->pos[node], leaf(value));
+}
+
+void hldAddValue(HeavyLight* hld, uint32_t node, long long delta) {
+    uint32_t p = hld->pos[node];
+    updateLeaf(hld, p, leaf(hld->seg[hld->size + p].sum + delta));
+}
+
+// Aggregate of positions [l, r], bottom-up over the segment tree
+static HldAggregate rangeAggregate(const HeavyLight* hld, uint32_t l, uint32_t r) {
+    HldAggregate acc = EMPTY_AGGREGATE;
+    for (l += hld->size, r += hld->size + 1; l < r; l >>= 1, r >>= 1) {
+        if (l & 1) acc = combine(acc, hld->seg[l++]);
+        if (r & 1) acc = combine(acc, hld->seg[--r]);
+    }
+    return acc;
+}
+
+// Sum and maximum of the values on the path between u and v, both ends
+// included. The endpoint on the deeper chain head climbs a chain at a time
+// until both lie on one chain.
+HldAggregate pathAggregate(const HeavyLight* hld, uint32_t u, uint32_t v) {
+    HldAggregate acc = EMPTY_AGGREGATE;
+    uint32_t a = hld->pos[u], b = hld->pos[v];
+    for (;;) {
+        const HldSlot* sa = &hld->slot[a];
+        const HldSlot* sb = &hld->slot[b];
+        if (sa->head == sb->head) break;
+        if (sa->headDepth < sb->headDepth) {
+            uint32_t t = a;
+            a = b;
+            b = t;
+            sa = sb;
+        }
+        acc = combine(acc, rangeAggregate(hld, sa->head, a));
+        a = sa->headParent;
+    }
+    return combine(acc, a < b ? rangeAggregate(hld, a, b) : rangeAggregate(hld, b, a));
+}
+
+#ifndef EULER_HLD_NO_MAIN
+static double elapsedSeconds(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Random tree whose node i hangs under one of the window nodes before it:
+// window == 0 is a random recursive tree (depth ~ ln n), a small window
+// gives long paths and many light edges along them
+static void randomTree(Tree* tree, int numNodes, int window, int* depth) {
+    initTree(tree, 0, (uint32_t)numNodes);
+    depth[0] = 0;
+    for (int i = 1; i < numNodes; i++) {
+        int p = window == 0 || i <= window ? rand() % i : i - 1 - rand() % window;
+        addChild(tree, (uint32_t)p, i);
+        depth[i] = depth[p] + 1;
+    }
+}
+
+static HldAggregate naivePath(const Tree* tree, const int* depth, const long long* values, uint32_t u, uint32_t v) {
+    HldAggregate acc = EMPTY_AGGREGATE;
+    while (u != v) {
+        if (depth[u] < depth[v]) {
+            uint32_t t = u;
+            u = v;
+            v = t;
+        }
+        acc = combine(acc, leaf(values[u]));
+        u = tree->links[u].parent;
+    }
+    return combine(acc, leaf(values[u]));
+}
+
+// Benchmark: interleaved path queries (sum and max) and point updates,
+// then a replay of the updates to check a sample of queries by climbing
+static int benchmarkPaths(int numNodes, long long numOps, int window) {
+    srand(42);
+    int* depth = (int*)xmalloc((size_t)numNodes * sizeof(int));
+    Tree tree;
+    randomTree(&tree, numNodes, window, depth);
+    int maxDepth = 0;
+    for (int v = 0; v < numNodes; v++) maxDepth = depth[v] > maxDepth ? depth[v] : maxDepth;
+    long long* values = (long long*)xmalloc((size_t)numNodes * sizeof(long long));
+    for (int v = 0; v < numNodes; v++) values[v] = rand() % 1000;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    HeavyLight hld;
+    buildHeavyLight(&hld, &tree, values);
+    double buildSeconds = elapsedSeconds(&start);
+    uint32_t chains = 0;
+    for (uint32_t p = 0; p < hld.size; p++) chains += hld.slot[p].head == p;
+
+    uint32_t* u = (uint32_t*)xmalloc((size_t)numOps * sizeof(uint32_t));
+    uint32_t* v = (uint32_t*)xmalloc((size_t)numOps * sizeof(uint32_t));
+    int* delta = (int*)xmalloc((size_t)numOps * sizeof(int));
+    for (long long i = 0; i < numOps; i++) {
+        u[i] = (uint32_t)(rand() % numNodes);
+        v[i] = (uint32_t)(rand() % numNodes);
+        delta[i] = rand() % 2001 - 1000;
+    }
+    long long checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long long i = 0; i < numOps; i++) {
+        if (i & 1) {
+            HldAggregate a = pathAggregate(&hld, u[i], v[i]);
+            checksum += a.sum + a.max;
+        } else {
+            hldAddValue(&hld, u[i], delta[i]);
+        }
+    }
+    double opSeconds = elapsedSeconds(&start);
+
+    for (long long i = 0; i < numOps; i += 2) values[u[i]] += delta[i];
+    int errors = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint32_t a = (uint32_t)(rand() % numNodes), b = (uint32_t)(rand() % numNodes);
+        HldAggregate got = pathAggregate(&hld, a, b), want = naivePath(&tree, depth, values, a, b);
+        if (got.sum != want.sum || got.max != want.max) errors++;
+    }
+    size_t bytes = (size_t)numNodes * (sizeof(uint32_t) + sizeof(HldSlot) + 2 * sizeof(HldAggregate));
+    printf("Heavy-light, %d nodes (%s, max depth %d): %u chains, %.1f MB built in %.3f s\n", numNodes,
+           window == 0 ? "random recursive" : "windowed", maxDepth, chains, bytes / 1048576.0, buildSeconds);
+    printf("  %lld ops (half point updates, half path sum + max) in %.3f s: %.2f M ops/s, %.0f ns/op"
+           " (checksum %lld); %d mismatches in 1000 checked paths\n",
+           numOps, opSeconds, numOps / opSeconds / 1e6, opSeconds * 1e9 / numOps, checksum, errors);
+    freeHeavyLight(&hld);
+    freeTree(&tree);
+    free(values);
+    free(depth);
+    free(u);
+    free(v);
+    free(delta);
+    return errors == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench-paths") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 10000000;
+        long long numOps = argc > 3 ? atoll(argv[3]) : 10000000;
+        int window = argc > 4 ? atoi(argv[4]) : 0;
+        if (numNodes < 1 || numOps < 1 || window < 0) {
+            fprintf(stderr, "usage: euler_hld --bench-paths [nodes] [ops] [parent window, 0 = random recursive]\n");
+            return 1;
+        }
+        return benchmarkPaths(numNodes, numOps, window) == 0 ? 0 : 1;
+    }
+
+    // The sample tree of euler_tree.c, each node valued at its data
+    Tree tree;
+    initTree(&tree, 1, 6);
+    uint32_t n2 = addChild(&tree, 0, 2);
+    uint32_t n3 = addChild(&tree, 0, 3);
+    uint32_t n4 = addChild(&tree, n2, 4);
+    addChild(&tree, n2, 5);
+    uint32_t n6 = addChild(&tree, n3, 6);
+    long long values[6];
+    for (uint32_t v = 0; v < tree.size; v++) values[v] = tree.data[v];
+
+    HeavyLight hld;
+    buildHeavyLight(&hld, &tree, values);
+    printf("Path 4 -> 6: sum %lld, max %lld\n", pathSum(&hld, n4, n6), pathMax(&hld, n4, n6));
+    hldSetValue(&hld, n2, 10);
+    printf("After setting node 2 to 10: sum %lld, max %lld\n", pathSum(&hld, n4, n6), pathMax(&hld, n4, n6));
+    freeHeavyLight(&hld);
+    freeTree(&tree);
+    return 0;
+}
+#endif
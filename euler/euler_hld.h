@@ -0,0 +1,44 @@
+#ifndef EULER_HLD_H
+#define EULER_HLD_H
+
+#include "euler_tree.h"
+
+// Heavy-light decomposition of a Tree for path aggregates. Every chain of
+// heavy edges occupies a contiguous run of positions, with its head first,
+// and one segment tree over the positions answers the chain pieces of a
+// path. A path query touches O(log n) chains, so it is O(log^2 n).
+
+// Per position: the chain this position lies on
+typedef struct HldSlot {
+    uint32_t head;          // position of the chain head
+    uint32_t headParent;    // position of the head's parent, NO_NODE for the root chain
+    int headDepth;
+} HldSlot;
+
+typedef struct HldAggregate {
+    long long sum;
+    long long max;
+} HldAggregate;
+
+typedef struct HeavyLight {
+    uint32_t size;
+    uint32_t* pos;          // node -> position
+    HldSlot* slot;          // position -> chain
+    HldAggregate* seg;      // segment tree, leaves at [size, 2 * size) in position order
+} HeavyLight;
+
+void buildHeavyLight(HeavyLight* hld, const Tree* tree, const long long* values);
+void freeHeavyLight(HeavyLight* hld);
+void hldSetValue(HeavyLight* hld, uint32_t node, long long value);
+void hldAddValue(HeavyLight* hld, uint32_t node, long long delta);
+HldAggregate pathAggregate(const HeavyLight* hld, uint32_t u, uint32_t v);
+
+static inline long long pathSum(const HeavyLight* hld, uint32_t u, uint32_t v) {
+    return pathAggregate(hld, u, v).sum;
+}
+
+static inline long long pathMax(const HeavyLight* hld, uint32_t u, uint32_t v) {
+    return pathAggregate(hld, u, v).max;
+}
+
+#endif
@@ -0,0 +1,92 @@
+// euler_hld_test.c: randomized checks of heavy-light path sums and maxima,
+// with point updates, against climbing explicit parent arrays.
+//   gcc -O2 -pthread -DEULER_TREE_NO_MAIN -DEULER_HLD_NO_MAIN -o euler_hld_test euler_tree.c euler_hld.c euler_hld_test.c
+#include "euler_hld.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum Shape { RANDOM, PATH, STAR, CATERPILLAR, BINARY, NUM_SHAPES };
+
+static void naivePath(const int* parent, const int* depth, const long long* values, int u, int v, long long* sum,
+                      long long* max) {
+    *sum = 0;
+    *max = LLONG_MIN;
+    for (;;) {
+        if (depth[u] < depth[v]) {
+            int t = u;
+            u = v;
+            v = t;
+        }
+        *sum += values[u];
+        if (values[u] > *max) *max = values[u];
+        if (u == v) return;
+        u = parent[u];
+    }
+}
+
+static void checkTree(int n, enum Shape shape) {
+    int* parent = (int*)malloc((size_t)n * sizeof(int));
+    int* depth = (int*)malloc((size_t)n * sizeof(int));
+    long long* values = (long long*)malloc((size_t)n * sizeof(long long));
+    Tree tree;
+    initTree(&tree, 0, 1);
+    parent[0] = -1;
+    depth[0] = 0;
+    for (int i = 1; i < n; i++) {
+        int p;
+        switch (shape) {
+            case PATH: p = i - 1; break;
+            case STAR: p = 0; break;
+            case CATERPILLAR: p = (i & 1) ? i - 1 : (i >= 2 ? i - 2 : 0); break;
+            case BINARY: p = (i - 1) / 2; break;
+            default: p = rand() % i; break;
+        }
+        addChild(&tree, (uint32_t)p, i);
+        parent[i] = p;
+        depth[i] = depth[p] + 1;
+    }
+    for (int i = 0; i < n; i++) values[i] = rand() % 2000 - 1000;
+    HeavyLight hld;
+    buildHeavyLight(&hld, &tree, values);
+
+    for (int op = 0; op < 4 * n; op++) {
+        int u = rand() % n;
+        int kind = rand() % 3;
+        if (kind == 0) {
+            long long delta = rand() % 200 - 100;
+            hldAddValue(&hld, (uint32_t)u, delta);
+            values[u] += delta;
+        } else if (kind == 1) {
+            long long value = rand() % 2000 - 1000;
+            hldSetValue(&hld, (uint32_t)u, value);
+            values[u] = value;
+        } else {
+            int v = rand() % n;
+            long long sum, max;
+            naivePath(parent, depth, values, u, v, &sum, &max);
+            HldAggregate got = pathAggregate(&hld, (uint32_t)u, (uint32_t)v);
+            assert(got.sum == sum && got.max == max);
+            assert(pathSum(&hld, (uint32_t)v, (uint32_t)u) == sum);
+        }
+    }
+
+    freeHeavyLight(&hld);
+    freeTree(&tree);
+    free(values);
+    free(depth);
+    free(parent);
+}
+
+int main() {
+    srand(2024);
+    int trees = 0;
+    for (int shape = 0; shape < NUM_SHAPES; shape++) {
+        for (int n = 1; n <= 70; n++, trees++) checkTree(n, (enum Shape)shape);
+        for (int round = 0; round < 20; round++, trees++) checkTree(100 + rand() % 900, (enum Shape)shape);
+    }
+    printf("All %d random trees matched brute force.\n", trees);
+    return 0;
+}
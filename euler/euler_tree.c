@@ -1,128 +1,868 @@
+#include "euler_tree.h"
+
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-#define MAX_NODES 100
-
-// Structure to represent a tree node
-typedef struct TreeNode {
-    int data;
-    struct TreeNode* firstChild;
-    struct TreeNode* nextSibling;
-} TreeNode;
-
-// Structure to represent an Euler tour
-typedef struct EulerTour {
-    int node; // Node data
-    int depth; // Depth of the node in the tree
-} EulerTour;
+#include <string.h>
+#include <time.h>
 
 // Global variables
-EulerTour tour[2 * MAX_NODES]; // Array to store the Euler tour
+EulerTour* tour = NULL; // Array to store the Euler tour, 2 * nodes - 1 entries
 int tourIndex = 0; // Index for the Euler tour array
+int* tin = NULL;
+int* tout = NULL;
+
+static void* xmalloc(size_t size) {
+    void* p = malloc(size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
 
-// Function to create a new tree node
-TreeNode* createNode(int data) {
-    TreeNode* newNode = (TreeNode*)malloc(sizeof(TreeNode));
-    newNode->data = data;
-    newNode->firstChild = NULL;
-    newNode->nextSibling = NULL;
-    return newNode;
+// Carve the node arrays for capacity nodes out of one arena block
+static void layoutTree(Tree* tree, void* arena, uint32_t capacity) {
+    tree->arena = arena;
+    tree->capacity = capacity;
+    tree->links = (TreeLinks*)arena;
+    tree->data = (int*)(tree->links + capacity);
 }
 
-// Function to add a child to a tree node
-void addChild(TreeNode* parent, int childData) {
-    TreeNode* child = createNode(childData);
-    if (parent->firstChild == NULL) {
-        parent->firstChild = child;
+// Function to create a tree holding just its root (node 0). capacity is a
+// hint; the arena doubles when it fills up.
+void initTree(Tree* tree, int rootData, uint32_t capacity) {
+    if (capacity < 16) capacity = 16;
+    layoutTree(tree, xmalloc((size_t)capacity * TREE_BYTES_PER_NODE), capacity);
+    tree->size = 1;
+    tree->data[0] = rootData;
+    tree->links[0] = (TreeLinks){ NO_NODE, NO_NODE, NO_NODE, NO_NODE };
+}
+
+// Function to add a child to a tree node in O(1); returns the new node
+uint32_t addChild(Tree* tree, uint32_t parent, int childData) {
+    if (tree->size == tree->capacity) {
+        Tree old = *tree;
+        layoutTree(tree, xmalloc((size_t)old.capacity * 2 * TREE_BYTES_PER_NODE), old.capacity * 2);
+        memcpy(tree->links, old.links, old.size * sizeof(TreeLinks));
+        memcpy(tree->data, old.data, old.size * sizeof(int));
+        free(old.arena);
+    }
+    uint32_t child = tree->size++;
+    tree->data[child] = childData;
+    tree->links[child] = (TreeLinks){ parent, NO_NODE, NO_NODE, NO_NODE };
+    TreeLinks* p = &tree->links[parent];
+    if (p->firstChild == NO_NODE) {
+        p->firstChild = child;
     } else {
-        TreeNode* sibling = parent->firstChild;
-        while (sibling->nextSibling != NULL) {
-            sibling = sibling->nextSibling;
-        }
-        sibling->nextSibling = child;
+        tree->links[p->lastChild].nextSibling = child;
     }
+    p->lastChild = child;
+    return child;
 }
 
-// Function to perform an Euler tour of the tree
-void eulerTour(TreeNode* root, int depth) {
-    if (root == NULL) return;
+void freeTree(Tree* tree) {
+    free(tree->arena);
+    memset(tree, 0, sizeof(*tree));
+}
 
-    // Record the current node and its depth
-    tour[tourIndex].node = root->data;
+// Make room for the tour of a tree with numNodes nodes
+void allocateTour(int numNodes) {
+    free(tour);
+    free(tin);
+    free(tout);
+    tour = (EulerTour*)xmalloc((size_t)(2 * numNodes - 1) * sizeof(EulerTour));
+    tin = (int*)xmalloc((size_t)numNodes * sizeof(int));
+    tout = (int*)xmalloc((size_t)numNodes * sizeof(int));
+    tourIndex = 0;
+}
+
+static inline void recordVisit(uint32_t node, int depth) {
+    tour[tourIndex].node = (int)node;
     tour[tourIndex].depth = depth;
     tourIndex++;
+}
+
+// Function to perform an Euler tour of the tree from the root. Also
+// records each node's entry time (preorder index) and exit time (the last
+// preorder index in its subtree), so a subtree is the interval [tin, tout].
+// The walk is iterative: the parent links replace the call stack, so the
+// depth of the tree is not limited by the stack size.
+void eulerTour(const Tree* tree) {
+    int timer = 0, depth = 0;
+    uint32_t v = 0;
+    tourIndex = 0;
+    recordVisit(v, depth);
+    tin[v] = timer++;
+    for (;;) {
+        if (tree->links[v].firstChild != NO_NODE) {
+            // Descend to the first child
+            v = tree->links[v].firstChild;
+            recordVisit(v, ++depth);
+            tin[v] = timer++;
+            continue;
+        }
+        // Climb out of finished subtrees until one has a next sibling
+        for (;;) {
+            tout[v] = timer - 1;
+            if (v == 0) return;
+            uint32_t sibling = tree->links[v].nextSibling;
+            v = tree->links[v].parent;
+            recordVisit(v, --depth);
+            if (sibling != NO_NODE) {
+                v = sibling;
+                recordVisit(v, ++depth);
+                tin[v] = timer++;
+                break;
+            }
+        }
+    }
+}
+
+// Parallel construction by list ranking. Every non-root node v owns two
+// tour edges: 2v goes down into v and 2v + 1 climbs back out of it. The
+// successor of an edge follows from the links alone, so the edge list is
+// never materialized. The down and up edges of every TOUR_RULER_SPACING-th
+// node are rulers that cut the list into sublists. Pass one walks each
+// sublist in parallel and measures its length, depth change and number of
+// down edges. A serial scan over the sublists in list order turns these
+// into each sublist's starting rank, depth and preorder index. Pass two
+// re-walks the sublists in parallel and writes tour, tin and tout.
+#define TOUR_RULER_SPACING 256
+#define NO_EDGE UINT32_MAX
+
+typedef struct TourSublist {
+    uint32_t first;      // first edge, NO_EDGE for an unused slot
+    uint32_t next;       // slot of the following sublist, NO_EDGE at the end
+    int length;
+    int depthDelta;
+    int downs;
+    int rank;            // values before the first edge, set by the scan
+    int depth;
+    int preorder;
+} TourSublist;
+
+typedef struct ParallelTour {
+    const Tree* tree;
+    TourSublist* sublists;
+    uint32_t numSlots;
+} ParallelTour;
+
+typedef struct WorkerTask {
+    void* ctx;
+    int id;
+    int count;
+} WorkerTask;
+
+// Run fn on numTasks tasks, the first on the calling thread
+static void runTasks(void* (*fn)(void*), void* ctx, int numTasks) {
+    WorkerTask* tasks = (WorkerTask*)xmalloc((size_t)numTasks * sizeof(WorkerTask));
+    pthread_t* threads = (pthread_t*)xmalloc((size_t)numTasks * sizeof(pthread_t));
+    for (int t = 0; t < numTasks; t++) {
+        tasks[t].ctx = ctx;
+        tasks[t].id = t;
+        tasks[t].count = numTasks;
+    }
+    for (int t = 1; t < numTasks; t++) {
+        if (pthread_create(&threads[t], NULL, fn, &tasks[t]) != 0) {
+            fprintf(stderr, "Failed to start worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fn(&tasks[0]);
+    for (int t = 1; t < numTasks; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    free(tasks);
+}
+
+static inline uint32_t tourSuccessor(const Tree* tree, uint32_t e) {
+    const TreeLinks* l = &tree->links[e >> 1];
+    if (!(e & 1)) return l->firstChild != NO_NODE ? 2 * l->firstChild : e + 1;
+    if (l->nextSibling != NO_NODE) return 2 * l->nextSibling;
+    return l->parent != 0 ? 2 * l->parent + 1 : NO_EDGE;
+}
+
+// Sublist slot of a ruler edge, NO_EDGE for any other edge
+static inline uint32_t rulerSlot(uint32_t e) {
+    uint32_t v = e >> 1;
+    return v % TOUR_RULER_SPACING == 0 ? 2 * (v / TOUR_RULER_SPACING) + (e & 1) : NO_EDGE;
+}
+
+static void* measureSublists(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    ParallelTour* pt = (ParallelTour*)task->ctx;
+    for (uint32_t slot = (uint32_t)task->id; slot < pt->numSlots; slot += (uint32_t)task->count) {
+        TourSublist* s = &pt->sublists[slot];
+        if (s->first == NO_EDGE) continue;
+        uint32_t e = s->first;
+        int length = 0, downs = 0;
+        do {
+            length++;
+            downs += !(e & 1);
+            e = tourSuccessor(pt->tree, e);
+        } while (e != NO_EDGE && rulerSlot(e) == NO_EDGE);
+        s->next = e == NO_EDGE ? NO_EDGE : rulerSlot(e);
+        s->length = length;
+        s->downs = downs;
+        s->depthDelta = 2 * downs - length;
+    }
+    return NULL;
+}
+
+static void* writeSublists(void* arg) {
+    WorkerTask* task = (WorkerTask*)arg;
+    ParallelTour* pt = (ParallelTour*)task->ctx;
+    const TreeLinks* links = pt->tree->links;
+    for (uint32_t slot = (uint32_t)task->id; slot < pt->numSlots; slot += (uint32_t)task->count) {
+        const TourSublist* s = &pt->sublists[slot];
+        if (s->first == NO_EDGE) continue;
+        uint32_t e = s->first;
+        int pos = s->rank + 1, depth = s->depth, preorder = s->preorder;
+        for (int i = 0; i < s->length; i++, pos++) {
+            uint32_t v = e >> 1;
+            if (e & 1) {
+                tout[v] = preorder;
+                tour[pos].node = (int)links[v].parent;
+                tour[pos].depth = --depth;
+            } else {
+                tin[v] = ++preorder;
+                tour[pos].node = (int)v;
+                tour[pos].depth = ++depth;
+            }
+            e = tourSuccessor(pt->tree, e);
+        }
+    }
+    return NULL;
+}
 
-    // Traverse all children
-    TreeNode* child = root->firstChild;
-    while (child != NULL) {
-        eulerTour(child, depth + 1);
-        child = child->nextSibling;
+// Same result as eulerTour, built by numThreads threads
+void eulerTourParallel(const Tree* tree, int numThreads) {
+    uint32_t n = tree->size;
+    tour[0].node = 0;
+    tour[0].depth = 0;
+    tin[0] = 0;
+    tout[0] = (int)n - 1;
+    tourIndex = 2 * (int)n - 1;
+    if (n == 1) return;
+    if (numThreads < 1) numThreads = 1;
+
+    // Slot 2k / 2k + 1 holds the sublist starting at the down / up edge of
+    // node k * TOUR_RULER_SPACING; the last slot is for the head of the
+    // list unless that edge is a ruler itself
+    ParallelTour pt;
+    pt.tree = tree;
+    pt.numSlots = 2 * ((n - 1) / TOUR_RULER_SPACING + 1) + 1;
+    pt.sublists = (TourSublist*)xmalloc(pt.numSlots * sizeof(TourSublist));
+    for (uint32_t slot = 0; slot < pt.numSlots; slot++) {
+        uint32_t v = slot / 2 * TOUR_RULER_SPACING;
+        pt.sublists[slot].first = v > 0 && v < n ? 2 * v + (slot & 1) : NO_EDGE;
+    }
+    uint32_t head = 2 * tree->links[0].firstChild;
+    uint32_t headSlot = rulerSlot(head);
+    if (headSlot == NO_EDGE) {
+        headSlot = pt.numSlots - 1;
+        pt.sublists[headSlot].first = head;
+    }
 
-        // Record the current node again after returning from a child
-        tour[tourIndex].node = root->data;
-        tour[tourIndex].depth = depth;
-        tourIndex++;
+    runTasks(measureSublists, &pt, numThreads);
+    int rank = 0, depth = 0, preorder = 0;
+    for (uint32_t slot = headSlot; slot != NO_EDGE; slot = pt.sublists[slot].next) {
+        TourSublist* s = &pt.sublists[slot];
+        s->rank = rank;
+        s->depth = depth;
+        s->preorder = preorder;
+        rank += s->length;
+        depth += s->depthDelta;
+        preorder += s->downs;
     }
+    runTasks(writeSublists, &pt, numThreads);
+    free(pt.sublists);
 }
 
 // Function to print the Euler tour
-void printEulerTour() {
+void printEulerTour(const Tree* tree) {
     printf("Euler Tour:\n");
     for (int i = 0; i < tourIndex; i++) {
-        printf("Node: %d, Depth: %d\n", tour[i].node, tour[i].depth);
+        printf("Node: %d, Depth: %d\n", tree->data[tour[i].node], tour[i].depth);
     }
 }
 
-// Function to process subtree queries (example: count nodes in a subtree)
-int countNodesInSubtree(int start, int end) {
-    int count = 0;
-    for (int i = start; i <= end; i++) {
-        if (tour[i].node == tour[start].node) {
-            count++;
+// LCA queries by range minimum over the tour depths: the LCA of u and v is
+// the shallowest node between their first occurrences. The tour is cut
+// into LCA_BLOCK-entry blocks. A sparse table over block minima covers the
+// whole blocks of a query. Inside a block, bit j of mask[i] marks position
+// j <= i when its depth is below every depth in (j, i], so the minimum of
+// [l, i] is the lowest marked position >= l (one ctz). Preprocessing and
+// memory are O(n) and a query is O(1).
+static inline int shallower(const EulerTour* t, int a, int b) {
+    return t[b].depth < t[a].depth ? b : a;
+}
+
+// Index the tour array; it must stay alive and unchanged while in use
+void buildLcaIndex(LcaIndex* index, const EulerTour* t, int length) {
+    memset(index, 0, sizeof(*index));
+    index->tour = t;
+    index->length = length;
+    index->maxNode = -1;
+    for (int i = 0; i < length; i++) {
+        if (t[i].node > index->maxNode) index->maxNode = t[i].node;
+    }
+    index->first = (int*)xmalloc((size_t)(index->maxNode + 1) * sizeof(int));
+    for (int i = length - 1; i >= 0; i--) index->first[t[i].node] = i;
+
+    index->numBlocks = (length + LCA_BLOCK - 1) / LCA_BLOCK;
+    index->levels = 1;
+    while ((1 << index->levels) <= index->numBlocks) index->levels++;
+    index->mask = (uint32_t*)xmalloc((size_t)length * sizeof(uint32_t));
+    index->sparse = (int*)xmalloc((size_t)index->levels * index->numBlocks * sizeof(int));
+
+    for (int b = 0; b < index->numBlocks; b++) {
+        int begin = b * LCA_BLOCK;
+        int end = begin + LCA_BLOCK < length ? begin + LCA_BLOCK : length;
+        uint32_t stack = 0;
+        for (int i = begin; i < end; i++) {
+            // Drop candidates no shallower than position i
+            while (stack != 0) {
+                int top = begin + 31 - __builtin_clz(stack);
+                if (t[top].depth < t[i].depth) break;
+                stack ^= 1u << (top - begin);
+            }
+            stack |= 1u << (i - begin);
+            index->mask[i] = stack;
+        }
+        // The block minimum is the lowest candidate left at its end
+        index->sparse[b] = begin + __builtin_ctz(index->mask[end - 1]);
+    }
+    for (int level = 1; level < index->levels; level++) {
+        const int* below = index->sparse + (size_t)(level - 1) * index->numBlocks;
+        int* row = index->sparse + (size_t)level * index->numBlocks;
+        int half = 1 << (level - 1);
+        for (int b = 0; b + (1 << level) <= index->numBlocks; b++) {
+            row[b] = shallower(t, below[b], below[b + half]);
         }
     }
-    return count;
 }
 
-int main() {
+void freeLcaIndex(LcaIndex* index) {
+    free(index->first);
+    free(index->mask);
+    free(index->sparse);
+    memset(index, 0, sizeof(*index));
+}
+
+// Shallowest position in [l, r], both in the same block
+static inline int blockMinimum(const LcaIndex* index, int l, int r) {
+    int begin = l & ~(LCA_BLOCK - 1);
+    return begin + __builtin_ctz(index->mask[r] & (~0u << (l - begin)));
+}
+
+// Shallowest tour position in [l, r]
+int tourMinimum(const LcaIndex* index, int l, int r) {
+    int lb = l / LCA_BLOCK, rb = r / LCA_BLOCK;
+    if (lb == rb) return blockMinimum(index, l, r);
+    int best = shallower(index->tour, blockMinimum(index, l, lb * LCA_BLOCK + LCA_BLOCK - 1),
+                         blockMinimum(index, rb * LCA_BLOCK, r));
+    if (lb + 1 < rb) {
+        int level = 31 - __builtin_clz((unsigned)(rb - lb - 1));
+        const int* row = index->sparse + (size_t)level * index->numBlocks;
+        best = shallower(index->tour, best, shallower(index->tour, row[lb + 1], row[rb - (1 << level)]));
+    }
+    return best;
+}
+
+// Lowest common ancestor of nodes u and v, or -1 if either is not in the tree
+int lca(const LcaIndex* index, int u, int v) {
+    if (u < 0 || v < 0 || u > index->maxNode || v > index->maxNode) return -1;
+    int a = index->first[u], b = index->first[v];
+    return index->tour[a < b ? tourMinimum(index, a, b) : tourMinimum(index, b, a)].node;
+}
+
+// Answer count queries: out[i] = lca(u[i], v[i]). The first-occurrence
+// lookups of later queries are prefetched to overlap their cache misses.
+void lcaBatch(const LcaIndex* index, const int* u, const int* v, int* out, size_t count) {
+    const size_t ahead = 16;
+    for (size_t i = 0; i < count; i++) {
+        if (i + ahead < count) {
+            int pu = u[i + ahead], pv = v[i + ahead];
+            if (pu >= 0 && pu <= index->maxNode) __builtin_prefetch(&index->first[pu]);
+            if (pv >= 0 && pv <= index->maxNode) __builtin_prefetch(&index->first[pv]);
+        }
+        out[i] = lca(index, u[i], v[i]);
+    }
+}
+
+// Offline LCA (Tarjan) for a batch of queries known up front:
+// out[i] = LCA(u[i], v[i]), or -1 when either node is not in the tree.
+// A first walk numbers the nodes in preorder. Each query is then stored
+// once, counting-sorted under the preorder number of whichever endpoint
+// the walk enters later, so a second walk reads the buckets in order and
+// can answer every query as soon as it reaches the query's bucket. A
+// union-find over the nodes maps each entered node to its lowest ancestor
+// that is still open (on the current root path): an entered node points
+// at itself and, once finished, at its parent. That ancestor is the LCA
+// with the node being entered. Finds use path halving. Peak scratch memory
+// is 8 bytes per node and 8 per query, and nothing is kept afterwards.
+// count must stay below 2^32.
+typedef struct OfflineQuery {
+    uint32_t earlier;   // the endpoint entered first
+    uint32_t id;
+} OfflineQuery;
+
+static inline uint32_t findOpenAncestor(uint32_t* uf, uint32_t x) {
+    while (uf[x] != x) {
+        uf[x] = uf[uf[x]];
+        x = uf[x];
+    }
+    return x;
+}
+
+// Next node of a preorder walk after x, NO_NODE when the walk is done
+static inline uint32_t preorderNext(const TreeLinks* links, uint32_t x) {
+    if (links[x].firstChild != NO_NODE) return links[x].firstChild;
+    while (x != 0 && links[x].nextSibling == NO_NODE) x = links[x].parent;
+    return x == 0 ? NO_NODE : links[x].nextSibling;
+}
+
+void lcaOffline(const Tree* tree, const int* u, const int* v, int* out, size_t count) {
+    uint32_t n = tree->size;
+    const TreeLinks* links = tree->links;
+    uint32_t* pre = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    uint32_t k = 0;
+    for (uint32_t x = 0; x != NO_NODE; x = preorderNext(links, x)) pre[x] = k++;
+
+    // Until the walk, out holds each query's bucket with the top bit set
+    // when u is the later endpoint (n < 2^31 leaves the bit free), so the
+    // scatter pass need not look up pre again
+    uint32_t* key = (uint32_t*)out;
+    uint32_t* offsets = (uint32_t*)xmalloc(((size_t)n + 1) * sizeof(uint32_t));
+    memset(offsets, 0, ((size_t)n + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) {
+        if ((uint32_t)u[i] < n && (uint32_t)v[i] < n) {
+            uint32_t pu = pre[u[i]], pv = pre[v[i]];
+            key[i] = pu > pv ? pu | 0x80000000u : pv;
+            offsets[(key[i] & 0x7fffffffu) + 1]++;
+        } else {
+            out[i] = -1;
+        }
+    }
+    free(pre);
+    for (uint32_t x = 0; x < n; x++) offsets[x + 1] += offsets[x];
+    OfflineQuery* byNode = (OfflineQuery*)xmalloc((size_t)offsets[n] * sizeof(OfflineQuery));
+    // uf doubles as the fill cursor of each bucket until the walk
+    uint32_t* uf = (uint32_t*)xmalloc((size_t)n * sizeof(uint32_t));
+    memcpy(uf, offsets, (size_t)n * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) {
+        if ((uint32_t)u[i] >= n || (uint32_t)v[i] >= n) continue;
+        OfflineQuery q = { (uint32_t)(key[i] >> 31 ? v[i] : u[i]), (uint32_t)i };
+        byNode[uf[key[i] & 0x7fffffffu]++] = q;
+    }
+
+    k = 0;
+    for (uint32_t x = 0;; k++) {
+        // Enter x and answer the queries it completes
+        uf[x] = x;
+        for (uint32_t q = offsets[k]; q < offsets[k + 1]; q++) {
+            out[byNode[q].id] = (int)findOpenAncestor(uf, byNode[q].earlier);
+        }
+        if (links[x].firstChild != NO_NODE) {
+            x = links[x].firstChild;
+            continue;
+        }
+        // Finish x and its ancestors until one has a next sibling
+        while (x != 0 && links[x].nextSibling == NO_NODE) {
+            uf[x] = links[x].parent;
+            x = links[x].parent;
+        }
+        if (x == 0) break;
+        uf[x] = links[x].parent;
+        x = links[x].nextSibling;
+    }
+    free(byNode);
+    free(uf);
+    free(offsets);
+}
+
+// Subtree aggregates: a Fenwick tree indexed by entry time, so the values
+// of a subtree are contiguous. values is indexed by node. Built in O(n).
+void buildSubtreeSums(SubtreeSums* sums, const long long* values) {
+    sums->size = (tourIndex + 1) / 2;
+    sums->tree = (long long*)xmalloc(((size_t)sums->size + 1) * sizeof(long long));
+    sums->tree[0] = 0;
+    for (int v = 0; v < sums->size; v++) sums->tree[tin[v] + 1] = values[v];
+    for (int i = 1; i <= sums->size; i++) {
+        int parent = i + (i & -i);
+        if (parent <= sums->size) sums->tree[parent] += sums->tree[i];
+    }
+}
+
+void freeSubtreeSums(SubtreeSums* sums) {
+    free(sums->tree);
+    sums->tree = NULL;
+    sums->size = 0;
+}
+
+// Add delta to the value of a node, O(log n)
+void addToNode(SubtreeSums* sums, int node, long long delta) {
+    for (int i = tin[node] + 1; i <= sums->size; i += i & -i) sums->tree[i] += delta;
+}
+
+// Sum of the first count entries in preorder
+static long long prefixSum(const SubtreeSums* sums, int count) {
+    long long total = 0;
+    for (int i = count; i > 0; i -= i & -i) total += sums->tree[i];
+    return total;
+}
+
+// Sum of the values in the subtree of a node, O(log n)
+long long subtreeSum(const SubtreeSums* sums, int node) {
+    return prefixSum(sums, tout[node] + 1) - prefixSum(sums, tin[node]);
+}
+
+#ifndef EULER_TREE_NO_MAIN
+// Demo and benchmarks. Build with -DEULER_TREE_NO_MAIN to link the tree
+// code into another program, such as euler_tree_test.c.
+
+static size_t lcaIndexBytes(const LcaIndex* index) {
+    return (size_t)(index->maxNode + 1) * sizeof(int) + (size_t)index->length * sizeof(uint32_t) +
+           (size_t)index->levels * index->numBlocks * sizeof(int);
+}
+
+static double elapsedSeconds(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Random recursive tree: node i hangs under a uniformly chosen earlier
+// node, so parents precede children and depth fills in one pass
+static void randomTree(Tree* tree, int numNodes, int* depth) {
+    initTree(tree, 0, (uint32_t)numNodes);
+    if (depth) depth[0] = 0;
+    for (int i = 1; i < numNodes; i++) {
+        uint32_t p = (uint32_t)(rand() % i);
+        addChild(tree, p, i);
+        if (depth) depth[i] = depth[p] + 1;
+    }
+}
+
+// Degenerate tree for stressing depth: a single path of numNodes nodes
+static void pathTree(Tree* tree, int numNodes) {
+    initTree(tree, 0, (uint32_t)numNodes);
+    for (int i = 1; i < numNodes; i++) addChild(tree, (uint32_t)(i - 1), i);
+}
+
+static int naiveLca(const Tree* tree, const int* depth, int u, int v) {
+    while (depth[u] > depth[v]) u = (int)tree->links[u].parent;
+    while (depth[v] > depth[u]) v = (int)tree->links[v].parent;
+    while (u != v) {
+        u = (int)tree->links[u].parent;
+        v = (int)tree->links[v].parent;
+    }
+    return u;
+}
+
+// Benchmark: preprocess a random tree and answer random LCA queries in one
+// batch, checking a sample against parent-pointer climbing
+static int benchmarkLca(int numNodes, long long numQueries) {
+    srand(42);
+    int* depth = (int*)xmalloc((size_t)numNodes * sizeof(int));
+    Tree tree;
+    randomTree(&tree, numNodes, depth);
+    allocateTour(numNodes);
+    eulerTour(&tree);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    LcaIndex index;
+    buildLcaIndex(&index, tour, tourIndex);
+    double buildSeconds = elapsedSeconds(&start);
+
+    int* u = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    int* v = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    int* out = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    for (long long i = 0; i < numQueries; i++) {
+        u[i] = rand() % numNodes;
+        v[i] = rand() % numNodes;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lcaBatch(&index, u, v, out, (size_t)numQueries);
+    double querySeconds = elapsedSeconds(&start);
+
+    int errors = 0;
+    for (long long i = 0; i < numQueries && i < 100000; i++) {
+        if (out[i] != naiveLca(&tree, depth, u[i], v[i])) errors++;
+    }
+    printf("LCA: %d nodes, tour %d entries, index %.1f MB built in %.3f s\n", numNodes, tourIndex,
+           lcaIndexBytes(&index) / 1048576.0, buildSeconds);
+    printf("  %lld queries in %.3f s: %.1f M queries/s, %.1f ns/query; %d mismatches in the checked sample\n",
+           numQueries, querySeconds, numQueries / querySeconds / 1e6, querySeconds * 1e9 / numQueries, errors);
+    freeLcaIndex(&index);
+    freeTree(&tree);
+    free(u);
+    free(v);
+    free(out);
+    free(depth);
+    return errors == 0 ? 0 : -1;
+}
+
+// Benchmark: the same random queries answered online through the RMQ index
+// (tour and index build included) and offline by Tarjan's algorithm
+static int benchmarkOfflineLca(int numNodes, long long numQueries) {
+    srand(42);
+    Tree tree;
+    randomTree(&tree, numNodes, NULL);
+    int* u = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    int* v = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    int* online = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    int* offline = (int*)xmalloc((size_t)numQueries * sizeof(int));
+    for (long long i = 0; i < numQueries; i++) {
+        u[i] = rand() % numNodes;
+        v[i] = rand() % numNodes;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    allocateTour(numNodes);
+    eulerTour(&tree);
+    LcaIndex index;
+    buildLcaIndex(&index, tour, tourIndex);
+    double buildSeconds = elapsedSeconds(&start);
+    lcaBatch(&index, u, v, online, (size_t)numQueries);
+    double onlineSeconds = elapsedSeconds(&start);
+    size_t onlineBytes = lcaIndexBytes(&index) + (size_t)tourIndex * sizeof(EulerTour) + 2 * (size_t)numNodes * sizeof(int);
+    freeLcaIndex(&index);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lcaOffline(&tree, u, v, offline, (size_t)numQueries);
+    double offlineSeconds = elapsedSeconds(&start);
+    size_t offlineBytes = 2 * ((size_t)numNodes + 1) * sizeof(uint32_t) + (size_t)numQueries * sizeof(OfflineQuery);
+
+    long long mismatches = 0;
+    for (long long i = 0; i < numQueries; i++) mismatches += online[i] != offline[i];
+    printf("LCA of %lld random queries on a %d-node random tree:\n", numQueries, numNodes);
+    printf("  online RMQ: %.3f s (%.3f s tour + index), %.1f M queries/s overall, %.1f MB tour + index\n",
+           onlineSeconds, buildSeconds, numQueries / onlineSeconds / 1e6, onlineBytes / 1048576.0);
+    printf("  offline Tarjan: %.3f s, %.1f M queries/s, %.1f MB peak scratch; %lld mismatches\n", offlineSeconds,
+           numQueries / offlineSeconds / 1e6, offlineBytes / 1048576.0, mismatches);
+    freeTree(&tree);
+    free(u);
+    free(v);
+    free(online);
+    free(offline);
+    return mismatches == 0 ? 0 : -1;
+}
+
+// Benchmark: random subtree-sum queries and point updates, interleaved
+static void benchmarkSubtree(int numNodes, long long numOps) {
+    srand(42);
+    Tree tree;
+    randomTree(&tree, numNodes, NULL);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    allocateTour(numNodes);
+    eulerTour(&tree);
+    double tourSeconds = elapsedSeconds(&start);
+    freeTree(&tree);
+
+    long long* values = (long long*)xmalloc((size_t)numNodes * sizeof(long long));
+    for (int v = 0; v < numNodes; v++) values[v] = rand() % 100;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SubtreeSums sums;
+    buildSubtreeSums(&sums, values);
+    double buildSeconds = elapsedSeconds(&start);
+    free(values);
+
+    // Pre-draw the operations so the timed loop is only the tree work
+    int* nodes = (int*)xmalloc((size_t)numOps * sizeof(int));
+    for (long long i = 0; i < numOps; i++) nodes[i] = rand() % numNodes;
+    long long checksum = 0, sizes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long long i = 0; i < numOps; i++) {
+        if (i & 1) {
+            checksum += subtreeSum(&sums, nodes[i]);
+            sizes += subtreeSize(nodes[i]);
+        } else {
+            addToNode(&sums, nodes[i], (i & 2) ? 1 : -1);
+        }
+    }
+    double opSeconds = elapsedSeconds(&start);
+    printf("Subtree sums: %d nodes, tour and tin/tout in %.3f s, Fenwick tree %.1f MB built in %.3f s\n", numNodes,
+           tourSeconds, (sums.size + 1) * sizeof(long long) / 1048576.0, buildSeconds);
+    printf("  %lld ops (half updates, half sum + size queries) in %.3f s: %.1f M ops/s, %.1f ns/op"
+           " (checksum %lld, %lld)\n",
+           numOps, opSeconds, numOps / opSeconds / 1e6, opSeconds * 1e9 / numOps, checksum, sizes);
+    freeSubtreeSums(&sums);
+    free(nodes);
+}
+
+// Benchmark: arena build and iterative tour of a random tree, then the
+// tour of a single path as deep as the tree is large
+static void benchmarkTree(int numNodes) {
+    srand(42);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Tree tree;
+    randomTree(&tree, numNodes, NULL);
+    double buildSeconds = elapsedSeconds(&start);
+    size_t arenaBytes = (size_t)tree.capacity * TREE_BYTES_PER_NODE;
+    allocateTour(numNodes);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eulerTour(&tree);
+    double tourSeconds = elapsedSeconds(&start);
+    freeTree(&tree);
+    printf("Random tree: %d nodes built in %.3f s (%.1f ns/node, arena %.1f MB), toured in %.3f s (%.1f ns/node)\n",
+           numNodes, buildSeconds, buildSeconds * 1e9 / numNodes, arenaBytes / 1048576.0, tourSeconds,
+           tourSeconds * 1e9 / numNodes);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pathTree(&tree, numNodes);
+    buildSeconds = elapsedSeconds(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eulerTour(&tree);
+    tourSeconds = elapsedSeconds(&start);
+    freeTree(&tree);
+    printf("Path of depth %d: built in %.3f s, toured in %.3f s (deepest entry depth %d)\n", numNodes - 1,
+           buildSeconds, tourSeconds, tour[numNodes - 1].depth);
+}
+
+// Benchmark: serial tour against the list-ranking tour at 1, 2, 4, ...
+// threads on the same random tree, checking that the results agree
+static int benchmarkParallelTour(int numNodes, int maxThreads) {
+    srand(42);
+    Tree tree;
+    randomTree(&tree, numNodes, NULL);
+    allocateTour(numNodes);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eulerTour(&tree);
+    double serialSeconds = elapsedSeconds(&start);
+    size_t tourBytes = (size_t)tourIndex * sizeof(EulerTour);
+    EulerTour* serialTour = (EulerTour*)xmalloc(tourBytes);
+    int* serialTin = (int*)xmalloc((size_t)numNodes * sizeof(int));
+    memcpy(serialTour, tour, tourBytes);
+    memcpy(serialTin, tin, (size_t)numNodes * sizeof(int));
+    printf("Tour of a random tree with %d nodes: serial %.3f s\n", numNodes, serialSeconds);
+
+    int mismatches = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        eulerTourParallel(&tree, threads);
+        double seconds = elapsedSeconds(&start);
+        int same = memcmp(serialTour, tour, tourBytes) == 0 &&
+                   memcmp(serialTin, tin, (size_t)numNodes * sizeof(int)) == 0;
+        mismatches += !same;
+        printf("  list ranking, %2d threads: %.3f s, %.2fx serial%s\n", threads, seconds, serialSeconds / seconds,
+               same ? "" : " (MISMATCH)");
+    }
+    freeTree(&tree);
+    free(serialTour);
+    free(serialTin);
+    return mismatches == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench-parallel-tour") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 100000000;
+        int maxThreads = argc > 3 ? atoi(argv[3]) : 32;
+        if (numNodes < 1 || maxThreads < 1) {
+            fprintf(stderr, "usage: euler_tree --bench-parallel-tour [nodes] [max threads]\n");
+            return 1;
+        }
+        return benchmarkParallelTour(numNodes, maxThreads) == 0 ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-tree") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 50000000;
+        if (numNodes < 1) {
+            fprintf(stderr, "usage: euler_tree --bench-tree [nodes]\n");
+            return 1;
+        }
+        benchmarkTree(numNodes);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-subtree") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 10000000;
+        long long numOps = argc > 3 ? atoll(argv[3]) : 10000000;
+        if (numNodes < 1 || numOps < 1) {
+            fprintf(stderr, "usage: euler_tree --bench-subtree [nodes] [ops]\n");
+            return 1;
+        }
+        benchmarkSubtree(numNodes, numOps);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-lca-offline") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 10000000;
+        long long numQueries = argc > 3 ? atoll(argv[3]) : 100000000;
+        if (numNodes < 1 || numQueries < 1) {
+            fprintf(stderr, "usage: euler_tree --bench-lca-offline [nodes] [queries]\n");
+            return 1;
+        }
+        return benchmarkOfflineLca(numNodes, numQueries) == 0 ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-lca") == 0) {
+        int numNodes = argc > 2 ? atoi(argv[2]) : 10000000;
+        long long numQueries = argc > 3 ? atoll(argv[3]) : 10000000;
+        if (numNodes < 1 || numQueries < 1) {
+            fprintf(stderr, "usage: euler_tree --bench-lca [nodes] [queries]\n");
+            return 1;
+        }
+        return benchmarkLca(numNodes, numQueries) == 0 ? 0 : 1;
+    }
+
     // Create a sample tree
-    TreeNode* root = createNode(1);
-    addChild(root, 2);
-    addChild(root, 3);
-    addChild(root->firstChild, 4);
-    addChild(root->firstChild, 5);
-    addChild(root->firstChild->nextSibling, 6);
+    Tree tree;
+    initTree(&tree, 1, 6);
+    uint32_t n2 = addChild(&tree, 0, 2);
+    uint32_t n3 = addChild(&tree, 0, 3);
+    uint32_t n4 = addChild(&tree, n2, 4);
+    uint32_t n5 = addChild(&tree, n2, 5);
+    uint32_t n6 = addChild(&tree, n3, 6);
 
     /*
     The tree looks like this:
         1
-       /|\
-      2 3 6
-      / \
-     4   5
+       / \
+      2   3
+     / \   \
+    4   5   6
     */
 
     // Perform Euler tour starting from the root
-    eulerTour(root, 0);
+    allocateTour((int)tree.size);
+    eulerTour(&tree);
 
     // Print the Euler tour
-    printEulerTour();
+    printEulerTour(&tree);
 
     // Example: Count nodes in the subtree rooted at node 2
-    int start = 0, end = 0;
-    for (int i = 0; i < tourIndex; i++) {
-        if (tour[i].node == 2) {
-            start = i;
-            break;
-        }
-    }
-    for (int i = start; i < tourIndex; i++) {
-        if (tour[i].node == 2 && tour[i].depth == tour[start].depth) {
-            end = i;
-        }
+    printf("Number of nodes in the subtree rooted at node 2: %d\n", subtreeSize((int)n2));
+
+    // Example: subtree sums with each node's value equal to its data
+    long long values[6];
+    for (uint32_t v = 0; v < tree.size; v++) values[v] = tree.data[v];
+    SubtreeSums sums;
+    buildSubtreeSums(&sums, values);
+    printf("Sum of the subtree rooted at node 2: %lld\n", subtreeSum(&sums, (int)n2));
+    addToNode(&sums, (int)n5, 10);
+    printf("After adding 10 to node 5: %lld (whole tree %lld)\n", subtreeSum(&sums, (int)n2),
+           subtreeSum(&sums, 0));
+    freeSubtreeSums(&sums);
+
+    // Example: lowest common ancestors
+    LcaIndex index;
+    buildLcaIndex(&index, tour, tourIndex);
+    int queryU[] = { (int)n4, (int)n4, (int)n5, (int)n6 };
+    int queryV[] = { (int)n5, (int)n6, (int)n2, (int)n6 };
+    int answers[4];
+    lcaBatch(&index, queryU, queryV, answers, 4);
+    for (int i = 0; i < 4; i++) {
+        printf("LCA(%d, %d) = %d\n", tree.data[queryU[i]], tree.data[queryV[i]], tree.data[answers[i]]);
     }
-    int subtreeNodeCount = countNodesInSubtree(start, end);
-    printf("Number of nodes in the subtree rooted at node 2: %d\n", subtreeNodeCount);
+    freeLcaIndex(&index);
 
+    freeTree(&tree);
+    free(tour);
+    free(tin);
+    free(tout);
     return 0;
 }
+#endif
@@ -0,0 +1,89 @@
+#ifndef EULER_TREE_H
+#define EULER_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NO_NODE UINT32_MAX
+
+// Links of one node as 32-bit node indices, kept together so a step of
+// the tour touches a single cache line
+typedef struct TreeLinks {
+    uint32_t parent;        // NO_NODE for the root
+    uint32_t firstChild;    // NO_NODE for a leaf
+    uint32_t lastChild;     // makes appending a child O(1)
+    uint32_t nextSibling;
+} TreeLinks;
+
+// Structure to represent a tree: arrays indexed by node, both carved from
+// one arena block. Nodes are numbered in insertion order and the root is
+// node 0.
+typedef struct Tree {
+    uint32_t size;
+    uint32_t capacity;
+    void* arena;
+    TreeLinks* links;
+    int* data;
+} Tree;
+
+#define TREE_BYTES_PER_NODE (sizeof(TreeLinks) + sizeof(int))
+
+// Structure to represent an Euler tour
+typedef struct EulerTour {
+    int node; // Node index
+    int depth; // Depth of the node in the tree
+} EulerTour;
+
+// Global variables filled by eulerTour
+extern EulerTour* tour;     // Array to store the Euler tour, 2 * nodes - 1 entries
+extern int tourIndex;       // Index for the Euler tour array
+extern int* tin;            // node -> preorder index (entry time)
+extern int* tout;           // node -> last preorder index in its subtree (exit time)
+
+void initTree(Tree* tree, int rootData, uint32_t capacity);
+uint32_t addChild(Tree* tree, uint32_t parent, int childData);
+void freeTree(Tree* tree);
+void allocateTour(int numNodes);
+void eulerTour(const Tree* tree);
+void eulerTourParallel(const Tree* tree, int numThreads);
+void printEulerTour(const Tree* tree);
+
+// The subtree of v is the preorder interval [tin[v], tout[v]]
+static inline int subtreeSize(int node) {
+    return tout[node] - tin[node] + 1;
+}
+
+// LCA by range minimum over the tour depths (see euler_tree.c)
+#define LCA_BLOCK 32
+
+typedef struct LcaIndex {
+    const EulerTour* tour;
+    int length;
+    int maxNode;
+    int* first;          // node -> first tour position
+    uint32_t* mask;      // tour position -> in-block minimum candidates
+    int numBlocks;
+    int levels;
+    int* sparse;         // levels x numBlocks tour positions of range minima
+} LcaIndex;
+
+void buildLcaIndex(LcaIndex* index, const EulerTour* t, int length);
+void freeLcaIndex(LcaIndex* index);
+int tourMinimum(const LcaIndex* index, int l, int r);
+int lca(const LcaIndex* index, int u, int v);
+void lcaBatch(const LcaIndex* index, const int* u, const int* v, int* out, size_t count);
+void lcaOffline(const Tree* tree, const int* u, const int* v, int* out, size_t count);
+
+// Fenwick tree over preorder positions: node values with O(log n) point
+// updates and subtree sums (a count when values are 0/1)
+typedef struct SubtreeSums {
+    int size;
+    long long* tree;     // 1-based Fenwick array
+} SubtreeSums;
+
+void buildSubtreeSums(SubtreeSums* sums, const long long* values);
+void freeSubtreeSums(SubtreeSums* sums);
+void addToNode(SubtreeSums* sums, int node, long long delta);
+long long subtreeSum(const SubtreeSums* sums, int node);
+
+#endif
@@ -0,0 +1,181 @@
+// euler_tree_test.c: randomized checks of the tour-based queries against
+// brute force on explicit parent arrays.
+//   gcc -O2 -pthread -DEULER_TREE_NO_MAIN -o euler_tree_test euler_tree.c euler_tree_test.c
+#include "euler_tree.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum Shape { RANDOM, PATH, STAR, CATERPILLAR, NUM_SHAPES };
+
+// Build a tree of n nodes with random data; parent mirrors the tree's own
+// links as plain ints (-1 for the root)
+static void buildTree(Tree* tree, int n, enum Shape shape, int* parent) {
+    initTree(tree, rand(), 1 + (uint32_t)(rand() % 4)); // small capacity exercises growth
+    parent[0] = -1;
+    for (int i = 1; i < n; i++) {
+        int p;
+        switch (shape) {
+            case PATH: p = i - 1; break;
+            case STAR: p = 0; break;
+            case CATERPILLAR: p = (i & 1) ? i - 1 : (i >= 2 ? i - 2 : 0); break;
+            default: p = rand() % i; break;
+        }
+        uint32_t child = addChild(tree, (uint32_t)p, rand());
+        assert(child == (uint32_t)i);
+        parent[i] = p;
+    }
+}
+
+static int isAncestor(const int* parent, int a, int v) {
+    for (; v >= 0; v = parent[v]) {
+        if (v == a) return 1;
+    }
+    return 0;
+}
+
+static int naiveLca(const int* parent, int u, int v) {
+    for (; u >= 0; u = parent[u]) {
+        if (isAncestor(parent, u, v)) return u;
+    }
+    return -1;
+}
+
+// The parallel tour must reproduce the serial one exactly
+static void checkParallelTour(const Tree* tree, int numThreads) {
+    int n = (int)tree->size;
+    EulerTour* serialTour = (EulerTour*)malloc((size_t)(2 * n - 1) * sizeof(EulerTour));
+    int* serialTin = (int*)malloc((size_t)n * sizeof(int));
+    int* serialTout = (int*)malloc((size_t)n * sizeof(int));
+    memcpy(serialTour, tour, (size_t)(2 * n - 1) * sizeof(EulerTour));
+    memcpy(serialTin, tin, (size_t)n * sizeof(int));
+    memcpy(serialTout, tout, (size_t)n * sizeof(int));
+    memset(tour, 0xff, (size_t)(2 * n - 1) * sizeof(EulerTour));
+    memset(tin, 0xff, (size_t)n * sizeof(int));
+    memset(tout, 0xff, (size_t)n * sizeof(int));
+    eulerTourParallel(tree, numThreads);
+    assert(tourIndex == 2 * n - 1);
+    assert(memcmp(serialTour, tour, (size_t)(2 * n - 1) * sizeof(EulerTour)) == 0);
+    assert(memcmp(serialTin, tin, (size_t)n * sizeof(int)) == 0);
+    assert(memcmp(serialTout, tout, (size_t)n * sizeof(int)) == 0);
+    free(serialTour);
+    free(serialTin);
+    free(serialTout);
+}
+
+static void checkTree(int n, enum Shape shape) {
+    int* parent = (int*)malloc((size_t)n * sizeof(int));
+    long long* values = (long long*)malloc((size_t)n * sizeof(long long));
+    Tree tree;
+    buildTree(&tree, n, shape, parent);
+    for (int i = 1; i < n; i++) assert(tree.links[i].parent == (uint32_t)parent[i]);
+    allocateTour(n);
+    eulerTour(&tree);
+    assert(tourIndex == 2 * n - 1);
+    checkParallelTour(&tree, 1 + rand() % 4);
+
+    for (int i = 0; i < n; i++) values[i] = rand() % 1000 - 500;
+    SubtreeSums sums;
+    buildSubtreeSums(&sums, values);
+    LcaIndex index;
+    buildLcaIndex(&index, tour, tourIndex);
+
+    for (int op = 0; op < 4 * n; op++) {
+        int v = rand() % n;
+        int kind = rand() % 3;
+        if (kind == 0) {
+            long long delta = rand() % 200 - 100;
+            addToNode(&sums, v, delta);
+            values[v] += delta;
+        } else if (kind == 1) {
+            long long sum = 0;
+            int size = 0;
+            for (int i = 0; i < n; i++) {
+                if (isAncestor(parent, v, i)) {
+                    sum += values[i];
+                    size++;
+                }
+            }
+            assert(subtreeSum(&sums, v) == sum);
+            assert(subtreeSize(v) == size);
+        } else {
+            int u = rand() % n;
+            assert(lca(&index, u, v) == naiveLca(parent, u, v));
+        }
+    }
+    // The same LCAs offline, in one batch with out-of-range nodes mixed in
+    int numQueries = 2 * n + 2;
+    int* qu = (int*)malloc((size_t)numQueries * sizeof(int));
+    int* qv = (int*)malloc((size_t)numQueries * sizeof(int));
+    int* answers = (int*)malloc((size_t)numQueries * sizeof(int));
+    for (int i = 0; i < numQueries; i++) {
+        qu[i] = rand() % (n + 1);
+        qv[i] = i % 5 == 0 ? qu[i] : rand() % n;
+    }
+    qv[numQueries - 1] = -1;
+    lcaOffline(&tree, qu, qv, answers, (size_t)numQueries);
+    for (int i = 0; i < numQueries; i++) assert(answers[i] == lca(&index, qu[i], qv[i]));
+    for (int i = 0; i < numQueries; i++) {
+        if (answers[i] >= 0) assert(answers[i] == naiveLca(parent, qu[i], qv[i]));
+    }
+    free(qu);
+    free(qv);
+    free(answers);
+
+    // Indices outside the tree have no tour position
+    assert(lca(&index, n, 0) == -1);
+    assert(lca(&index, -1, 0) == -1);
+
+    freeLcaIndex(&index);
+    freeSubtreeSums(&sums);
+    freeTree(&tree);
+    free(values);
+    free(parent);
+}
+
+// A path far deeper than any call stack would allow: preorder is the path
+// itself and every subtree runs to the last node
+static void checkDeepPath(int n) {
+    Tree tree;
+    initTree(&tree, 0, 16);
+    for (int i = 1; i < n; i++) addChild(&tree, (uint32_t)(i - 1), i);
+    allocateTour(n);
+    eulerTour(&tree);
+    assert(tourIndex == 2 * n - 1);
+    for (int i = 0; i < n; i++) {
+        assert(tin[i] == i && tout[i] == n - 1);
+        assert(tour[i].node == i && tour[i].depth == i);
+        assert(tour[2 * n - 2 - i].node == i);
+    }
+    checkParallelTour(&tree, 3);
+    freeTree(&tree);
+}
+
+int main() {
+    srand(12345);
+    int trees = 0;
+    for (int shape = 0; shape < NUM_SHAPES; shape++) {
+        for (int n = 1; n <= 70; n++, trees++) checkTree(n, (enum Shape)shape);
+        for (int round = 0; round < 20; round++, trees++) checkTree(100 + rand() % 400, (enum Shape)shape);
+        for (int threads = 1; threads <= 8; threads *= 2, trees++) {
+            // Large enough to span many parallel tour sublists
+            int n = 20000 + rand() % 20000;
+            int* parent = (int*)malloc((size_t)n * sizeof(int));
+            Tree tree;
+            buildTree(&tree, n, (enum Shape)shape, parent);
+            allocateTour(n);
+            eulerTour(&tree);
+            checkParallelTour(&tree, threads);
+            freeTree(&tree);
+            free(parent);
+        }
+    }
+    checkDeepPath(200000);
+    printf("All %d random trees matched brute force; 200000-deep path toured.\n", trees);
+    free(tour);
+    free(tin);
+    free(tout);
+    return 0;
+}